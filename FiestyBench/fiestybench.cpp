@@ -0,0 +1,677 @@
+//
+// fiestybench.cpp : Defines the entry point for the fiesty perft benchmark
+// program
+//
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "position.h"
+#include "search.h"
+#include "threadpool.h"
+#include "fiestybench.h"
+
+int main( int argc, const char* argv[] )
+{
+    return CFiestyBench::run( argc, argv );
+}
+
+///
+/// Runs the perft suite named on the command line and writes the results
+/// to standard output.
+///
+///     fiestybench [-d maxDepth] [-j numThreads] [-b] [-m make|copy|both]
+///         [-f json|csv] file.epd
+///
+/// -d skips the counts deeper than maxDepth, -j runs that many positions at
+/// once, -b counts the last ply in bulk, -m picks make and unmake, copy-make
+/// or both one after the other for a head to head comparison, and -f picks
+/// the output format, JSON by default.
+///
+///     fiestybench -s depth [-j maxThreads] [-r] [-m make|copy|both] 
+///         [-f json|csv]
+///
+/// instead searches a fixed set of positions to depth with 1, 2, 4 and so
+/// on up to maxThreads threads, by default one per core, and reports the 
+/// time to depth and the nodes per second of each thread count.  -r times
+/// the deterministic parallel search instead of Lazy SMP, and -m picks how
+/// the search makes moves, as for perft.
+///
+/// @returns
+///     0 if every count matched, 1 if one did not and 2 if the suite could
+///     not be run
+///
+int CFiestyBench::run( int argc, const char* argv[] )
+{
+    typedef std::chrono::steady_clock YClock;
+
+    U16 maxDepth = 0xFFFF;
+    U16 searchDepth = 0;
+    bool bDeterministic = false;
+    U32 numThreads = 0;                 // one, or one per core to scale to
+    bool bBulkCount = false;
+    EMode mode = kMakeUnmake;
+    EFormat format = kJson;
+    std::string sPath;
+
+    for ( int argIx = 1; argIx < argc; argIx++ )
+    {
+        std::string sArg = argv[argIx];
+        bool bHasValue = argIx + 1 < argc;
+        if ( sArg == "-d" && bHasValue )
+            maxDepth = U16( std::strtoul( argv[++argIx], nullptr, 10 ) );
+        else if ( sArg == "-j" && bHasValue )
+            numThreads = U32( std::strtoul( argv[++argIx], nullptr, 10 ) );
+        else if ( sArg == "-s" && bHasValue )
+            searchDepth = U16( std::strtoul( argv[++argIx], nullptr, 10 ) );
+        else if ( sArg == "-r" )
+            bDeterministic = true;
+        else if ( sArg == "-b" )
+            bBulkCount = true;
+        else if ( sArg == "-m" && bHasValue )
+        {
+            std::string sMode = argv[++argIx];
+            if ( sMode == "copy" )
+                mode = kCopyMake;
+            else if ( sMode == "both" )
+                mode = kBothModes;
+            else if ( sMode != "make" )
+            {
+                printUsage();
+                return 2;
+            }
+        }
+        else if ( sArg == "-f" && bHasValue )
+        {
+            std::string sFormat = argv[++argIx];
+            if ( sFormat == "csv" )
+                format = kCsv;
+            else if ( sFormat != "json" )
+            {
+                printUsage();
+                return 2;
+            }
+        }
+        else if ( sArg[0] != '-' && sPath.empty() )
+            sPath = sArg;
+        else
+        {
+            printUsage();
+            return 2;
+        }
+    }
+    if ( searchDepth > 0 )
+    {
+        if ( numThreads == 0 )
+            numThreads = std::max( std::thread::hardware_concurrency(), 1U );
+        return runScaling( 
+            searchDepth, numThreads, bDeterministic, mode, format );
+    }
+    if ( sPath.empty() )
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<SPerftCase> cases;
+    std::string sError;
+    if ( !loadEpd( sPath, cases, sError ) )
+    {
+        std::cerr << sError << std::endl;
+        return 2;
+    }
+
+    //
+    //  The positions run on their own threads when asked to, so the per
+    //  position times then include contention for the memory and caches.
+    //  Every case writes only to itself, and the results are written out 
+    //  in file order once they are all in.
+    //
+    YClock::time_point startTime = YClock::now();
+    if ( numThreads > 1 )
+    {
+        CThreadPool pool( numThreads );
+        for ( SPerftCase& rCase : cases )
+        {
+            SPerftCase* pCase = &rCase;
+            pool.submit( [pCase, maxDepth, bBulkCount, mode]( U32 )
+            {
+                runCase( *pCase, maxDepth, bBulkCount, mode );
+            } );
+        }
+        pool.wait();
+    }
+    else
+    {
+        for ( SPerftCase& rCase : cases )
+            runCase( rCase, maxDepth, bBulkCount, mode );
+    }
+    double wallSeconds = std::chrono::duration<double>( 
+        YClock::now() - startTime ).count();
+
+    if ( format == kCsv )
+        writeCsv( std::cout, cases );
+    else
+        writeJson( std::cout, cases, wallSeconds );
+
+    for ( const SPerftCase& rCase : cases )
+    {
+        if ( !rCase.isPassed() )
+            return 1;
+    }
+    return 0;
+}
+
+//
+//  The positions the search is timed on: the opening, the middlegame of 
+//  kiwipete, a quieter middlegame and a rook endgame.
+//
+const char* CFiestyBench::kScalingFens[] =
+{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+    "8/5pk1/6p1/3R4/7P/r5P1/5PK1/8 w - - 0 40",
+    nullptr
+};
+
+///
+/// Searches each of the scaling positions to depth with 1, 2, 4 and so on
+/// threads, and then with maxThreads if that is not a power of two, and 
+/// writes out how long each took.  Every search starts with an empty 
+/// transposition table, so the runs don't help each other.
+///
+/// @param mode
+///     is how the search makes moves.  For both modes each thread count
+///     is run with make and unmake and then with copy-make.
+///
+/// @returns
+///     0
+///
+int CFiestyBench::runScaling( 
+    U16         depth, 
+    U32         maxThreads, 
+    bool        bDeterministic, 
+    EMode       mode,
+    EFormat     format )
+{
+    typedef std::chrono::steady_clock YClock;
+
+    std::vector<U32> threadCounts;
+    for ( U32 numThreads = 1; numThreads < maxThreads; numThreads *= 2 )
+        threadCounts.push_back( numThreads );
+    threadCounts.push_back( maxThreads );
+
+    SSearchLimits limits = {};
+    limits.mMaxDepth = depth;
+    CTransTable table( kScalingTableMegaBytes );
+    std::vector<SScalingRun> runs;
+    for ( U32 numThreads : threadCounts )
+    {
+        SScalingRun run;
+        run.mNumThreads = numThreads;
+        run.mbCopyMake = false;
+        if ( mode != kCopyMake )
+            runs.push_back( run );
+        if ( mode != kMakeUnmake )
+        {
+            run.mbCopyMake = true;
+            runs.push_back( run );
+        }
+    }
+
+    for ( SScalingRun& rRun : runs )
+    {
+        for ( U32 fenIx = 0; kScalingFens[fenIx]; fenIx++ )
+        {
+            SSearchResult result;
+            result.msFen = kScalingFens[fenIx];
+
+            CPos pos;
+            std::string sError;
+            pos.parseFen( result.msFen, sError );
+            table.clear();
+            CSearcher searcher( pos );
+            searcher.setTransTable( &table );
+            searcher.setLimits( limits );
+            searcher.setDeterministic( bDeterministic );
+            searcher.setSearchCopyMake( rRun.mbCopyMake );
+
+            CMove bestMove;
+            YClock::time_point startTime = YClock::now();
+            searcher.determineBestMoveParallel( bestMove, rRun.mNumThreads );
+            result.mSeconds = std::chrono::duration<double>( 
+                YClock::now() - startTime ).count();
+            result.mNodes = searcher.getNodes();
+            result.msMove = bestMove.asStr();
+            rRun.mResults.push_back( result );
+        }
+    }
+
+    if ( format == kCsv )
+        writeScalingCsv( std::cout, depth, runs );
+    else
+        writeScalingJson( std::cout, depth, bDeterministic, runs );
+    return 0;
+}
+
+///
+/// Writes the scaling results as a JSON object, with a record for each 
+/// thread count and mode holding one for each position.  The speedup is 
+/// the time to depth of the first run, on one thread, over that of the 
+/// run, so with both modes copy-make's cost shows in it too.
+///
+void CFiestyBench::writeScalingJson(
+    std::ostream&                   rOut,
+    U16                             depth,
+    bool                            bDeterministic,
+    const std::vector<SScalingRun>& runs )
+{
+    double baseSeconds = runs.front().getSeconds();
+
+    rOut << std::fixed << std::setprecision( 6 );
+    rOut << "{\n"
+        << "  \"depth\": " << depth << ",\n"
+        << "  \"deterministic\": " 
+        << ( bDeterministic ? "true" : "false" ) << ",\n"
+        << "  \"runs\": [";
+
+    for ( size_t runIx = 0; runIx < runs.size(); runIx++ )
+    {
+        const SScalingRun& rRun = runs[runIx];
+        double seconds = rRun.getSeconds();
+        rOut << ( runIx == 0 ? "\n" : ",\n" )
+            << "    {\n"
+            << "      \"threads\": " << rRun.mNumThreads << ",\n"
+            << "      \"mode\": " 
+            << ( rRun.mbCopyMake ? "\"copy\"" : "\"make\"" ) << ",\n"
+            << "      \"nodes\": " << rRun.getNodes() << ",\n"
+            << "      \"seconds\": " << seconds << ",\n"
+            << "      \"nps\": " 
+            << U64( seconds > 0 ? rRun.getNodes() / seconds : 0 ) << ",\n"
+            << "      \"speedup\": " 
+            << ( seconds > 0 ? baseSeconds / seconds : 0 ) << ",\n"
+            << "      \"positions\": [";
+
+        for ( size_t resultIx = 0; resultIx < rRun.mResults.size(); 
+            resultIx++ )
+        {
+            const SSearchResult& rResult = rRun.mResults[resultIx];
+            rOut << ( resultIx == 0 ? "\n" : ",\n" )
+                << "        { \"fen\": " << quote( rResult.msFen )
+                << ", \"move\": " << quote( rResult.msMove )
+                << ", \"nodes\": " << rResult.mNodes
+                << ", \"seconds\": " << rResult.mSeconds
+                << ", \"nps\": " << U64( rResult.mSeconds > 0 
+                    ? rResult.mNodes / rResult.mSeconds : 0 ) << " }";
+        }
+        rOut << "\n      ]\n    }";
+    }
+    rOut << "\n  ]\n}" << std::endl;
+}
+
+///
+/// Writes the scaling results as CSV with a header row and a row for each
+/// position of each thread count and mode
+///
+void CFiestyBench::writeScalingCsv(
+    std::ostream&                   rOut,
+    U16                             depth,
+    const std::vector<SScalingRun>& runs )
+{
+    rOut << std::fixed << std::setprecision( 6 );
+    rOut << "threads,mode,fen,depth,move,nodes,seconds,nps\n";
+    for ( const SScalingRun& rRun : runs )
+    {
+        for ( const SSearchResult& rResult : rRun.mResults )
+        {
+            rOut << rRun.mNumThreads << "," 
+                << ( rRun.mbCopyMake ? "copy" : "make" ) << "," 
+                << quote( rResult.msFen ) << ","
+                << depth << "," << rResult.msMove << ","
+                << rResult.mNodes << "," << rResult.mSeconds << ","
+                << U64( rResult.mSeconds > 0 
+                    ? rResult.mNodes / rResult.mSeconds : 0 ) << "\n";
+        }
+    }
+    rOut.flush();
+}
+
+///
+/// Reads a perft suite.  Each line is a FEN, whose move counters may be
+/// left out, followed by the expected counts as ";D<depth> <nodes>" 
+/// operations.  Blank lines and lines starting with # are skipped.
+///
+/// @param sPath
+///     is the file to read
+///
+/// @param rCases
+///     receives a case for each position
+///
+/// @param rsErrorText
+///     receives the reason, if the file could not be read
+///
+/// @returns
+///     true if the whole file was read
+///
+bool CFiestyBench::loadEpd(
+    const std::string&          sPath,
+    std::vector<SPerftCase>&    rCases,
+    std::string&                rsErrorText )
+{
+    std::ifstream in( sPath );
+    if ( !in )
+    {
+        rsErrorText = "Cannot open " + sPath;
+        return false;
+    }
+
+    std::string sLine;
+    U32 lineNum = 0;
+    while ( std::getline( in, sLine ) )
+    {
+        lineNum++;
+        size_t firstIx = sLine.find_first_not_of( " \t\r" );
+        if ( firstIx == std::string::npos || sLine[firstIx] == '#' )
+            continue;
+
+        SPerftCase perftCase;
+        perftCase.mLineNum = lineNum;
+        if ( !parseEpdLine( sLine, perftCase, rsErrorText ) )
+        {
+            rsErrorText = sPath + "(" + std::to_string( lineNum ) + "): " 
+                + rsErrorText;
+            return false;
+        }
+        rCases.push_back( perftCase );
+    }
+    return true;
+}
+
+///
+/// Splits a line of a perft suite into its FEN and expected counts.  The
+/// FEN itself is checked when the case is run, so that one bad position 
+/// does not stop the rest of the suite.
+///
+bool CFiestyBench::parseEpdLine(
+    const std::string&          sLine,
+    SPerftCase&                 rCase,
+    std::string&                rsErrorText )
+{
+    std::vector<std::string> fields;
+    std::stringstream line( sLine );
+    std::string sField;
+    while ( std::getline( line, sField, ';' ) )
+        fields.push_back( sField );
+
+    //
+    //  An EPD position has only the first four FEN fields, so fill in the
+    //  move counters parseFen wants.
+    //
+    std::stringstream fen( fields[0] );
+    std::vector<std::string> fenTokens;
+    std::string sToken;
+    while ( fen >> sToken )
+        fenTokens.push_back( sToken );
+    if ( fenTokens.size() == 4 )
+    {
+        fenTokens.push_back( "0" );
+        fenTokens.push_back( "1" );
+    }
+    for ( const std::string& rsToken : fenTokens )
+        rCase.msFen += ( rCase.msFen.empty() ? "" : " " ) + rsToken;
+
+    for ( size_t fieldIx = 1; fieldIx < fields.size(); fieldIx++ )
+    {
+        std::stringstream op( fields[fieldIx] );
+        std::string sOpcode;
+        SDepthResult result = {};
+        if ( !( op >> sOpcode ) || sOpcode[0] != 'D' )
+            continue;
+        char* pzEnd;
+        result.mDepth = U16( std::strtoul( sOpcode.c_str() + 1, &pzEnd, 10 ) );
+        if ( *pzEnd != '\0' || result.mDepth == 0 
+            || !( op >> result.mExpected ) )
+        {
+            rsErrorText = "Invalid perft count: " + fields[fieldIx];
+            return false;
+        }
+        rCase.mResults.push_back( result );
+    }
+    if ( rCase.mResults.empty() )
+    {
+        rsErrorText = "No perft counts";
+        return false;
+    }
+    std::sort( rCase.mResults.begin(), rCase.mResults.end(),
+        []( const SDepthResult& a, const SDepthResult& b ) 
+        { 
+            return a.mDepth < b.mDepth; 
+        } );
+    return true;
+}
+
+///
+/// Counts the nodes of a position at each depth of its case, timing each
+/// count on its own.
+///
+/// @param maxDepth
+///     is the deepest count to run; the deeper ones are dropped
+///
+/// @param bBulkCount
+///     is true to count the last ply without making its moves
+///
+/// @param mode
+///     is how perft makes moves.  For both modes each depth is counted 
+///     with make and unmake and then with copy-make.
+///
+void CFiestyBench::runCase( 
+    SPerftCase&     rCase, 
+    U16             maxDepth, 
+    bool            bBulkCount,
+    EMode           mode )
+{
+    typedef std::chrono::steady_clock YClock;
+
+    rCase.mResults.erase( std::remove_if( 
+        rCase.mResults.begin(), rCase.mResults.end(),
+        [maxDepth]( const SDepthResult& r ) { return r.mDepth > maxDepth; } ),
+        rCase.mResults.end() );
+    std::vector<SDepthResult> results;
+    for ( SDepthResult result : rCase.mResults )
+    {
+        if ( mode != kCopyMake )
+            results.push_back( result );
+        if ( mode != kMakeUnmake )
+        {
+            result.mbCopyMake = true;
+            results.push_back( result );
+        }
+    }
+    rCase.mResults = results;
+
+    CPos pos;
+    if ( !pos.parseFen( rCase.msFen, rCase.msError ) )
+        return;
+    CSearcher searcher( pos );
+    searcher.setPerftBulkCount( bBulkCount );
+
+    for ( SDepthResult& rResult : rCase.mResults )
+    {
+        YClock::time_point startTime = YClock::now();
+        searcher.setPerftCopyMake( rResult.mbCopyMake );
+        rResult.mNodes = searcher.perft( rResult.mDepth );
+        rResult.mSeconds = std::chrono::duration<double>( 
+            YClock::now() - startTime ).count();
+    }
+}
+
+///
+/// Writes the results as a JSON object, with the totals and a record for
+/// each position holding one for each depth.
+///
+void CFiestyBench::writeJson(
+    std::ostream&                   rOut,
+    const std::vector<SPerftCase>&  cases,
+    double                          wallSeconds )
+{
+    U64 totalNodes = 0;
+    bool bAllPassed = true;
+    for ( const SPerftCase& rCase : cases )
+    {
+        totalNodes += rCase.getNodes();
+        bAllPassed = bAllPassed && rCase.isPassed();
+    }
+
+    rOut << std::fixed << std::setprecision( 6 );
+    rOut << "{\n"
+        << "  \"passed\": " << ( bAllPassed ? "true" : "false" ) << ",\n"
+        << "  \"nodes\": " << totalNodes << ",\n"
+        << "  \"seconds\": " << wallSeconds << ",\n"
+        << "  \"nps\": " 
+        << U64( wallSeconds > 0 ? totalNodes / wallSeconds : 0 ) << ",\n"
+        << "  \"positions\": [";
+
+    for ( size_t caseIx = 0; caseIx < cases.size(); caseIx++ )
+    {
+        const SPerftCase& rCase = cases[caseIx];
+        double seconds = rCase.getSeconds();
+        rOut << ( caseIx == 0 ? "\n" : ",\n" )
+            << "    {\n"
+            << "      \"line\": " << rCase.mLineNum << ",\n"
+            << "      \"fen\": " << quote( rCase.msFen ) << ",\n";
+        if ( !rCase.msError.empty() )
+            rOut << "      \"error\": " << quote( rCase.msError ) << ",\n";
+        rOut << "      \"passed\": " 
+            << ( rCase.isPassed() ? "true" : "false" ) << ",\n"
+            << "      \"nodes\": " << rCase.getNodes() << ",\n"
+            << "      \"seconds\": " << seconds << ",\n"
+            << "      \"nps\": " 
+            << U64( seconds > 0 ? rCase.getNodes() / seconds : 0 ) << ",\n"
+            << "      \"depths\": [";
+
+        for ( size_t resultIx = 0; resultIx < rCase.mResults.size(); 
+            resultIx++ )
+        {
+            const SDepthResult& rResult = rCase.mResults[resultIx];
+            rOut << ( resultIx == 0 ? "\n" : ",\n" )
+                << "        { \"depth\": " << rResult.mDepth
+                << ", \"mode\": " 
+                << ( rResult.mbCopyMake ? "\"copy\"" : "\"make\"" )
+                << ", \"expected\": " << rResult.mExpected
+                << ", \"nodes\": " << rResult.mNodes
+                << ", \"passed\": " 
+                << ( rResult.isPassed() ? "true" : "false" )
+                << ", \"seconds\": " << rResult.mSeconds
+                << ", \"nps\": " << U64( rResult.getNps() ) << " }";
+        }
+        rOut << "\n      ]\n    }";
+    }
+    rOut << "\n  ]\n}" << std::endl;
+}
+
+///
+/// Writes the results as CSV with a header row and a row for each depth of
+/// each position.  A position that could not be run gets one row with the
+/// result "error".
+///
+void CFiestyBench::writeCsv(
+    std::ostream&                   rOut,
+    const std::vector<SPerftCase>&  cases )
+{
+    rOut << std::fixed << std::setprecision( 6 );
+    rOut << "line,fen,depth,mode,expected,nodes,result,seconds,nps\n";
+    for ( const SPerftCase& rCase : cases )
+    {
+        if ( !rCase.msError.empty() )
+        {
+            rOut << rCase.mLineNum << "," << quote( rCase.msFen ) 
+                << ",,,,,error,,\n";
+            continue;
+        }
+        for ( const SDepthResult& rResult : rCase.mResults )
+        {
+            rOut << rCase.mLineNum << "," << quote( rCase.msFen ) << ","
+                << rResult.mDepth << "," 
+                << ( rResult.mbCopyMake ? "copy" : "make" ) << ","
+                << rResult.mExpected << ","
+                << rResult.mNodes << ","
+                << ( rResult.isPassed() ? "pass" : "fail" ) << ","
+                << rResult.mSeconds << "," << U64( rResult.getNps() ) << "\n";
+        }
+    }
+    rOut.flush();
+}
+
+///
+/// @returns
+///     the string in double quotes, with any quotes or backslashes in it 
+///     escaped, which suits both JSON and CSV for the text of a FEN
+///
+std::string CFiestyBench::quote( const std::string& s )
+{
+    std::string sQuoted = "\"";
+    for ( char c : s )
+    {
+        if ( c == '"' || c == '\\' )
+            sQuoted += '\\';
+        sQuoted += c;
+    }
+    return sQuoted + "\"";
+}
+
+void CFiestyBench::printUsage()
+{
+    std::cerr << "usage: fiestybench [-d maxDepth] [-j numThreads] [-b] "
+        "[-m make|copy|both] [-f json|csv] file.epd" << std::endl
+        << "       fiestybench -s depth [-j maxThreads] [-r] "
+            "[-m make|copy|both] [-f json|csv]"
+        << std::endl;
+}
+
+bool CFiestyBench::SPerftCase::isPassed() const
+{
+    if ( !msError.empty() )
+        return false;
+    for ( const SDepthResult& rResult : mResults )
+    {
+        if ( !rResult.isPassed() )
+            return false;
+    }
+    return true;
+}
+
+U64 CFiestyBench::SPerftCase::getNodes() const
+{
+    U64 nodes = 0;
+    for ( const SDepthResult& rResult : mResults )
+        nodes += rResult.mNodes;
+    return nodes;
+}
+
+double CFiestyBench::SPerftCase::getSeconds() const
+{
+    double seconds = 0;
+    for ( const SDepthResult& rResult : mResults )
+        seconds += rResult.mSeconds;
+    return seconds;
+}
+
+U64 CFiestyBench::SScalingRun::getNodes() const
+{
+    U64 nodes = 0;
+    for ( const SSearchResult& rResult : mResults )
+        nodes += rResult.mNodes;
+    return nodes;
+}
+
+double CFiestyBench::SScalingRun::getSeconds() const
+{
+    double seconds = 0;
+    for ( const SSearchResult& rResult : mResults )
+        seconds += rResult.mSeconds;
+    return seconds;
+}
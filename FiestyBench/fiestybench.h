@@ -0,0 +1,127 @@
+/// file fiestybench.h
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// header file that has to do with the perft benchmark, which runs an EPD
+/// suite of positions with known perft counts and reports how fast the
+/// move generator counted them and whether it got them right.  It also 
+/// measures how the search scales with the number of threads.
+///
+#ifndef Fiesty_fiestybench_h
+#define Fiesty_fiestybench_h
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "fiesty.h"
+
+///
+/// CFiestyBench contains static methods that load and run a perft suite.
+///
+class CFiestyBench
+{
+public:
+    enum EFormat { kJson, kCsv };
+    enum EMode { kMakeUnmake, kCopyMake, kBothModes };
+
+    static int run( int argc, const char* argv[] );
+
+private:
+    ///
+    /// The perft of one position to one depth
+    ///
+    struct SDepthResult
+    {
+        U16         mDepth;
+        bool        mbCopyMake;
+        U64         mExpected;
+        U64         mNodes;
+        double      mSeconds;
+
+        bool isPassed() const { return mNodes == mExpected; }
+        double getNps() const { return mSeconds > 0 ? mNodes / mSeconds : 0; }
+    };
+
+    ///
+    /// A position of the suite, with the counts it is expected to give and,
+    /// once it has been run, what it gave
+    ///
+    struct SPerftCase
+    {
+        U32                         mLineNum;
+        std::string                 msFen;
+        std::vector<SDepthResult>   mResults;   // expected counts by depth
+        std::string                 msError;    // why it could not run
+
+        bool isPassed() const;
+        U64 getNodes() const;
+        double getSeconds() const;
+    };
+
+    ///
+    /// A search of one position to the scaling depth
+    ///
+    struct SSearchResult
+    {
+        std::string     msFen;
+        std::string     msMove;
+        U64             mNodes;
+        double          mSeconds;           // time to depth
+    };
+
+    ///
+    /// The searches of all the scaling positions with one thread count, 
+    /// making moves one way
+    ///
+    struct SScalingRun
+    {
+        U32                         mNumThreads;
+        bool                        mbCopyMake;
+        std::vector<SSearchResult>  mResults;
+
+        U64 getNodes() const;
+        double getSeconds() const;
+    };
+
+    static const char*  kScalingFens[];
+    static const U32    kScalingTableMegaBytes = 64;
+
+    static int runScaling( 
+        U16         depth, 
+        U32         maxThreads, 
+        bool        bDeterministic, 
+        EMode       mode,
+        EFormat     format );
+    static void writeScalingJson(
+        std::ostream&                   rOut,
+        U16                             depth,
+        bool                            bDeterministic,
+        const std::vector<SScalingRun>& runs );
+    static void writeScalingCsv(
+        std::ostream&                   rOut,
+        U16                             depth,
+        const std::vector<SScalingRun>& runs );
+    static bool loadEpd(
+        const std::string&          sPath,
+        std::vector<SPerftCase>&    rCases,
+        std::string&                rsErrorText );
+    static bool parseEpdLine(
+        const std::string&          sLine,
+        SPerftCase&                 rCase,
+        std::string&                rsErrorText );
+    static void runCase( 
+        SPerftCase&     rCase, 
+        U16             maxDepth, 
+        bool            bBulkCount,
+        EMode           mode );
+    static void writeJson(
+        std::ostream&                   rOut,
+        const std::vector<SPerftCase>&  cases,
+        double                          wallSeconds );
+    static void writeCsv(
+        std::ostream&                   rOut,
+        const std::vector<SPerftCase>&  cases );
+    static std::string quote( const std::string& s );
+    static void printUsage();
+};
+
+#endif
@@ -4,9 +4,14 @@
 //
 #include <iostream>
 #include "bitboard.h"
+#include "gen.h"
 #include "fiestygen.h"
 
-// #define BBTRACE 
+//
+//  Seed for the magic multiplier search, fixed so that the output is 
+//  repeatable from run to run.
+//
+U64 CFiestyGen::mgRandomState = 0x9E3779B97F4A7C15ULL;
 
 int main( int argc, const char* argv[] )
 {
@@ -16,216 +21,116 @@ int main( int argc, const char* argv[] )
 }
 
 ///
-/// Generates source code for various bitboards, such as move sets and 
-/// magics.
+/// Generates source code for the magic multipliers.
 ///
 void CFiestyGen::generate()
 {
-    genKnightAttacks();
-    genKingAttacks();
-    genRookRays();
-    genBishopRays();
+    genMagics();
 }
 
 ///
-/// Generates source code for the bishop rays.
+/// Generates source code for the rook and bishop magic multipliers.  CMagic
+/// derives the masks, shifts and attack table offsets from them at compile
+/// time.
 ///
-void CFiestyGen::genBishopRays()
+void CFiestyGen::genMagics()
 {
-    std::cout << "const SBishopRays CGen::mbbBishopRays[CSqix::kNumSquares] = {";
-    for ( U8 sq =  0; sq < CSqix::kNumSquares; sq++ )
-    {
-        CSqix sqix( sq );
-        U8 bishopRank = U8( sqix.getRank().get() );
-        U8 bishopFile = U8( sqix.getFile().get() );
-        CBitBoard bbNorthEast( 0ULL );
-		CBitBoard bbSouthEast( 0ULL );
-		CBitBoard bbSouthWest( 0ULL );
-		CBitBoard bbNorthWest( 0ULL );
-
-		//
-		//	Loop setting the north-east bits
-		//
-        S8 r = bishopRank + 1;
-        S8 f = bishopFile + 1;
-		while ( r <= S8( ERank::kRank8 ) && f <= S8( EFile::kFileH ) )
-        {
-			bbNorthEast.setSquare( CSqix( ERank( r ), EFile( f ) ).get() );
-            r++;
-            f++;
-        }
-
-		//
-		//	Loop setting the south-east bits
-		//
-        r = bishopRank - 1;
-        f = bishopFile + 1;
-		while ( r >= S8( ERank::kRank1 ) && f <= S8( EFile::kFileH ) )
-        {
-			bbSouthEast.setSquare( CSqix( ERank( r ), EFile( f ) ).get() );
-            r--;
-            f++;
-        }
-
-		//
-		//	Loop setting the south-west bits
-		//
-        r = bishopRank - 1;
-        f = bishopFile - 1;
-		while ( r >= S8( ERank::kRank1 ) && f >= S8( EFile::kFileA ) )
-        {
-			bbSouthWest.setSquare( CSqix( ERank( r ), EFile( f ) ).get() );
-            r--;
-            f--;
-        }
-
-		//
-		//	Loop setting the north-west bits
-		//
-        r = bishopRank + 1;
-        f = bishopFile - 1;
-		while ( r <= S8( ERank::kRank8 ) && f >= S8( EFile::kFileA ) )
-        {
-			bbNorthWest.setSquare( CSqix( ERank( r ), EFile( f ) ).get() );
-            r++;
-            f--;
-        }
-
-#ifdef BBTRACE
-       printBitBoardDiagram( sqix.asAbbr() + " NorthEast",  bbNorthEast );
-       printBitBoardDiagram( sqix.asAbbr() + " SouthEast",  bbSouthEast );
-       printBitBoardDiagram( sqix.asAbbr() + " SouthWest",  bbSouthWest );
-       printBitBoardDiagram( sqix.asAbbr() + " NorthWest",  bbNorthWest );
-#endif
-
-       std::cout << "\n    /* " << sqix.asAbbr() << " */ { "
-            << bbNorthEast.asAbbr() << "ULL" << ", "
-            << bbSouthEast.asAbbr() << "ULL" << ", "
-            << bbSouthWest.asAbbr() << "ULL" << ", "
-            << bbNorthWest.asAbbr() << "ULL" << " }";
-        if ( sq != CSqix::kNumSquares - 1 )
-            std::cout << ", ";
-    }
-    std::cout << "};\n" << std::flush;
+    genMagicMultipliers( "kRookMultipliers", true );
+    genMagicMultipliers( "kBishopMultipliers", false );
 }
 
 ///
-/// Generates source code for the king moves
+/// Finds a magic multiplier for each square and generates source code for
+/// them.
 ///
-void CFiestyGen::genKingAttacks()
-{
-    std::cout << "const YBitBoard CGen::mbbKingAttacks[CSqix::kNumSquares] = {";
-    for ( U8 sq =  0; sq < CSqix::kNumSquares; sq++ )
-    {
-        CSqix sqix( sq );
-        S8 r = S8( sqix.getRank().get() );
-        S8 f = S8( sqix.getFile().get() );
-        CBitBoard bb( 0ULL );
-        bb.setIfValid( r + 1, f - 1 );
-        bb.setIfValid( r + 1, f );
-        bb.setIfValid( r + 1, f + 1 );
-        bb.setIfValid( r, f - 1 );
-        bb.setIfValid( r, f + 1 );
-        bb.setIfValid( r - 1, f - 1 );
-        bb.setIfValid( r - 1, f );
-        bb.setIfValid( r - 1, f + 1 );
-#ifdef BBTRACE
-        printBitBoardDiagram( sqix.asAbbr(), bb );
-#endif
-        std::cout << "\n    /* " << sqix.asAbbr() << " */ ";
-        std::cout << bb.asAbbr() << "ULL";
-        if( sq != CSqix::kNumSquares - 1 ) 
-            std::cout << ",";
-    }
-    std::cout << " };\n" << std::flush;
-}
-
+/// @param pzName
+///     the name of the multiplier table that is generated
 ///
-/// Generates source code for the knight moves
+/// @param bRook
+///     true for the rook multipliers, false for the bishop multipliers
 ///
-void CFiestyGen::genKnightAttacks()
+void CFiestyGen::genMagicMultipliers( const char* pzName, bool bRook )
 {
-    std::cout << "const YBitBoard CGen::mbbKnightAttacks[CSqix::kNumSquares] = {";
-    for ( U8 sq =  0; sq < CSqix::kNumSquares; sq++ )
+    static YBitBoard    occupancies[4096];
+    static YBitBoard    attacks[4096];
+    static YBitBoard    used[4096];
+    static U32          usedEpoch[4096];
+    U32                 epoch = 0;
+
+    std::cout << "static constexpr U64 " << pzName 
+        << "[CSqix::kNumSquares] = {";
+    for ( U8 sq = 0; sq < CSqix::kNumSquares; sq++ )
     {
         CSqix sqix( sq );
-        S8 r = S8( sqix.getRank().get() );
-        S8 f = S8( sqix.getFile().get() );
-        std::cout << "\n    /* " << sqix.asAbbr() << " */ ";
-        CBitBoard bb( 0ULL );
-        bb.setIfValid( r + 2, f + 1 );
-        bb.setIfValid( r + 2, f - 1 );
-        bb.setIfValid( r - 2, f + 1 );
-        bb.setIfValid( r - 2, f - 1 );
-        bb.setIfValid( r + 1, f + 2 );
-        bb.setIfValid( r + 1, f - 2 );
-        bb.setIfValid( r - 1, f + 2 );
-        bb.setIfValid( r - 1, f - 2 );
-        std::cout << bb.asAbbr() << "ULL";
-        if( sq != CSqix::kNumSquares - 1 ) 
+        YBitBoard bbMask = CGen::genSliderMask( sq, bRook );
+        U8 numBits = CGen::countBits( bbMask );
+        U32 numEntries = 1U << numBits;
+
+        //
+        //  Enumerate every subset of the mask (carry-rippler) along with
+        //  the attack set it produces.
+        //
+        YBitBoard subset = 0;
+        for ( U32 ix = 0; ix < numEntries; ix++ )
+        {
+            occupancies[ix] = subset;
+            attacks[ix] = CGen::genSliderAttacks( sq, subset, bRook );
+            subset = ( subset - bbMask ) & bbMask;
+        }
+
+        //
+        //  Try sparse random multipliers until one maps every subset to an
+        //  entry that is either unused or holds the same attack set.
+        //
+        U64 multiplier;
+        bool bFound = false;
+        while ( !bFound )
+        {
+            multiplier = genRandomSparse();
+            if ( CGen::countBits( ( bbMask * multiplier ) 
+                & 0xFF00000000000000ULL ) < 6 )
+            {
+                continue;
+            }
+            epoch++;
+            bFound = true;
+            for ( U32 ix = 0; ix < numEntries && bFound; ix++ )
+            {
+                U32 key = U32( ( occupancies[ix] * multiplier ) 
+                    >> ( 64 - numBits ) );
+                if ( usedEpoch[key] != epoch )
+                {
+                    usedEpoch[key] = epoch;
+                    used[key] = attacks[ix];
+                }
+                else if ( used[key] != attacks[ix] )
+                {
+                    bFound = false;
+                }
+            }
+        }
+
+        std::cout << "\n    /* " << sqix.asAbbr() << " */ "
+            << CBitBoard( multiplier ).asAbbr() << "ULL";
+        if ( sq != CSqix::kNumSquares - 1 )
             std::cout << ",";
     }
     std::cout << " };\n" << std::flush;
 }
 
 ///
-/// Generates source code for the rook rays.
+/// @returns a random number with few bits set, a good magic candidate.
 ///
-void CFiestyGen::genRookRays()
+U64 CFiestyGen::genRandomSparse()
 {
-    std::cout << "const SRookRays CGen::mbbRookRays[CSqix::kNumSquares] = {";
-    for ( U8 sq =  0; sq < CSqix::kNumSquares; sq++ )
+    U64 r = ~0ULL;
+    for ( int j = 0; j < 3; j++ )
     {
-        CSqix sqix( sq );
-        U8 rookRank = U8( sqix.getRank().get() );
-        U8 rookFile = U8( sqix.getFile().get() );
-        CBitBoard bbNorth( 0ULL );
-		CBitBoard bbEast( 0ULL );
-		CBitBoard bbSouth( 0ULL );
-		CBitBoard bbWest( 0ULL );
-		//
-		//	Loop setting the north bits
-		//
-		for ( U8 r = rookRank + 1; r <= U8( ERank::kRank8 ); r++ )
-			bbNorth.setSquare( CSqix( ERank( r ), EFile( rookFile ) ).get() );
-		//
-		//	Loop setting the east bits
-		//
-		for ( U8 f = rookFile + 1; f <= U8( EFile::kFileH ); f++ )
-			bbEast.setSquare( CSqix( ERank( rookRank ), EFile( f ) ).get() );
-		//
-		//	Loop setting the south bits
-		//
-		for ( U8 r = U8( ERank::kRank1 ); r < rookRank; r++ )
-			bbSouth.setSquare( CSqix( ERank( r ), EFile( rookFile ) ).get() );
-		//
-		//	Loop setting the west bits
-		//
-		for ( U8 f = U8( EFile::kFileA ); f < rookFile; f++ )
-			bbWest.setSquare( CSqix( ERank( rookRank ), EFile( f ) ).get() );
-#ifdef BBTRACE
-            printBitBoardDiagram( sqix.asAbbr() + " North",  bbNorth );
-            printBitBoardDiagram( sqix.asAbbr() + " East",  bbEast );
-            printBitBoardDiagram( sqix.asAbbr() + " South",  bbSouth );
-            printBitBoardDiagram( sqix.asAbbr() + " West",  bbWest );
-#endif
-        std::cout << "\n    /* " << sqix.asAbbr() << " */ { "
-            << bbNorth.asAbbr() << "ULL" << ", "
-            << bbEast.asAbbr() << "ULL" << ", "
-            << bbSouth.asAbbr() << "ULL" << ", "
-            << bbWest.asAbbr() << "ULL" << " }";
-        if ( sq != CSqix::kNumSquares - 1 )
-            std::cout << ", ";
+        mgRandomState ^= mgRandomState >> 12;
+        mgRandomState ^= mgRandomState << 25;
+        mgRandomState ^= mgRandomState >> 27;
+        r &= mgRandomState * 0x2545F4914F6CDD1DULL;
     }
-    std::cout << "};\n" << std::flush;
-}
-
-///
-/// prints a labeled bitboard diagram as a comment
-///
-void CFiestyGen::printBitBoardDiagram( std::string& rLabel, CBitBoard bb )
-{
-    std::cout << "\n/* " << rLabel << "\n" << bb.asDiagram() << "*/";
+    return r;
 }
 
-
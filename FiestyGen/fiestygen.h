@@ -2,17 +2,17 @@
 ///
 /// Fiesty (C) 2014 by Jeffery A Esposito
 ///
-/// header file that has to with generating bitboards which are then compiled
-/// in to Fiesty as static constants.
+/// header file that has to with searching for the magic multipliers which
+/// are then compiled in to Fiesty as static constants.  Every other table is
+/// generated at compile time by CGen.
 ///
-#ifndef Fiesty_gen_h
-#define Fiesty_gen_h
+#ifndef Fiesty_fiestygen_h
+#define Fiesty_fiestygen_h
 #include "fiesty.h"
 #include "square.h"
 
 ///
-/// CGennerator contains static methods that generate various move sets and 
-/// magics.
+/// CFiestyGen contains static methods that search for magics.
 ///
 class CFiestyGen
 {
@@ -20,11 +20,11 @@ public:
     static void generate();
 
 private: 
-    static void genKingAttacks();
-    static void genKnightAttacks();
-	static void genRookRays();
-	static void genBishopRays();
-    static void printBitBoardDiagram( std::string& rLabel, CBitBoard bb );
+    static void genMagics();
+    static void genMagicMultipliers( const char* pzName, bool bRook );
+    static U64 genRandomSparse();
+
+    static U64          mgRandomState;
 };
 
 #endif
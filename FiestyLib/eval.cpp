@@ -0,0 +1,94 @@
+/// file eval.cpp
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// code having to do with the static evaluation
+///
+///
+#include <algorithm>
+#include "fiesty.h"
+#include "eval.h"
+
+//
+//  The king has no material value, since both sides always have one.
+//
+const YVal CEval::kPieceValues[U8( EPieceType::kNum )] =
+    { 100, 320, 330, 500, 900, 0 };
+
+//
+//  Centralization bonuses per step toward the center, for a knight, a 
+//  bishop and a queen, and the bonus per rank a pawn has advanced.
+//
+static const S32 kKnightCenter = 5;
+static const S32 kBishopCenter = 3;
+static const S32 kQueenCenter = 1;
+static const S32 kPawnAdvance = 4;
+
+///
+/// @returns 
+///     how close a square is to the center, from 0 in the corners to 6 on
+///     the four center squares
+///
+static S32 centrality( CSqix sqix )
+{
+    S32 file = S32( sqix.getFile().get() );
+    S32 rank = S32( sqix.getRank().get() );
+    return std::min( file, 7 - file ) + std::min( rank, 7 - rank );
+}
+
+///
+/// @returns
+///     the bonus for a set of pieces, for how near the center they are
+///
+static S32 centerBonus( CBitBoard bbPieces, S32 bonusPerStep )
+{
+    S32 bonus = 0;
+    while ( bbPieces.get() )
+        bonus += bonusPerStep * centrality( bbPieces.popLsb() );
+    return bonus;
+}
+
+///
+/// @returns
+///     the material and placement of the pieces of color C
+///
+template <EColor C>
+S32 CEval::evaluateSide( const CPos& rPos )
+{
+    S32 score = 0;
+    for ( U8 pt = U8( EPieceType::kPawn ); pt < U8( EPieceType::kKing ); 
+        pt++ )
+    {
+        score += kPieceValues[pt] * S32( 
+            rPos.getPieces( C, EPieceType( pt ) ).popcnt() );
+    }
+
+    score += centerBonus( 
+        rPos.getPieces( C, EPieceType::kKnight ), kKnightCenter );
+    score += centerBonus( 
+        rPos.getPieces( C, EPieceType::kBishop ), kBishopCenter );
+    score += centerBonus( 
+        rPos.getPieces( C, EPieceType::kQueen ), kQueenCenter );
+
+    CBitBoard bbPawns = rPos.getPieces( C, EPieceType::kPawn );
+    while ( bbPawns.get() )
+    {
+        S32 rank = S32( bbPawns.popLsb().getRank().get() );
+        score += kPawnAdvance 
+            * ( C == EColor::kWhite ? rank - 1 : 6 - rank );
+    }
+    return score;
+}
+
+///
+/// evaluates a position
+///
+/// @returns
+///     the score from the point of view of the side to move
+///
+YVal CEval::evaluate( const CPos& rPos )
+{
+    S32 score = evaluateSide<EColor::kWhite>( rPos ) 
+        - evaluateSide<EColor::kBlack>( rPos );
+    return YVal( rPos.getWhoseMove().isWhite() ? score : -score );
+}
@@ -0,0 +1,30 @@
+/// file eval.h
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// headers having to do with the static evaluation
+///
+///
+#ifndef Fiesty_eval_h
+#define Fiesty_eval_h
+
+#include "fiesty.h"
+#include "position.h"
+
+///
+/// The static evaluation: material, plus small bonuses for pawns that 
+/// have advanced and for knights, bishops and queens near the center.  
+/// It is only meant to give the search something sensible to maximize.
+///
+class CEval
+{
+public:
+    static const YVal   kPieceValues[U8( EPieceType::kNum )];
+
+    static YVal evaluate( const CPos& rPos );
+
+private:
+    template <EColor C> static S32 evaluateSide( const CPos& rPos );
+};
+
+#endif      // eval.h
@@ -22,6 +22,8 @@ typedef std::uint8_t    U8;
 typedef std::int8_t     S8;
 typedef std::uint16_t   U16;
 typedef std::int16_t    S16;
+typedef std::uint32_t   U32;
+typedef std::int32_t    S32;
 typedef std::uint64_t   U64;
 typedef std::int64_t    S64;
 
@@ -121,8 +123,9 @@ typedef std::uint64_t    YHashKey;
 typedef std::uint64_t    YBitBoard;
 
 ///
-/// evaluaution value
+/// evaluation value, in centipawns from the point of view of the side to
+/// move
 ///
-typedef U16              YVal;
+typedef S16              YVal;
 
 #endif  // fiesty.h
\ No newline at end of file
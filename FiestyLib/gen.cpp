@@ -1,15 +1,23 @@
 ///
 /// Fiesty (C) 2014 by Jeffery A Esposito
 ///
-/// wrapper of the generated code, includes "generated.cpp" which should be 
-/// generated by the "fiesty gen >generated.cpp"
+/// the generated tables.  Each is computed at compile time by its constexpr
+/// generator in gen.h.
 ///
 #include "fiesty.h"
 #include "bitboard.h"
 #include "gen.h"
 
-//
-// To run a gen, comment out this line of code.
-//
-#include "gen.out"
-
+constexpr SSquareTable<YBitBoard> CGen::mbbKnightAttacks 
+    = CGen::genKnightAttacks();
+constexpr SSquareTable<YBitBoard> CGen::mbbKingAttacks 
+    = CGen::genKingAttacks();
+constexpr STable<SSquareTable<YBitBoard>, U8( EColor::kNum )> 
+    CGen::mbbPawnAttacks = CGen::genPawnAttacks();
+constexpr SSquareTable<SRookRays> CGen::mbbRookRays = CGen::genRookRays();
+constexpr SSquareTable<SBishopRays> CGen::mbbBishopRays 
+    = CGen::genBishopRays();
+constexpr SSquarePairTable<YBitBoard> CGen::mbbBetween = CGen::genBetween();
+constexpr SSquarePairTable<YBitBoard> CGen::mbbLine = CGen::genLine();
+constexpr SSquarePairTable<U8> CGen::mDistance = CGen::genDistance();
+constexpr SZobristKeys CGen::mZobrist = CGen::genZobristKeys();
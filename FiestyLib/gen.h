@@ -2,8 +2,9 @@
 ///
 /// Fiesty (C) 2014 by Jeffery A Esposito
 ///
-/// header that was generated.  Run fiesty with the "gen" option and then 
-/// paste the results in here.
+/// header having to do with the generated tables.  The tables are computed 
+/// at compile time by the constexpr generators below, so they are constant
+/// data with no startup cost, and adding a table needs no extra build step.
 ///
 ///
 #ifndef Fiesty_gen_h
@@ -36,7 +37,46 @@ struct SBishopRays
 };
 
 ///
-/// CGen conatains various generated move sets and magics
+/// The random keys that are XORed together into a position's Zobrist hash
+/// key: one for each piece on each square, one for black to move, one for
+/// each combination of castling rights and one for each en passant file.
+///
+struct SZobristKeys
+{
+    YHashKey        mPieceSquare[U8( EPiece::kNum )][CSqix::kNumSquares];
+    YHashKey        mBlackToMove;
+    YHashKey        mCastling[16];
+    YHashKey        mEnPassantFile[U8( EFile::kNum )];
+};
+
+///
+/// A fixed size table that can be built by a constexpr generator, indexed
+/// like a plain array.
+///
+template <typename T, U32 N>
+struct STable
+{
+    T               mEntries[N];
+
+    constexpr const T& operator[]( U32 ix ) const { return mEntries[ix]; }
+    constexpr T& operator[]( U32 ix ) { return mEntries[ix]; }
+};
+
+///
+/// A table with an entry for each square
+///
+template <typename T>
+using SSquareTable = STable<T, CSqix::kNumSquares>;
+
+///
+/// A table with an entry for each pair of squares
+///
+template <typename T>
+using SSquarePairTable = SSquareTable< SSquareTable<T> >;
+
+///
+/// CGen conatains various generated move sets, and the constexpr generators
+/// that build them.
 ///
 class CGen
 {
@@ -44,25 +84,369 @@ public:
     //
     //  For each square, a bit board of the squares a knight attacks
     //
-    static const YBitBoard      mbbKnightAttacks[CSqix::kNumSquares];
+    static const SSquareTable<YBitBoard>        mbbKnightAttacks;
 
     //
     //  For each square, a bit board of the squares a king attacks
     //
-    static const YBitBoard      mbbKingAttacks[CSqix::kNumSquares];
+    static const SSquareTable<YBitBoard>        mbbKingAttacks;
+
+    //
+    //  For each color and square, a bit board of the squares a pawn of that 
+    //  color attacks.
+    //
+    static const STable<SSquareTable<YBitBoard>, U8( EColor::kNum )> 
+                                                mbbPawnAttacks;
 
     //
     //  For each square, a bit board of the ray from that square to the 
     //  edge of the board (not including the indexed square).
     //
-    static const SRookRays      mbbRookRays[CSqix::kNumSquares];
+    static const SSquareTable<SRookRays>        mbbRookRays;
 
     //
     //  For each square, a bit board of the ray from that square to the 
     //  edge of the board (not including the indexed square).
     //
-    static const SBishopRays    mbbBishopRays[CSqix::kNumSquares];
+    static const SSquareTable<SBishopRays>      mbbBishopRays;
+
+    //
+    //  For each pair of squares on a common rank, file or diagonal, the 
+    //  squares strictly between them.  Zero for other pairs.
+    //
+    static const SSquarePairTable<YBitBoard>    mbbBetween;
+
+    //
+    //  For each pair of squares on a common rank, file or diagonal, the 
+    //  whole line through them, edge to edge.  Zero for other pairs.
+    //
+    static const SSquarePairTable<YBitBoard>    mbbLine;
+
+    //
+    //  For each pair of squares, the number of king moves between them
+    //
+    static const SSquarePairTable<U8>           mDistance;
+
+    //
+    //  The Zobrist hashing keys
+    //
+    static const SZobristKeys                   mZobrist;
+
+    ///
+    /// @returns the bit for a rank and file, or zero if it is off the board
+    ///
+    static constexpr YBitBoard squareBit( S8 rank, S8 file )
+    {
+        return ( rank < S8( ERank::kRank1 ) || rank > S8( ERank::kRank8 ) 
+            || file < S8( EFile::kFileA ) || file > S8( EFile::kFileH ) )
+            ? 0ULL
+            : 1ULL << ( 8 * rank + file );
+    }
+
+    ///
+    /// @returns the number of bits set, usable in constant expressions
+    ///
+    static constexpr U8 countBits( YBitBoard bb )
+    {
+        U8 count = 0;
+        for ( ; bb; bb &= bb - 1 )
+            count++;
+        return count;
+    }
+
+    ///
+    /// @returns 
+    ///     the squares from sqix out along a direction, stopping at (and 
+    ///     including) the first occupied square.
+    ///
+    static constexpr YBitBoard genRay( 
+        YSqix sqix, S8 rankDelta, S8 fileDelta, YBitBoard bbOccupied )
+    {
+        YBitBoard bbRay = 0;
+        S8 r = S8( sqix / 8 ) + rankDelta;
+        S8 f = S8( sqix % 8 ) + fileDelta;
+        YBitBoard bb = squareBit( r, f );
+        while ( bb )
+        {
+            bbRay |= bb;
+            if ( bb & bbOccupied )
+                break;
+            r += rankDelta;
+            f += fileDelta;
+            bb = squareBit( r, f );
+        }
+        return bbRay;
+    }
+
+    ///
+    /// @returns 
+    ///     the part of a ray that a slider attacks, up to and including the
+    ///     first blocker.  Positive rays (north, east, north-east and 
+    ///     north-west) run toward higher squares, so their first blocker is 
+    ///     the least significant one; on the others it is the most 
+    ///     significant one.
+    ///
+    static constexpr YBitBoard genRayAttacks( 
+        YBitBoard bbRay, YBitBoard bbOccupied, bool bPositive )
+    {
+        YBitBoard bbBlockers = bbRay & bbOccupied;
+        if ( !bbBlockers )
+            return bbRay;
+        if ( bPositive )
+            return bbRay & ( bbBlockers ^ ( bbBlockers - 1 ) );
+        bbBlockers |= bbBlockers >> 1;
+        bbBlockers |= bbBlockers >> 2;
+        bbBlockers |= bbBlockers >> 4;
+        bbBlockers |= bbBlockers >> 8;
+        bbBlockers |= bbBlockers >> 16;
+        bbBlockers |= bbBlockers >> 32;
+        return bbRay & ~( bbBlockers >> 1 );
+    }
+
+    ///
+    /// @returns 
+    ///     the attack set of a rook or bishop on a square, given the occupied
+    ///     squares.  The attack set includes the blocking squares.
+    ///
+    static constexpr YBitBoard genSliderAttacks( 
+        YSqix sqix, YBitBoard bbOccupied, bool bRook )
+    {
+        return bRook
+            ? genRay( sqix, 1, 0, bbOccupied ) 
+                | genRay( sqix, 0, 1, bbOccupied )
+                | genRay( sqix, -1, 0, bbOccupied ) 
+                | genRay( sqix, 0, -1, bbOccupied )
+            : genRay( sqix, 1, 1, bbOccupied ) 
+                | genRay( sqix, -1, 1, bbOccupied )
+                | genRay( sqix, -1, -1, bbOccupied ) 
+                | genRay( sqix, 1, -1, bbOccupied );
+    }
+
+    ///
+    /// @returns 
+    ///     the squares whose occupancy matters to a rook or bishop on a 
+    ///     square: the empty board attack set, less the board edges that 
+    ///     the slider is not standing on.
+    ///
+    static constexpr YBitBoard genSliderMask( YSqix sqix, bool bRook )
+    {
+        YBitBoard bbEdges = 0;
+        if ( sqix / 8 != U8( ERank::kRank1 ) )
+            bbEdges |= 0x00000000000000FFULL;
+        if ( sqix / 8 != U8( ERank::kRank8 ) )
+            bbEdges |= 0xFF00000000000000ULL;
+        if ( sqix % 8 != U8( EFile::kFileA ) )
+            bbEdges |= 0x0101010101010101ULL;
+        if ( sqix % 8 != U8( EFile::kFileH ) )
+            bbEdges |= 0x8080808080808080ULL;
+        return genSliderAttacks( sqix, 0, bRook ) & ~bbEdges;
+    }
 
+    static constexpr SSquareTable<YBitBoard> genKnightAttacks();
+    static constexpr SSquareTable<YBitBoard> genKingAttacks();
+    static constexpr STable<SSquareTable<YBitBoard>, U8( EColor::kNum )> 
+        genPawnAttacks();
+    static constexpr SSquareTable<SRookRays> genRookRays();
+    static constexpr SSquareTable<SBishopRays> genBishopRays();
+    static constexpr SSquarePairTable<YBitBoard> genBetween();
+    static constexpr SSquarePairTable<YBitBoard> genLine();
+    static constexpr SSquarePairTable<U8> genDistance();
+    static constexpr SZobristKeys genZobristKeys();
+
+    ///
+    /// advances the splitmix64 state and @returns its next random number
+    ///
+    static constexpr U64 nextRandom( U64& rState )
+    {
+        rState += 0x9E3779B97F4A7C15ULL;
+        U64 z = rState;
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+        return z ^ ( z >> 31 );
+    }
 };
 
+///
+/// Generates the knight attacks for each square
+///
+constexpr SSquareTable<YBitBoard> CGen::genKnightAttacks()
+{
+    SSquareTable<YBitBoard> table = {};
+    for ( S8 sq = 0; sq < CSqix::kNumSquares; sq++ )
+    {
+        S8 r = sq / 8;
+        S8 f = sq % 8;
+        table[sq] = squareBit( r + 2, f + 1 ) | squareBit( r + 2, f - 1 )
+            | squareBit( r - 2, f + 1 ) | squareBit( r - 2, f - 1 )
+            | squareBit( r + 1, f + 2 ) | squareBit( r + 1, f - 2 )
+            | squareBit( r - 1, f + 2 ) | squareBit( r - 1, f - 2 );
+    }
+    return table;
+}
+
+///
+/// Generates the king attacks for each square
+///
+constexpr SSquareTable<YBitBoard> CGen::genKingAttacks()
+{
+    SSquareTable<YBitBoard> table = {};
+    for ( S8 sq = 0; sq < CSqix::kNumSquares; sq++ )
+    {
+        S8 r = sq / 8;
+        S8 f = sq % 8;
+        table[sq] = squareBit( r + 1, f - 1 ) | squareBit( r + 1, f )
+            | squareBit( r + 1, f + 1 ) | squareBit( r, f - 1 )
+            | squareBit( r, f + 1 ) | squareBit( r - 1, f - 1 )
+            | squareBit( r - 1, f ) | squareBit( r - 1, f + 1 );
+    }
+    return table;
+}
+
+///
+/// Generates the pawn attacks for each color and square
+///
+constexpr STable<SSquareTable<YBitBoard>, U8( EColor::kNum )> 
+    CGen::genPawnAttacks()
+{
+    STable<SSquareTable<YBitBoard>, U8( EColor::kNum )> table = {};
+    for ( S8 sq = 0; sq < CSqix::kNumSquares; sq++ )
+    {
+        S8 r = sq / 8;
+        S8 f = sq % 8;
+        table[U8( EColor::kWhite )][sq] 
+            = squareBit( r + 1, f - 1 ) | squareBit( r + 1, f + 1 );
+        table[U8( EColor::kBlack )][sq] 
+            = squareBit( r - 1, f - 1 ) | squareBit( r - 1, f + 1 );
+    }
+    return table;
+}
+
+///
+/// Generates the rook rays for each square
+///
+constexpr SSquareTable<SRookRays> CGen::genRookRays()
+{
+    SSquareTable<SRookRays> table = {};
+    for ( YSqix sq = 0; sq < CSqix::kNumSquares; sq++ )
+    {
+        table[sq].mbbNorth = genRay( sq, 1, 0, 0 );
+        table[sq].mbbEast = genRay( sq, 0, 1, 0 );
+        table[sq].mbbSouth = genRay( sq, -1, 0, 0 );
+        table[sq].mbbWest = genRay( sq, 0, -1, 0 );
+    }
+    return table;
+}
+
+///
+/// Generates the bishop rays for each square
+///
+constexpr SSquareTable<SBishopRays> CGen::genBishopRays()
+{
+    SSquareTable<SBishopRays> table = {};
+    for ( YSqix sq = 0; sq < CSqix::kNumSquares; sq++ )
+    {
+        table[sq].mbbNorthEast = genRay( sq, 1, 1, 0 );
+        table[sq].mbbSouthEast = genRay( sq, -1, 1, 0 );
+        table[sq].mbbSouthWest = genRay( sq, -1, -1, 0 );
+        table[sq].mbbNorthWest = genRay( sq, 1, -1, 0 );
+    }
+    return table;
+}
+
+///
+/// Generates the squares between each pair of aligned squares, by walking 
+/// from the first square toward the second, stopping at the second.
+///
+constexpr SSquarePairTable<YBitBoard> CGen::genBetween()
+{
+    SSquarePairTable<YBitBoard> table = {};
+    for ( YSqix from = 0; from < CSqix::kNumSquares; from++ )
+    {
+        for ( S8 dr = -1; dr <= 1; dr++ )
+        {
+            for ( S8 df = -1; df <= 1; df++ )
+            {
+                if ( dr == 0 && df == 0 )
+                    continue;
+                YBitBoard bbRay = genRay( from, dr, df, 0 );
+                for ( YBitBoard bbTo = bbRay; bbTo; bbTo &= bbTo - 1 )
+                {
+                    YBitBoard bbToBit = bbTo & ( 0 - bbTo );
+                    YSqix to = countBits( bbToBit - 1 );
+                    table[from][to] 
+                        = genRay( from, dr, df, bbToBit ) & ~bbToBit;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+///
+/// Generates the full line through each pair of aligned squares
+///
+constexpr SSquarePairTable<YBitBoard> CGen::genLine()
+{
+    SSquarePairTable<YBitBoard> table = {};
+    for ( YSqix from = 0; from < CSqix::kNumSquares; from++ )
+    {
+        for ( S8 dr = -1; dr <= 1; dr++ )
+        {
+            for ( S8 df = -1; df <= 1; df++ )
+            {
+                if ( dr == 0 && df == 0 )
+                    continue;
+                YBitBoard bbLine = genRay( from, dr, df, 0 ) 
+                    | genRay( from, -dr, -df, 0 ) | ( 1ULL << from );
+                YBitBoard bbRay = genRay( from, dr, df, 0 );
+                for ( YBitBoard bbTo = bbRay; bbTo; bbTo &= bbTo - 1 )
+                    table[from][countBits( ( bbTo & ( 0 - bbTo ) ) - 1 )] 
+                        = bbLine;
+            }
+        }
+    }
+    return table;
+}
+
+///
+/// Generates the king distance between each pair of squares
+///
+constexpr SSquarePairTable<U8> CGen::genDistance()
+{
+    SSquarePairTable<U8> table = {};
+    for ( S8 from = 0; from < CSqix::kNumSquares; from++ )
+    {
+        for ( S8 to = 0; to < CSqix::kNumSquares; to++ )
+        {
+            S8 rankDist = from / 8 - to / 8;
+            S8 fileDist = from % 8 - to % 8;
+            rankDist = rankDist < 0 ? -rankDist : rankDist;
+            fileDist = fileDist < 0 ? -fileDist : fileDist;
+            table[from][to] = U8( rankDist > fileDist ? rankDist : fileDist );
+        }
+    }
+    return table;
+}
+
+///
+/// Generates the Zobrist keys from a fixed seed, so that hash keys are the
+/// same from build to build and can be stored.
+///
+constexpr SZobristKeys CGen::genZobristKeys()
+{
+    SZobristKeys keys = {};
+    U64 state = 0x46696573747921ULL;
+    for ( U8 p = 0; p < U8( EPiece::kNum ); p++ )
+    {
+        for ( YSqix sq = 0; sq < CSqix::kNumSquares; sq++ )
+            keys.mPieceSquare[p][sq] = nextRandom( state );
+    }
+    keys.mBlackToMove = nextRandom( state );
+    for ( U8 rights = 0; rights < 16; rights++ )
+        keys.mCastling[rights] = nextRandom( state );
+    for ( U8 file = 0; file < U8( EFile::kNum ); file++ )
+        keys.mEnPassantFile[file] = nextRandom( state );
+    return keys;
+}
+
 #endif
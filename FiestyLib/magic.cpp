@@ -0,0 +1,425 @@
+/// file magic.cpp
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// code having to do with magic move generation
+///
+#include "fiesty.h"
+#include "bitboard.h"
+#include "gen.h"
+#include "magic.h"
+
+//
+//  The magic multipliers, as found by FiestyGen.  They only need to change
+//  if the masks do.
+//
+static constexpr U64 kRookMultipliers[CSqix::kNumSquares] = {
+    /* a1 */ 0x1080004008801020ULL,
+    /* b1 */ 0x840092002c03000ULL,
+    /* c1 */ 0x1900200010400900ULL,
+    /* d1 */ 0x880100008000480ULL,
+    /* e1 */ 0x4200100420080200ULL,
+    /* f1 */ 0x8100020100080400ULL,
+    /* g1 */ 0x200040110886200ULL,
+    /* h1 */ 0x200008040220411ULL,
+    /* a2 */ 0x404800084400220ULL,
+    /* b2 */ 0x401000402000ULL,
+    /* c2 */ 0x86001081220440ULL,
+    /* d2 */ 0x408800800100280ULL,
+    /* e2 */ 0xa001201040820ULL,
+    /* f2 */ 0x8848800200840080ULL,
+    /* g2 */ 0x4001000100040200ULL,
+    /* h2 */ 0x442000102105084ULL,
+    /* a3 */ 0x9080010020804100ULL,
+    /* b3 */ 0x40404000201009ULL,
+    /* c3 */ 0x808010002009ULL,
+    /* d3 */ 0x2200090021d00100ULL,
+    /* e3 */ 0x8008008040080ULL,
+    /* f3 */ 0x4004002010040ULL,
+    /* g3 */ 0x11040008015042ULL,
+    /* h3 */ 0xa0001768104ULL,
+    /* a4 */ 0x800080204009ULL,
+    /* b4 */ 0x2010004140002001ULL,
+    /* c4 */ 0x9800200280100080ULL,
+    /* d4 */ 0x1000100080080080ULL,
+    /* e4 */ 0x442000a00049020ULL,
+    /* f4 */ 0x2100040080020080ULL,
+    /* g4 */ 0x800120400900148ULL,
+    /* h4 */ 0x10040a00128541ULL,
+    /* a5 */ 0x2800804000800030ULL,
+    /* b5 */ 0x1010002000400041ULL,
+    /* c5 */ 0x4000200011004100ULL,
+    /* d5 */ 0x610008410800800ULL,
+    /* e5 */ 0x400802402800800ULL,
+    /* f5 */ 0xc100020080800400ULL,
+    /* g5 */ 0x2000802000401ULL,
+    /* h5 */ 0x182085882000401ULL,
+    /* a6 */ 0x220204000808000ULL,
+    /* b6 */ 0x2860100040024022ULL,
+    /* c6 */ 0x1002004110040ULL,
+    /* d6 */ 0x99101042000a0020ULL,
+    /* e6 */ 0x4080004008080ULL,
+    /* f6 */ 0x10040002008080ULL,
+    /* g6 */ 0x2012004881020004ULL,
+    /* h6 */ 0x8300842444820011ULL,
+    /* a7 */ 0x88403882010200ULL,
+    /* b7 */ 0x820400080210100ULL,
+    /* c7 */ 0x110910040a00300ULL,
+    /* d7 */ 0x801100280080480ULL,
+    /* e7 */ 0x242009008200600ULL,
+    /* f7 */ 0x1002000489500200ULL,
+    /* g7 */ 0x40800200010080ULL,
+    /* h7 */ 0x91800041000080ULL,
+    /* a8 */ 0x209300488001ULL,
+    /* b8 */ 0x4c1002414824001ULL,
+    /* c8 */ 0x20020000b001041ULL,
+    /* d8 */ 0x7000100004200901ULL,
+    /* e8 */ 0x8002002004100802ULL,
+    /* f8 */ 0x30010002084c0007ULL,
+    /* g8 */ 0x888221800813004ULL,
+    /* h8 */ 0x4000002840840112ULL };
+
+static constexpr U64 kBishopMultipliers[CSqix::kNumSquares] = {
+    /* a1 */ 0xa010041108003100ULL,
+    /* b1 */ 0x6082020a002900ULL,
+    /* c1 */ 0x6810010619200000ULL,
+    /* d1 */ 0x8281a0520000408ULL,
+    /* e1 */ 0x1104001000400ULL,
+    /* f1 */ 0x18901008048400ULL,
+    /* g1 */ 0x40a0210245280ULL,
+    /* h1 */ 0x200210808a402ULL,
+    /* a2 */ 0x9140048410821200ULL,
+    /* b2 */ 0x800091010820041ULL,
+    /* c2 */ 0x20504804832202c0ULL,
+    /* d2 */ 0x100091401081000ULL,
+    /* e2 */ 0x8021011140000012ULL,
+    /* f2 */ 0x810020804450400ULL,
+    /* g2 */ 0x208b0542109008a2ULL,
+    /* h2 */ 0x80084a08040204ULL,
+    /* a3 */ 0x40e2a80811244cULL,
+    /* b3 */ 0x2505022008008108ULL,
+    /* c3 */ 0x430220100420040ULL,
+    /* d3 */ 0x10a040420220040ULL,
+    /* e3 */ 0x1105000290400000ULL,
+    /* f3 */ 0x93001200822120ULL,
+    /* g3 */ 0x4000a62048043004ULL,
+    /* h3 */ 0x280120048a015004ULL,
+    /* a4 */ 0x6090002a020814ULL,
+    /* b4 */ 0x44042000240800d0ULL,
+    /* c4 */ 0x1102800040a4400ULL,
+    /* d4 */ 0x1004080080220040ULL,
+    /* e4 */ 0x1001011004024ULL,
+    /* f4 */ 0x10044000805040ULL,
+    /* g4 */ 0x914041200820100ULL,
+    /* h4 */ 0x4821012821480ULL,
+    /* a5 */ 0x24040500c05021ULL,
+    /* b5 */ 0x88611002080200ULL,
+    /* c5 */ 0x116080a00040020ULL,
+    /* d5 */ 0x4000020080080080ULL,
+    /* e5 */ 0x2450450140840040ULL,
+    /* f5 */ 0x880201484100ULL,
+    /* g5 */ 0x222020404020092ULL,
+    /* h5 */ 0x8081110600002e00ULL,
+    /* a6 */ 0x2842101105000801ULL,
+    /* b6 */ 0x1100809008001025ULL,
+    /* c6 */ 0x20202221c0400ULL,
+    /* d6 */ 0x422014022009020ULL,
+    /* e6 */ 0x210046102100c00ULL,
+    /* f6 */ 0xc004008082029102ULL,
+    /* g6 */ 0xaa461801101200ULL,
+    /* h6 */ 0x404080080201108ULL,
+    /* a7 */ 0x20542108c205002ULL,
+    /* b7 */ 0x410544804100100ULL,
+    /* c7 */ 0x40910841100000ULL,
+    /* d7 */ 0x400200042021100ULL,
+    /* e7 */ 0x4204850400c0ULL,
+    /* f7 */ 0x200100410a42102ULL,
+    /* g7 */ 0x1040020801210102ULL,
+    /* h7 */ 0x805040410420000ULL,
+    /* a8 */ 0x2884804130100200ULL,
+    /* b8 */ 0x800c262201242000ULL,
+    /* c8 */ 0x1058000194108800ULL,
+    /* d8 */ 0x14221054420204ULL,
+    /* e8 */ 0x104000012a02200ULL,
+    /* f8 */ 0x200881003300100ULL,
+    /* g8 */ 0x140400202840100ULL,
+    /* h8 */ 0x402020801010201ULL };
+
+///
+/// Generates the magic keys for each square.  The masks and shifts come 
+/// from the rays, the offsets pack the squares' slices end to end.
+///
+/// @param multipliers
+///     the magic multiplier for each square
+///
+/// @param bRook
+///     true to generate the rook keys, false for the bishop keys
+///
+/// @param offset
+///     where the first square's slice starts in the attack table
+///
+constexpr SSquareTable<CMagicKey> CMagic::genKeys( 
+    const U64       multipliers[], 
+    bool            bRook, 
+    U32             offset )
+{
+    SSquareTable<CMagicKey> keys = {};
+    for ( YSqix sq = 0; sq < CSqix::kNumSquares; sq++ )
+    {
+        YBitBoard bbMask = CGen::genSliderMask( sq, bRook );
+        U8 numBits = CGen::countBits( bbMask );
+        keys[sq].mbbMask = bbMask;
+        keys[sq].mMultiplier = multipliers[sq];
+        keys[sq].mOffset = offset;
+        keys[sq].mShift = 64 - numBits;
+        offset += 1U << numBits;
+    }
+    return keys;
+}
+
+//
+//  The rook slices come first in the attack tables, followed by the bishop
+//  slices.
+//
+constexpr SSquareTable<CMagicKey> CMagic::mRookMagicKeys 
+    = CMagic::genKeys( kRookMultipliers, true, 0 );
+constexpr SSquareTable<CMagicKey> CMagic::mBishopMagicKeys 
+    = CMagic::genKeys( kBishopMultipliers, false, CMagic::kNumRookAttacks );
+
+///
+/// Fills the slices of an attack table for a set of keys, by cutting the
+/// rays off at the first blocker for every subset of each square's mask.
+///
+/// @param rTable
+///     the table to fill
+///
+/// @param keys
+///     the magic keys for the 64 squares
+///
+/// @param bRook
+///     true if the keys are for rooks, false if they are for bishops
+///
+/// @param backend
+///     kMagic or kPext, which determines how each slice is indexed
+///
+constexpr void CMagic::genKeyAttacks( 
+    SAttackTable&                       rTable,
+    const SSquareTable<CMagicKey>&      keys, 
+    bool                                bRook, 
+    ESliderBackend                      backend )
+{
+    SSquareTable<SRookRays> rookRays = CGen::genRookRays();
+    SSquareTable<SBishopRays> bishopRays = CGen::genBishopRays();
+
+    for ( YSqix sq = 0; sq < CSqix::kNumSquares; sq++ )
+    {
+        //
+        //  The carry-rippler trick enumerates the subsets of the mask in 
+        //  the order of their extracted bits, so the nth subset is at pext 
+        //  index n.
+        //
+        const CMagicKey& key = keys[sq];
+        YBitBoard bbSubset = 0;
+        U32 pextIndex = 0;
+        do
+        {
+            U32 index = ( backend == ESliderBackend::kPext )
+                ? pextIndex
+                : U32( ( bbSubset * key.mMultiplier ) >> key.mShift );
+            rTable[key.mOffset + index] = bRook
+                ? CGen::genRayAttacks( 
+                        rookRays[sq].mbbNorth, bbSubset, true )
+                    | CGen::genRayAttacks( 
+                        rookRays[sq].mbbEast, bbSubset, true )
+                    | CGen::genRayAttacks( 
+                        rookRays[sq].mbbSouth, bbSubset, false )
+                    | CGen::genRayAttacks( 
+                        rookRays[sq].mbbWest, bbSubset, false )
+                : CGen::genRayAttacks( 
+                        bishopRays[sq].mbbNorthEast, bbSubset, true )
+                    | CGen::genRayAttacks( 
+                        bishopRays[sq].mbbNorthWest, bbSubset, true )
+                    | CGen::genRayAttacks( 
+                        bishopRays[sq].mbbSouthEast, bbSubset, false )
+                    | CGen::genRayAttacks( 
+                        bishopRays[sq].mbbSouthWest, bbSubset, false );
+            bbSubset = ( bbSubset - key.mbbMask ) & key.mbbMask;
+            pextIndex++;
+        } while ( bbSubset );
+    }
+}
+
+///
+/// Generates a whole attack table, laid out for a backend
+///
+constexpr CMagic::SAttackTable CMagic::genAttacks( ESliderBackend backend )
+{
+    SAttackTable table = {};
+    genKeyAttacks( table, mRookMagicKeys, true, backend );
+    genKeyAttacks( table, mBishopMagicKeys, false, backend );
+    return table;
+}
+
+constexpr CMagic::SAttackTable CMagic::mbbMagicAttacks 
+    = CMagic::genAttacks( ESliderBackend::kMagic );
+constexpr CMagic::SAttackTable CMagic::mbbPextAttacks 
+    = CMagic::genAttacks( ESliderBackend::kPext );
+
+//
+//  statics
+//
+ESliderBackend CMagic::mgBackend = ESliderBackend::kRays;
+const char* CMagic::kBackendStrs[U8( ESliderBackend::kNum )] = 
+    { "rays", "magic", "pext" };
+
+//
+//  Picks the backend before main runs, so the lookups are ready before the
+//  first position is set up.
+//
+static struct SMagicInit
+{
+    SMagicInit() { CMagic::init(); }
+} gMagicInit;
+
+///
+/// Picks the fastest slider backend the CPU supports.
+///
+void CMagic::init()
+{
+    setBackend( hasFastPext() 
+        ? ESliderBackend::kPext : ESliderBackend::kMagic );
+}
+
+///
+/// @returns true if the CPU supports the BMI2 instructions (pext).  
+///
+bool CMagic::hasBmi2()
+{
+    int regs[4];                        // eax, ebx, ecx, edx
+
+    __cpuid( regs, 0 );
+    if ( regs[0] < 7 )
+        return false;
+    __cpuidex( regs, 7, 0 );
+    return ( regs[1] & ( 1 << 8 ) ) != 0;
+}
+
+///
+/// @returns 
+///     true if the CPU has pext, and runs it in hardware.  AMD CPUs before
+///     Zen 3 (family 19h) run it in microcode, taking a long time that 
+///     grows with the bits in the mask, so they are better off with magic.
+///
+bool CMagic::hasFastPext()
+{
+    int regs[4];                        // eax, ebx, ecx, edx
+
+    if ( !hasBmi2() )
+        return false;
+    __cpuid( regs, 0 );
+    bool bAmd = regs[1] == 0x68747541   // "Auth"
+        && regs[3] == 0x69746e65        // "enti"
+        && regs[2] == 0x444d4163;       // "cAMD"
+    if ( !bAmd )
+        return true;
+    __cpuid( regs, 1 );
+    int family = ( regs[0] >> 8 ) & 0xf;
+    if ( family == 0xf )
+        family += ( regs[0] >> 20 ) & 0xff;
+    return family >= 0x19;
+}
+
+///
+/// Selects the backend that answers the slider attack lookups.  This must 
+/// not be called while another thread is generating moves.
+///
+/// @param backend
+///     the backend to use.  Asking for kPext on a CPU without BMI2 gets
+///     kMagic instead.
+///
+void CMagic::setBackend( ESliderBackend backend )
+{
+    if ( backend == ESliderBackend::kPext && !hasBmi2() )
+        backend = ESliderBackend::kMagic;
+    mgBackend = backend;
+}
+
+///
+/// @returns the name of a slider backend
+///
+std::string CMagic::backendAsStr( ESliderBackend backend )
+{
+    return kBackendStrs[U8( backend )];
+}
+
+///
+/// @returns 
+///     the squares a bishop on sqix attacks, found by walking the rays 
+///     out to the first blocker in each direction.
+///
+CBitBoard CMagic::bishopAttacksByRays( CSqix sqix, CBitBoard bbOccupied )
+{
+    const SBishopRays& rays = CGen::mbbBishopRays[sqix.get()];
+    CBitBoard bbNorthEastRay = rays.mbbNorthEast;
+    CBitBoard bbSouthEastRay = rays.mbbSouthEast;
+    CBitBoard bbSouthWestRay = rays.mbbSouthWest;
+    CBitBoard bbNorthWestRay = rays.mbbNorthWest;
+    CBitBoard bbOccRay;
+
+    //
+    //  For each of the rays, find the blocker (if any) and mask off
+    //  the squares beyond the blocker.
+    //
+    if ( ( bbOccRay = bbNorthEastRay.get() & bbOccupied.get() ).get() )
+    {
+        bbNorthEastRay 
+            ^= CGen::mbbBishopRays[bbOccRay.lsb().get()].mbbNorthEast;
+    }
+    if ( ( bbOccRay = bbSouthEastRay.get() & bbOccupied.get() ).get() )
+    {
+        bbSouthEastRay 
+            ^= CGen::mbbBishopRays[bbOccRay.msb().get()].mbbSouthEast;
+    }
+    if ( ( bbOccRay = bbSouthWestRay.get() & bbOccupied.get() ).get() )
+    {
+        bbSouthWestRay 
+            ^= CGen::mbbBishopRays[bbOccRay.msb().get()].mbbSouthWest;
+    }
+    if ( ( bbOccRay = bbNorthWestRay.get() & bbOccupied.get() ).get() )
+    {
+        bbNorthWestRay 
+            ^= CGen::mbbBishopRays[bbOccRay.lsb().get()].mbbNorthWest;
+    }
+    return bbNorthEastRay.get() | bbSouthEastRay.get() 
+        | bbSouthWestRay.get() | bbNorthWestRay.get();
+}
+
+///
+/// @returns 
+///     the squares a rook on sqix attacks, found by walking the rays out
+///     to the first blocker in each direction.
+///
+CBitBoard CMagic::rookAttacksByRays( CSqix sqix, CBitBoard bbOccupied )
+{
+    const SRookRays& rays = CGen::mbbRookRays[sqix.get()];
+    CBitBoard bbNorthRay = rays.mbbNorth;
+    CBitBoard bbEastRay = rays.mbbEast;
+    CBitBoard bbSouthRay = rays.mbbSouth;
+    CBitBoard bbWestRay = rays.mbbWest;
+    CBitBoard bbOccRay;
+
+    //
+    //  For each of the rays, find the blocker (if any) and mask off
+    //  the squares beyond the blocker.
+    //
+    if ( ( bbOccRay = bbNorthRay.get() & bbOccupied.get() ).get() )
+        bbNorthRay ^= CGen::mbbRookRays[bbOccRay.lsb().get()].mbbNorth;
+    if ( ( bbOccRay = bbEastRay.get() & bbOccupied.get() ).get() )
+        bbEastRay ^= CGen::mbbRookRays[bbOccRay.lsb().get()].mbbEast;
+    if ( ( bbOccRay = bbSouthRay.get() & bbOccupied.get() ).get() )
+        bbSouthRay ^= CGen::mbbRookRays[bbOccRay.msb().get()].mbbSouth;
+    if ( ( bbOccRay = bbWestRay.get() & bbOccupied.get() ).get() )
+        bbWestRay ^= CGen::mbbRookRays[bbOccRay.msb().get()].mbbWest;
+    return bbNorthRay.get() | bbEastRay.get() 
+        | bbSouthRay.get() | bbWestRay.get();
+}
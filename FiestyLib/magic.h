@@ -9,31 +9,137 @@
 #include "fiesty.h"
 #include "square.h"
 #include "bitboard.h"
+#include "gen.h"
 
 ///
-/// Contains the information needed to generate the keyes into each square's
-/// magic hash table.
+/// The ways that slider attacks can be looked up.  kPext and kMagic index 
+/// attack tables with the same per-square slices, each laid out for its own
+/// indexing.  kRays walks the CGen rays and needs no table at all.
+///
+enum class ESliderBackend : std::uint8_t { kRays, kMagic, kPext, kNum };
+
+///
+/// Contains the information needed to generate the keys into each square's
+/// slice of the shared magic attack table.  The key is the occupied squares
+/// in the mask, multiplied by the magic multiplier, shifted down to the 
+/// number of bits in the mask.
 ///
 class CMagicKey
 {
-    const CBitBoard         mbbRayMask;
-    std::uint64_t           mMultipier;
+public:
+    YBitBoard               mbbMask;
+    U64                     mMultiplier;
+    U32                     mOffset;
+    U8                      mShift;
+
+    ///
+    /// @returns 
+    ///     the index into the shared attack table for the occupancy, when
+    ///     the table is laid out for multiply-shift magics.
+    ///
+    U32 getIndex( CBitBoard bbOccupied ) const
+    {
+        return mOffset + U32( 
+            ( ( bbOccupied.get() & mbbMask ) * mMultiplier ) >> mShift );
+    }
+
+    ///
+    /// @returns 
+    ///     the index into the shared attack table for the occupancy, when
+    ///     the table is laid out for BMI2 parallel bit extraction.  
+    ///
+    U32 getPextIndex( CBitBoard bbOccupied ) const
+    {
+        return mOffset + U32( _pext_u64( bbOccupied.get(), mbbMask ) );
+    }
 };
 
 ///
-/// The generated magic data
+/// The generated magic data, and the attack lookups that use it.  The attack
+/// sets include the squares of the blocking pieces, so captures are found by 
+/// masking with the opponent's pieces and quiet moves by masking with the 
+/// unoccupied squares.
+///
+/// The lookups are the one interface that move generation and check 
+/// detection use.  Which backend answers them is picked by init() from the
+/// CPU's feature flags, and can be overridden with setBackend().  The 
+/// lookups are inlined, and branch on the backend, which is only set at 
+/// startup or by the tests, so the branch always goes the same way.
+///
+/// Only the multipliers are literals.  The keys and both attack table 
+/// layouts are computed from them at compile time.
 ///
 class CMagic
 {
-    const U8        mkRookHashKeyBits       = 12;
-    const U16       mkRookHashEntries       = 2 ^ mkRookHashKeyBits;
-    const U8        mkBishopHashKeyBits     = 12;
-    const U16       mkBishopHashEntries     = 2 ^ mkBishopHashKeyBits;
-
-    const CMagicKey mRookMagicKeys[CSqix::kNumSquares];
-    const CMagicKey mBishopMagicKeys[CSqix::kNumSquares];
-    const CBitBoard mbbRookAttacks[CSqix::kNumSquares][mkRookHashEntries];
-    const CBitBoard mbbBishopAttacks[CSqix::kNumSquares][mkBishopHashEntries];
+public:
+    static const U32        kNumRookAttacks         = 102400;
+    static const U32        kNumBishopAttacks       = 5248;
+    static const U32        kNumAttacks 
+        = kNumRookAttacks + kNumBishopAttacks;
+
+    static void init();
+    static bool hasBmi2();
+    static bool hasFastPext();
+    static ESliderBackend getBackend() { return mgBackend; }
+    static void setBackend( ESliderBackend backend );
+    static std::string backendAsStr( ESliderBackend backend );
+
+    ///
+    /// @returns the squares a rook on sqix attacks
+    ///
+    static CBitBoard rookAttacks( CSqix sqix, CBitBoard bbOccupied )
+    {
+        const CMagicKey& key = mRookMagicKeys[sqix.get()];
+        if ( mgBackend == ESliderBackend::kMagic )
+            return mbbMagicAttacks[key.getIndex( bbOccupied )];
+        if ( mgBackend == ESliderBackend::kPext )
+            return mbbPextAttacks[key.getPextIndex( bbOccupied )];
+        return rookAttacksByRays( sqix, bbOccupied );
+    }
+
+    ///
+    /// @returns the squares a bishop on sqix attacks
+    ///
+    static CBitBoard bishopAttacks( CSqix sqix, CBitBoard bbOccupied )
+    {
+        const CMagicKey& key = mBishopMagicKeys[sqix.get()];
+        if ( mgBackend == ESliderBackend::kMagic )
+            return mbbMagicAttacks[key.getIndex( bbOccupied )];
+        if ( mgBackend == ESliderBackend::kPext )
+            return mbbPextAttacks[key.getPextIndex( bbOccupied )];
+        return bishopAttacksByRays( sqix, bbOccupied );
+    }
+
+    ///
+    /// @returns the squares a queen on sqix attacks
+    ///
+    static CBitBoard queenAttacks( CSqix sqix, CBitBoard bbOccupied )
+    {
+        return rookAttacks( sqix, bbOccupied ).get() 
+            | bishopAttacks( sqix, bbOccupied ).get();
+    }
+
+    static CBitBoard rookAttacksByRays( CSqix sqix, CBitBoard bbOccupied );
+    static CBitBoard bishopAttacksByRays( CSqix sqix, CBitBoard bbOccupied );
+
+private:
+    typedef STable<YBitBoard, kNumAttacks> SAttackTable;
+
+    static constexpr SSquareTable<CMagicKey> genKeys( 
+        const U64 multipliers[], bool bRook, U32 offset );
+    static constexpr SAttackTable genAttacks( ESliderBackend backend );
+    static constexpr void genKeyAttacks( 
+        SAttackTable&                       rTable,
+        const SSquareTable<CMagicKey>&      keys, 
+        bool                                bRook, 
+        ESliderBackend                      backend );
+
+    static const SSquareTable<CMagicKey>    mRookMagicKeys;
+    static const SSquareTable<CMagicKey>    mBishopMagicKeys;
+    static const SAttackTable               mbbMagicAttacks;
+    static const SAttackTable               mbbPextAttacks;
+    static ESliderBackend                   mgBackend;
+    static const char*  kBackendStrs[U8( ESliderBackend::kNum )];
 };
 
 #endif
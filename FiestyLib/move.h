@@ -12,51 +12,116 @@
 #include "square.h"
 
 ///
-/// Class that represents a chess move, containg the from and 
-/// to squares and the promotion piece if any.  
-//
-/// mFrom and mTo each take 6 bits. Promo takes 3 bits.
+/// Class that represents a chess move in 16 bits: the from and to squares
+/// and the kind of move, so that making, ordering and storing a move need 
+/// not look at the board to find out what it does.
+///
+/// Bits 0-5 are the from square, bits 6-11 the to square and bits 12-15 
+/// the kind.  Bit 14 is set for every capture, including en passant, and 
+/// bit 15 for every promotion, which keeps the promotion piece less one in
+/// bits 12-13.
 ///
 class CMove
 {
 public:
+    enum EKind : U8
+    {
+        kQuiet          = 0,
+        kDoublePush     = 1,
+        kCastle         = 2,
+        kCapture        = 4,
+        kEnPassant      = 5,
+        kPromo          = 8,
+        kPromoCapture   = 12
+    };
+
     CMove() {}
 
-    CMove( CSqix f, CSqix t, CPieceType p ) 
+    CMove( CSqix f, CSqix t, EKind kind = kQuiet ) 
     {
-        mFrom = f.get(); 
-        mTo = t.get();
-        setPromo( p );
+        mMove = U16( f.get() | ( t.get() << 6 ) | ( kind << 12 ) );
     }
 
-    CMove( CSqix f, CSqix t ) 
+    ///
+    /// constructs a promotion, which also captures if bCapture is set
+    ///
+    CMove( CSqix f, CSqix t, CPieceType promo, bool bCapture = false ) 
     {
-        mFrom = f.get(); 
-        mTo = t.get(); 
-        mbIsPromo = false;
+        mMove = U16( f.get() | ( t.get() << 6 ) 
+            | ( ( bCapture ? kPromoCapture : kPromo ) << 12 )
+            | ( ( U8( promo.get() ) - 1 ) << 12 ) );
     }
 
-    CSqix getFrom() const { return mFrom; }
-    CSqix getTo() const { return mTo; }
-    CPieceType getPromo() const { return EPieceType( mPromoMinus1 + 1 ); }
-    bool isPromo() const { return mbIsPromo; }
-    void setFrom( CSqix s ) { mFrom = s.get(); }
-    void setTo( CSqix s ) { mTo = s.get(); }
-    void setPromo( CPieceType pt ) 
+    ///
+    /// @returns the null move, a1a1, which never occurs in a position and 
+    /// stands for "no move" in the hash, killer and counter-move slots.
+    ///
+    static CMove null() { return CMove( CSqix( 0 ), CSqix( 0 ) ); }
+    bool isNull() const { return ( ( mMove ^ ( mMove >> 6 ) ) & 0x3F ) == 0; }
+
+    bool operator==( CMove m ) const { return mMove == m.mMove; }
+    bool operator!=( CMove m ) const { return mMove != m.mMove; }
+
+    ///
+    /// @returns the move as its 16 bits, for storing in tables
+    ///
+    U16 asU16() const { return mMove; }
+
+    ///
+    /// @returns the move stored by asU16
+    ///
+    static CMove fromU16( U16 packed ) 
+    {
+        CMove m;
+        m.mMove = packed;
+        return m;
+    }
+
+    CSqix getFrom() const { return CSqix( mMove & 0x3F ); }
+    CSqix getTo() const { return CSqix( ( mMove >> 6 ) & 0x3F ); }
+
+    ///
+    /// @returns the kind of move, with the promotion piece masked off
+    ///
+    EKind getKind() const 
     { 
-        mPromoMinus1 = U8( pt.get() ) - 1; 
-        mbIsPromo = 1;
+        return EKind( isPromo() ? ( mMove >> 12 ) & 0xC : mMove >> 12 );
+    }
+    bool isCapture() const { return ( mMove & kCaptureBit ) != 0; }
+    bool isPromo() const { return ( mMove & kPromoBit ) != 0; }
+    bool isEnPassant() const { return ( mMove >> 12 ) == kEnPassant; }
+    bool isCastle() const { return ( mMove >> 12 ) == kCastle; }
+    bool isDoublePush() const { return ( mMove >> 12 ) == kDoublePush; }
+    CPieceType getPromo() const 
+    { 
+        return EPieceType( ( ( mMove >> 12 ) & 3 ) + 1 ); 
     }
 
     std::string asAbbr() const;
     std::string asStr() const { return asAbbr(); }
 
 private:
-    std::uint16_t       mPromoMinus1    : 2;
-    std::uint16_t       mFrom           : 6;
-    std::uint16_t       mbIsPromo       : 1;
-    std::uint16_t       mFiller         : 1;
-    std::uint16_t       mTo             : 6;
+    static const U16    kCaptureBit = 0x4000;
+    static const U16    kPromoBit = 0x8000;
+
+    U16                 mMove;
+};
+
+///
+/// A move with the 16 bit key the move picker orders it by, higher first
+///
+class CScoredMove
+{
+public:
+    CScoredMove() {}
+    CScoredMove( CMove m, U16 key ) { mMove = m; mKey = key; }
+
+    CMove getMove() const { return mMove; }
+    U16 getKey() const { return mKey; }
+
+private:
+    CMove               mMove;
+    U16                 mKey;
 };
 
 //
@@ -72,7 +137,8 @@ public:
 
     void addMove( CMove m ) { mMoves[mNumMoves++] = m; }
     U8 getNumMoves() const { return mNumMoves; }
-    CMove get( U16 ix ) { return mMoves[ix]; }
+    CMove get( U16 ix ) const { return mMoves[ix]; }
+    void swap( U16 ix1, U16 ix2 ) { std::swap( mMoves[ix1], mMoves[ix2] ); }
 
     std::string asStr() const { return asAbbr(); }
     std::string asAbbr() const;
@@ -82,6 +148,28 @@ private:
     CMove                   mMoves[kMaxMoves + 1];
 };
 
+//
+//  A collection of moves with their sort keys
+//
+class CScoredMoves 
+{
+public:
+    CScoredMoves() { mNumMoves = 0; }
+    void reset() { mNumMoves = 0; }
+
+    void addMove( CMove m, U16 key ) 
+    { 
+        mMoves[mNumMoves++] = CScoredMove( m, key ); 
+    }
+    U8 getNumMoves() const { return mNumMoves; }
+    CScoredMove get( U16 ix ) const { return mMoves[ix]; }
+    void swap( U16 ix1, U16 ix2 ) { std::swap( mMoves[ix1], mMoves[ix2] ); }
+
+private:
+    std::uint8_t            mNumMoves;
+    CScoredMove             mMoves[CMoves::kMaxMoves + 1];
+};
+
 ///
 ///  the moves in a game or a line
 ///
@@ -0,0 +1,493 @@
+/// file movepicker.cpp
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// code having to do with ordering the moves tried by the search
+///
+///
+#include "fiesty.h"
+#include "movepicker.h"
+
+//
+//  Rough piece values used only to order captures, indexed by EPieceType.
+//  The king is worth nothing as a capturer, since a king capture that
+//  could be answered is illegal anyway.
+//
+static const S32 kOrderValues[U8( EPieceType::kNum )] =
+    { 100, 320, 330, 500, 900, 0 };
+
+//
+//  The sort keys are 16 bits.  Quiet queen promotions get the top key, 
+//  ahead of every other quiet move, and under-promotions the bottom one.  
+//  Evasions put the hash move first, then the captures of the checker, 
+//  then the king moves and blocks, whose history keys stay below 0x8000.
+//
+static const U16 kTopKey = 0xFFFF;
+static const U16 kBottomKey = 0;
+static const U16 kEvasionCaptureKey = 0xC000;
+
+///
+/// forgets all the killers, counter-moves and history scores
+///
+void CMoveHistory::clear()
+{
+    for ( U16 ply = 0; ply < kMaxPly; ply++ )
+        mKillers[ply][0] = mKillers[ply][1] = CMove::null();
+    for ( U8 p = 0; p < U8( EPiece::kNum ); p++ )
+    {
+        for ( U8 sqix = 0; sqix < CSqix::kNumSquares; sqix++ )
+            mCounterMoves[p][sqix] = CMove::null();
+    }
+    for ( U8 c = 0; c < U8( EColor::kNum ); c++ )
+    {
+        for ( U8 from = 0; from < CSqix::kNumSquares; from++ )
+        {
+            for ( U8 to = 0; to < CSqix::kNumSquares; to++ )
+                mHistory[c][from][to] = 0;
+        }
+    }
+}
+
+///
+/// remembers a quiet move that caused a beta cutoff.  Captures are
+/// ignored, since the picker orders them on their own.
+///
+/// @param rPos
+///     is the position before the move is made
+///
+/// @param m
+///     is the move that cut off
+///
+/// @param prevMove
+///     is the move that led to rPos, or the null move at the root
+///
+/// @param ply
+///     is the distance of rPos from the root
+///
+/// @param depthLeft
+///     is the remaining depth, deeper cutoffs count for more
+///
+void CMoveHistory::onCutoff(
+    const CPos&     rPos,
+    CMove           m,
+    CMove           prevMove,
+    U16             ply,
+    U16             depthLeft )
+{
+    if ( m.isCapture() )
+        return;
+
+    if ( ply < kMaxPly && mKillers[ply][0] != m )
+    {
+        mKillers[ply][1] = mKillers[ply][0];
+        mKillers[ply][0] = m;
+    }
+
+    if ( !prevMove.isNull() )
+    {
+        CPiece prevPiece = rPos.getPiece( prevMove.getTo().get() );
+        if ( prevPiece.isValid() )
+        {
+            mCounterMoves[U8( prevPiece.get() )][prevMove.getTo().get()]
+                = m;
+        }
+    }
+
+    //
+    //  Halve every score of the color once one gets too big, so that old
+    //  cutoffs fade and the scores can't overflow.
+    //
+    U8 c = U8( rPos.getWhoseMove().get() );
+    S32& rHistory = mHistory[c][m.getFrom().get()][m.getTo().get()];
+    rHistory += S32( depthLeft ) * depthLeft;
+    if ( rHistory > kMaxHistory )
+    {
+        for ( U8 from = 0; from < CSqix::kNumSquares; from++ )
+        {
+            for ( U8 to = 0; to < CSqix::kNumSquares; to++ )
+                mHistory[c][from][to] /= 2;
+        }
+    }
+}
+
+///
+/// constructs a picker for the side to move in a position.  Only the 
+/// checkers are found here, nothing is generated until next is called.
+///
+/// @param rHistory
+///     supplies the killers, counter-move and history scores
+///
+/// @param hashMove
+///     is the move from the transposition table, or the null move
+///
+/// @param ply
+///     is the distance from the root, used to look up the killers
+///
+/// @param prevMove
+///     is the move that led to rPos, or the null move at the root
+///
+CMovePicker::CMovePicker(
+    CPos&                   rPos,
+    const CMoveHistory&     rHistory,
+    CMove                   hashMove,
+    U16                     ply,
+    CMove                   prevMove )
+    : mrPos( rPos ), mrHistory( rHistory )
+{
+    mStage = kHashMove;
+    mbCapturesOnly = false;
+    mHashMove = hashMove;
+    mKillers[0] = ply < CMoveHistory::kMaxPly
+        ? rHistory.getKiller( ply, 0 ) : CMove::null();
+    mKillers[1] = ply < CMoveHistory::kMaxPly
+        ? rHistory.getKiller( ply, 1 ) : CMove::null();
+    mCounterMove = prevMove.isNull()
+        ? CMove::null()
+        : rHistory.getCounterMove(
+            rPos.getPiece( prevMove.getTo().get() ), prevMove.getTo() );
+    mNextIx = 0;
+    mNextLosingIx = 0;
+
+    if ( rPos.getWhoseMove().isWhite() )
+        rPos.findCheckers<EColor::kBlack>();
+    else
+        rPos.findCheckers<EColor::kWhite>();
+    if ( rPos.getCheckers().get() )
+        mStage = kGenEvasions;
+}
+
+///
+/// constructs a picker for the quiescence search, which hands out only the
+/// captures that don't lose material by static exchange, or every evasion
+/// when in check.  The losing captures are still generated and scored,
+/// but never handed out.
+///
+/// @param rHistory
+///     is only needed for ordering the evasions
+///
+/// @param hashMove
+///     is the move from the transposition table, or the null move.  It is
+///     only tried if it is a capture.
+///
+CMovePicker::CMovePicker(
+    CPos&                   rPos,
+    const CMoveHistory&     rHistory,
+    CMove                   hashMove )
+    : CMovePicker( rPos, rHistory, 
+        hashMove.isCapture() ? hashMove : CMove::null(), 
+        CMoveHistory::kMaxPly, CMove::null() )
+{
+    mbCapturesOnly = true;
+}
+
+///
+/// generates the captures of color C, including promotions that capture
+/// and en passant
+///
+template <EColor C>
+void CMovePicker::genCaptures( CMoves& rMoves )
+{
+    mrPos.genPawnCaptures<C>( rMoves );
+    mrPos.genKnightCaptures<C>( rMoves );
+    mrPos.genBishopCaptures<C>( rMoves );
+    mrPos.genRookCaptures<C>( rMoves );
+    mrPos.genQueenCaptures<C>( rMoves );
+    mrPos.genKingCaptures<C>( rMoves );
+}
+
+///
+/// generates the non-captures of color C, including promotions that don't
+/// capture and castling
+///
+template <EColor C>
+void CMovePicker::genQuiets( CMoves& rMoves )
+{
+    mrPos.genPawnQuiets<C>( rMoves );
+    mrPos.genKnightQuiets<C>( rMoves );
+    mrPos.genBishopQuiets<C>( rMoves );
+    mrPos.genRookQuiets<C>( rMoves );
+    mrPos.genQueenQuiets<C>( rMoves );
+    mrPos.genKingQuiets<C>( rMoves );
+    mrPos.genCastles<C>( rMoves );
+}
+
+///
+/// @returns true if the move was already handed out by an earlier stage
+///
+bool CMovePicker::isSpecial( CMove m ) const
+{
+    return m == mHashMove || m == mKillers[0] || m == mKillers[1]
+        || m == mCounterMove;
+}
+
+///
+/// hands out the best of the moves not handed out yet, by selecting it
+/// rather than sorting, since most nodes only look at the first few.  Of
+/// moves with equal keys the one generated first comes out first.
+///
+/// @param rNextIx
+///     is the index of the first move not handed out yet
+///
+/// @returns
+///     false if there are no moves left
+///
+bool CMovePicker::pickBest( 
+    CScoredMoves&   rMoves, 
+    U16&            rNextIx, 
+    CMove&          rMove )
+{
+    if ( rNextIx >= rMoves.getNumMoves() )
+        return false;
+
+    U16 bestIx = rNextIx;
+    U16 bestKey = rMoves.get( bestIx ).getKey();
+    for ( U16 ix = rNextIx + 1; ix < rMoves.getNumMoves(); ix++ )
+    {
+        if ( rMoves.get( ix ).getKey() > bestKey )
+        {
+            bestIx = ix;
+            bestKey = rMoves.get( ix ).getKey();
+        }
+    }
+    rMoves.swap( rNextIx, bestIx );
+    rMove = rMoves.get( rNextIx++ ).getMove();
+    return true;
+}
+
+///
+/// @returns 
+///     the 16 bit key of a history score, which is kept as is up to 
+///     0x4000 and compressed above that, so that the largest scores stay 
+///     below 0x8000
+///
+U16 CMovePicker::getHistoryKey( S32 history )
+{
+    return U16( history < 0x4000 
+        ? history : 0x4000 + ( ( history - 0x4000 ) >> 10 ) );
+}
+
+///
+/// scores the captures most valuable victim first, then least valuable
+/// attacker first, and splits them into the winning ones and the losing 
+/// ones, which wait until the quiets have been tried.  A capture of a 
+/// piece worth at least the capturer wins outright, and any other wins if
+/// the static exchange evaluation doesn't lose material.
+///
+/// @param captures
+///     are the captures generated for the position
+///
+void CMovePicker::scoreCaptures( const CMoves& captures )
+{
+    for ( U16 ix = 0; ix < captures.getNumMoves(); ix++ )
+    {
+        CMove m = captures.get( ix );
+        S32 attacker = kOrderValues[U8(
+            mrPos.getPiece( m.getFrom().get() ).getPieceType().get() )];
+        S32 victim = m.isEnPassant()
+            ? kOrderValues[U8( EPieceType::kPawn )]
+            : kOrderValues[U8( 
+                mrPos.getPiece( m.getTo().get() ).getPieceType().get() )];
+
+        //
+        //  At most 16 * 900 + 800, which fits the 16 bit key.
+        //
+        S32 key = 16 * victim - attacker;
+        if ( m.isPromo() )
+        {
+            key += kOrderValues[U8( m.getPromo().get() )]
+                - kOrderValues[U8( EPieceType::kPawn )];
+        }
+
+        if ( victim >= attacker || m.isPromo() || mrPos.seeGE( m, 0 ) )
+            mMoves.addMove( m, U16( key ) );
+        else
+            mLosingCaptures.addMove( m, U16( key ) );
+    }
+}
+
+///
+/// scores the quiet moves by their history
+///
+void CMovePicker::scoreQuiets( const CMoves& quiets )
+{
+    CColor c = mrPos.getWhoseMove();
+    mMoves.reset();
+    mNextIx = 0;
+    for ( U16 ix = 0; ix < quiets.getNumMoves(); ix++ )
+    {
+        CMove m = quiets.get( ix );
+        if ( m.isPromo() )
+        {
+            mMoves.addMove( m, m.getPromo().get() == EPieceType::kQueen 
+                ? kTopKey : kBottomKey );
+        }
+        else
+        {
+            mMoves.addMove( 
+                m, 1 + getHistoryKey( mrHistory.getHistory( c, m ) ) );
+        }
+    }
+}
+
+///
+/// scores the evasions: the hash move, then captures most valuable victim
+/// first, then the other moves by their history
+///
+void CMovePicker::scoreEvasions( const CMoves& evasions )
+{
+    CColor c = mrPos.getWhoseMove();
+    for ( U16 ix = 0; ix < evasions.getNumMoves(); ix++ )
+    {
+        CMove m = evasions.get( ix );
+        if ( m == mHashMove )
+        {
+            mMoves.addMove( m, kTopKey );
+        }
+        else if ( m.isCapture() )
+        {
+            mMoves.addMove( m, kEvasionCaptureKey + ( m.isEnPassant()
+                ? kOrderValues[U8( EPieceType::kPawn )]
+                : kOrderValues[U8( mrPos.getPiece( 
+                    m.getTo().get() ).getPieceType().get() )] ) );
+        }
+        else
+        {
+            mMoves.addMove( m, getHistoryKey( mrHistory.getHistory( c, m ) ) );
+        }
+    }
+}
+
+///
+/// hands out the next move to try
+///
+/// @param rMove
+///     receives the move
+///
+/// @returns
+///     false once every stage has run out of moves
+///
+bool CMovePicker::next( CMove& rMove )
+{
+    bool bWhite = mrPos.getWhoseMove().isWhite();
+
+    while ( mStage != kDone )
+    {
+        switch ( mStage )
+        {
+        case kHashMove:
+            mStage = kGenCaptures;
+            if ( mrPos.isPseudoLegal( mHashMove ) )
+            {
+                rMove = mHashMove;
+                return true;
+            }
+            break;
+
+        case kGenCaptures:
+        {
+            CMoves captures;
+            if ( bWhite )
+                genCaptures<EColor::kWhite>( captures );
+            else
+                genCaptures<EColor::kBlack>( captures );
+            scoreCaptures( captures );
+            mStage = kWinningCaptures;
+            break;
+        }
+
+        case kWinningCaptures:
+            while ( pickBest( mMoves, mNextIx, rMove ) )
+            {
+                if ( rMove != mHashMove )
+                    return true;
+            }
+            mStage = mbCapturesOnly ? kDone : kKiller1;
+            break;
+
+        //
+        //  The killers and counter-move are quiet, since only quiet moves 
+        //  are remembered, and isPseudoLegal holds them to being quiet 
+        //  here too, so the capture stages can't hand them out twice.
+        //
+        case kKiller1:
+            mStage = kKiller2;
+            rMove = mKillers[0];
+            if ( rMove != mHashMove && mrPos.isPseudoLegal( rMove ) )
+                return true;
+            break;
+
+        case kKiller2:
+            mStage = kCounterMove;
+            rMove = mKillers[1];
+            if ( rMove != mHashMove && rMove != mKillers[0]
+                && mrPos.isPseudoLegal( rMove ) )
+            {
+                return true;
+            }
+            break;
+
+        case kCounterMove:
+            mStage = kGenQuiets;
+            rMove = mCounterMove;
+            if ( rMove != mHashMove && rMove != mKillers[0]
+                && rMove != mKillers[1] && mrPos.isPseudoLegal( rMove ) )
+            {
+                return true;
+            }
+            break;
+
+        case kGenQuiets:
+        {
+            CMoves quiets;
+            if ( bWhite )
+                genQuiets<EColor::kWhite>( quiets );
+            else
+                genQuiets<EColor::kBlack>( quiets );
+            scoreQuiets( quiets );
+            mStage = kQuiets;
+            break;
+        }
+
+        case kQuiets:
+            while ( pickBest( mMoves, mNextIx, rMove ) )
+            {
+                if ( !isSpecial( rMove ) )
+                    return true;
+            }
+            mStage = kLosingCaptures;
+            break;
+
+        case kLosingCaptures:
+            while ( pickBest( mLosingCaptures, mNextLosingIx, rMove ) )
+            {
+                if ( rMove != mHashMove )
+                    return true;
+            }
+            mStage = kDone;
+            break;
+
+        case kGenEvasions:
+        {
+            CMoves evasions;
+            if ( bWhite )
+                mrPos.genEvasions<EColor::kWhite>( evasions );
+            else
+                mrPos.genEvasions<EColor::kBlack>( evasions );
+            scoreEvasions( evasions );
+            mStage = kEvasions;
+            break;
+        }
+
+        case kEvasions:
+            if ( pickBest( mMoves, mNextIx, rMove ) )
+                return true;
+            mStage = kDone;
+            break;
+
+        default:
+            mStage = kDone;
+            break;
+        }
+    }
+    return false;
+}
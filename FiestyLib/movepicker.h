@@ -0,0 +1,127 @@
+/// file movepicker.h
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// headers having to do with ordering the moves tried by the search
+///
+///
+#ifndef Fiesty_movepicker_h
+#define Fiesty_movepicker_h
+
+#include "position.h"
+
+///
+/// The move ordering heuristics that the search learns as it goes: two
+/// killer moves per ply, a counter-move for each piece and destination of
+/// the previous move, and a history score for each color, from and to
+/// square.  All of them only remember quiet moves.
+///
+class CMoveHistory
+{
+public:
+    static const U16 kMaxPly = 128;
+
+    CMoveHistory() { clear(); }
+    void clear();
+
+    CMove getKiller( U16 ply, U8 killerIx ) const
+    {
+        assert( ply < kMaxPly && killerIx < 2 );
+        return mKillers[ply][killerIx];
+    }
+
+    ///
+    /// @returns the move that last refuted a move of piece p to sqix
+    ///
+    CMove getCounterMove( CPiece p, CSqix sqix ) const
+    {
+        return p.isValid()
+            ? mCounterMoves[U8( p.get() )][sqix.get()] : CMove::null();
+    }
+
+    S32 getHistory( CColor c, CMove m ) const
+    {
+        return mHistory[U8( c.get() )][m.getFrom().get()][m.getTo().get()];
+    }
+
+    void onCutoff(
+        const CPos&     rPos,
+        CMove           m,
+        CMove           prevMove,
+        U16             ply,
+        U16             depthLeft );
+
+private:
+    static const S32    kMaxHistory = 1 << 24;
+
+    CMove       mKillers[kMaxPly][2];
+    CMove       mCounterMoves[U8( EPiece::kNum )][CSqix::kNumSquares];
+    S32         mHistory[U8( EColor::kNum )][CSqix::kNumSquares]
+                    [CSqix::kNumSquares];
+};
+
+///
+/// Hands out the pseudo-legal moves of a position one at a time, best
+/// first, generating each stage only when the stage before it has run
+/// out.  A node that cuts off on the hash move never generates a move, and
+/// one that cuts off on a capture or killer never generates the quiets.
+/// The caller still has to reject moves that leave its king in check.
+/// In check, the legal evasions are generated instead, in a single stage.
+///
+class CMovePicker
+{
+public:
+    enum EStage
+    {
+        kHashMove,
+        kGenCaptures,
+        kWinningCaptures,
+        kKiller1,
+        kKiller2,
+        kCounterMove,
+        kGenQuiets,
+        kQuiets,
+        kLosingCaptures,
+        kGenEvasions,
+        kEvasions,
+        kDone
+    };
+
+    CMovePicker(
+        CPos&                   rPos,
+        const CMoveHistory&     rHistory,
+        CMove                   hashMove,
+        U16                     ply,
+        CMove                   prevMove );
+    CMovePicker(
+        CPos&                   rPos,
+        const CMoveHistory&     rHistory,
+        CMove                   hashMove );
+
+    bool next( CMove& rMove );
+    EStage getStage() const { return mStage; }
+
+private:
+    CPos&                   mrPos;
+    const CMoveHistory&     mrHistory;
+    EStage                  mStage;
+    bool                    mbCapturesOnly;
+    CMove                   mHashMove;
+    CMove                   mKillers[2];
+    CMove                   mCounterMove;
+    CScoredMoves            mMoves;
+    U16                     mNextIx;
+    CScoredMoves            mLosingCaptures;
+    U16                     mNextLosingIx;
+
+    template <EColor C> void genCaptures( CMoves& rMoves );
+    template <EColor C> void genQuiets( CMoves& rMoves );
+    void scoreCaptures( const CMoves& captures );
+    void scoreQuiets( const CMoves& quiets );
+    void scoreEvasions( const CMoves& evasions );
+    bool isSpecial( CMove m ) const;
+    static bool pickBest( CScoredMoves& rMoves, U16& rNextIx, CMove& rMove );
+    static U16 getHistoryKey( S32 history );
+};
+
+#endif      // movepicker.h
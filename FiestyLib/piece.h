@@ -86,7 +86,7 @@ public:
     CPiece( EPiece p ) 
     { 
         mPiece = p; 
-        assert( isValid() );
+        assert( isValid() || p == EPiece::kNone );      // kNone: empty square
     }
     CPiece( CColor c, CPieceType pt ) 
     { 
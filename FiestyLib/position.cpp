@@ -6,9 +6,11 @@
 ///
 ///
 #include <cctype>
+#include <cstdlib>
 #include <algorithm>
 #include "position.h"
 #include "gen.h"
+#include "magic.h"
 
 const char* CPos::kStartFen 
     = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
@@ -21,6 +23,10 @@ void CPos::addPiece( CPiece p, CSqix sq )
     mBoard[sq.get()] = p;
     mbbPieceType[U8( p.getPieceType().get() )] |= sq.asBitBoard();
     mbbColor[U8( p.getColor().get() )] |= sq.asBitBoard();
+    mbbOccupied |= sq.asBitBoard();
+    mAttacksValid = 0;
+    mbCheckInfoValid = false;
+    mHashKey ^= CGen::mZobrist.mPieceSquare[U8( p.get() )][sq.get()];
 }
 
 ///
@@ -81,6 +87,7 @@ std::string CPos::asFen() const
             {
                 if ( spaceCount > 0 )
                     s.push_back( '0' + spaceCount );
+                spaceCount = 0;
                 s.append( 
                     mBoard[CSqix( ERank( r ), EFile( f ) ).get()].asAbbr() );
             }
@@ -92,8 +99,17 @@ std::string CPos::asFen() const
     }
     s.append( " " );
     s.push_back( std::tolower( mWhoseMove.asAbbr()[0] ) );
-    s.append( " " + mPosRights.asAbbr() 
-        + " " + std::to_string( mHalfMoveClock ) 
+    s.append( " " + mPosRights.castlingAsStr() + " " );
+    if ( mPosRights.isEnPassantLegal() )
+    {
+        s.append( CSqix( mWhoseMove.isWhite() ? ERank::kRank6 : ERank::kRank3,
+            mPosRights.getEnPassantFile() ).asAbbr() );
+    }
+    else
+    {
+        s.append( "-" );
+    }
+    s.append( " " + std::to_string( mHalfMoveClock ) 
         + " " + std::to_string( mMoveNum ) );
     return s;
 }
@@ -133,646 +149,535 @@ void CPos::clearBoard()
         mBoard, U8( EPiece::kNone ), U8( ERank::kNum ) * U8( EFile::kNum ) );
     std::memset( mbbPieceType, 0, sizeof( mbbPieceType ) );
     std::memset( mbbColor, 0, sizeof( mbbColor ) );
+    mbbOccupied = 0ULL;
+    mbbCheckers = 0ULL;
+    mAttacksValid = 0;
+    mbCheckInfoValid = false;
+    mNumUndos = 0;
+    mHashKey = computeHashKey();
 }
 
 ///
-/// finds the black pieces giving check to the white king 
-/// and saves them in mbbCheckers.
+/// adds a single pawn push or capture, or all four promotions if it 
+/// reaches the last rank
 ///
-void CPos::findBlackCheckers()
+template <EColor C>
+void CPos::addPawnMoves( 
+    CMoves&         rMoves, 
+    CSqix           fromSqix, 
+    CSqix           toSqix,
+    bool            bCapture )
 {
-    mbbCheckers = 0ULL;
-
-    CBitBoard bbWhiteKing = getPieces( EColor::kWhite, EPieceType::kKing );
-    CSqix kingSqix = bbWhiteKing.msb();
-    findBlackRankAndFileCheckers( kingSqix );
-    findBlackDiagonalCheckers( kingSqix );
-    if ( mbbCheckers.popcnt() < 2 )
-        findBlackKnightCheckers( kingSqix );
-    if ( mbbCheckers.popcnt() < 2 )
-        findBlackPawnCheckers( bbWhiteKing );
-    if ( mbbCheckers.popcnt() < 2 )
-        findBlackKingCheckers( kingSqix );
+    if ( toSqix.getRank().get() == SColorTraits<C>::kPromoRank )
+    {
+        rMoves.addMove( 
+            CMove( fromSqix, toSqix, EPieceType::kQueen, bCapture ) );
+        rMoves.addMove( 
+            CMove( fromSqix, toSqix, EPieceType::kRook, bCapture ) );
+        rMoves.addMove( 
+            CMove( fromSqix, toSqix, EPieceType::kBishop, bCapture ) );
+        rMoves.addMove( 
+            CMove( fromSqix, toSqix, EPieceType::kKnight, bCapture ) );
+    }
+    else
+    {
+        rMoves.addMove( CMove( fromSqix, toSqix, 
+            bCapture ? CMove::kCapture : CMove::kQuiet ) );
+    }
 }
 
 ///
-/// finds black checkers along the diagonals giving check to
-/// the white king.
+/// finds the pieces of color C giving check to the enemy king and saves 
+/// them in mbbCheckers.  Kings are included because perft checks legal 
+/// moves by trying the move and seeing if it leaves the king in check.
 ///
-void CPos::findBlackDiagonalCheckers( CSqix kingSqix )
+template <EColor C>
+void CPos::findCheckers()
 {
-	CBitBoard bbBishopsAndQueens 
-		= getPieces( EColor::kBlack, EPieceType::kBishop ).get()
-		| getPieces( EColor::kBlack, EPieceType::kQueen ).get();
-    findDiagonalCheckers( kingSqix, bbBishopsAndQueens );
+    const EColor kEnemy = SColorTraits<C>::kEnemy;
+    CSqix kingSqix = getPieces( kEnemy, EPieceType::kKing ).msb();
+    CBitBoard bbQueens = getPieces( C, EPieceType::kQueen );
+
+    mbbCheckers = CMagic::rookAttacks( kingSqix, occupied() ).get() 
+        & ( getPieces( C, EPieceType::kRook ).get() | bbQueens.get() );
+    mbbCheckers |= CMagic::bishopAttacks( kingSqix, occupied() ).get() 
+        & ( getPieces( C, EPieceType::kBishop ).get() | bbQueens.get() );
+    mbbCheckers |= CGen::mbbKnightAttacks[kingSqix.get()] 
+        & getPieces( C, EPieceType::kKnight ).get();
+
+    //
+    //  Our pawns that check the enemy king are on the squares an enemy 
+    //  pawn on the king's square would attack.
+    //
+    mbbCheckers |= CGen::mbbPawnAttacks[U8( kEnemy )][kingSqix.get()] 
+        & getPieces( C, EPieceType::kPawn ).get();
+    mbbCheckers |= CGen::mbbKingAttacks[kingSqix.get()] 
+        & getPieces( C, EPieceType::kKing ).get();
 }
 
 ///
-/// finds black kings giving check to the white king.  This is needed because
-/// perft checks my legal moves by trying the move and seeing if it leaves 
-/// the king in check.
+/// generates bishop captures
 ///
-void CPos::findBlackKingCheckers( CSqix whiteKingSqix )
+/// @param rMoves
+///     the bishop captures will be added to rMoves
+///
+template <EColor C>
+void CPos::genBishopCaptures( CMoves& rMoves )
 {
-    CBitBoard bbBlackKing = getPieces( EColor::kBlack, EPieceType::kKing );
-    mbbCheckers 
-        |= ( CGen::mbbKingAttacks[whiteKingSqix.get()] & bbBlackKing.get() );
+    genPieceMovesFrom<C, EPieceType::kBishop>( rMoves, 
+        getPieces( C, EPieceType::kBishop ), 
+        mbbColor[U8( SColorTraits<C>::kEnemy )] );
 }
 
 ///
-/// finds black knights giving check to the white king
+/// generates bishop non-captures
+///
+/// @param rMoves
+///     the bishop moves will be added to rMoves
 ///
-void CPos::findBlackKnightCheckers( CSqix kingSqix )
+template <EColor C>
+void CPos::genBishopQuiets( CMoves& rMoves )
 {
-    CBitBoard bbKnights = getPieces( EColor::kBlack, EPieceType::kKnight );
-    mbbCheckers |= ( CGen::mbbKnightAttacks[kingSqix.get()] & bbKnights.get() );
+    genPieceMovesFrom<C, EPieceType::kBishop>( rMoves, 
+        getPieces( C, EPieceType::kBishop ), ~occupied() );
 }
 
 ///
-/// finds black pawn checkers that give check to the white king.
+/// generates king captures
+///
+/// @param rMoves
+///     the king captures will be added to rMoves
 ///
-void CPos::findBlackPawnCheckers( CBitBoard bbWhiteKing )
+template <EColor C>
+void CPos::genKingCaptures( CMoves& rMoves )
 {
-
-    CBitBoard bbPawns = getPieces( EColor::kBlack, EPieceType::kPawn );
-    CBitBoard bbKingUp1 = bbWhiteKing.advanceRanks( 1 );
-    CBitBoard bbCheckers = bbPawns.get() 
-        & ( bbKingUp1.leftFiles( 1 ).get() | bbKingUp1.rightFiles( 1 ).get() );
-    mbbCheckers |= bbCheckers;
+    genPieceMovesFrom<C, EPieceType::kKing>( rMoves, 
+        getPieces( C, EPieceType::kKing ), 
+        mbbColor[U8( SColorTraits<C>::kEnemy )] );
 }
 
 ///
-/// finds black checkers along the rank and file giving check to
-/// the white king.
+/// generates king non-captures
 ///
-void CPos::findBlackRankAndFileCheckers( CSqix kingSqix )
+/// @param rMoves
+///     the king moves will be added to rMoves
+///
+template <EColor C>
+void CPos::genKingQuiets( CMoves& rMoves )
 {
-	CBitBoard bbRooksAndQueens 
-		= getPieces( EColor::kBlack, EPieceType::kRook ).get()
-		| getPieces( EColor::kBlack, EPieceType::kQueen ).get();
-    findRankAndFileCheckers( kingSqix, bbRooksAndQueens );
+    genPieceMovesFrom<C, EPieceType::kKing>( rMoves, 
+        getPieces( C, EPieceType::kKing ), ~occupied() );
 }
 
 ///
-/// finds the checker contained in the bbBishopssAndQueens bitboard.  This 
-/// method is called from each corresponding color specific method.
+/// generates the castling moves, with the squares the king crosses checked
+/// against the enemy attack map
+///
+/// @param rMoves
+///     the castling moves will be added to rMoves
 ///
-void CPos::findDiagonalCheckers( 
-    CSqix           kingSqix, 
-    CBitBoard       bbBishopsAndQueens )
+template <EColor C>
+void CPos::genCastles( CMoves& rMoves ) const
 {
-	//
-    //  Get the rays from the king's position to the edge of the board in
-    //  each of the four directions.  (The kings's square is not included
-    //  in these rays.)
-    //
-
-    //
-    //  NorthEast
-    //
-    CBitBoard bbNorthEastRay 
-        = CGen::mbbBishopRays[kingSqix.get()].mbbNorthEast;
-	CBitBoard bbOccRay = occupied( bbNorthEastRay );
-    if ( bbOccRay.get() )
-    {
-        CSqix toSqix = bbOccRay.lsb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbBishopsAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
-    }
-
-    //
-    //  NorthWest
-    //
-    CBitBoard bbNorthWestRay 
-        = CGen::mbbBishopRays[kingSqix.get()].mbbNorthWest;
-    if ( ( bbOccRay = occupied( bbNorthWestRay ) ).get() )
-    {
-        CSqix toSqix = bbOccRay.lsb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbBishopsAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
-    }
-
-    //
-    //  SouthEast
-    //
-    CBitBoard bbSouthEastRay 
-        = CGen::mbbBishopRays[kingSqix.get()].mbbSouthEast;
-    if ( ( bbOccRay = occupied( bbSouthEastRay ) ).get() )
-    {
-        CSqix toSqix = bbOccRay.msb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbBishopsAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
-    }
-
-    //
-    //  SouthWest
-    //
-    CBitBoard bbSouthWestRay 
-        = CGen::mbbBishopRays[kingSqix.get()].mbbSouthWest;
-    if ( ( bbOccRay = occupied( bbSouthWestRay ) ).get() )
-    {
-        CSqix toSqix = bbOccRay.msb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbBishopsAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
-    }
+    genCastles<C>( rMoves, getAttacks( SColorTraits<C>::kEnemy ) );
 }
 
 ///
-/// finds the checker contained in the bbRooksAndQueens bitboard.  This method
-/// is called from each corresponding color specific method.
+/// generates the castling moves that the rights allow, with the squares 
+/// between king and rook empty and none of the squares the king starts on,
+/// crosses or lands on attacked.  Each side comes down to two tests against
+/// its precomputed masks.
 ///
-void CPos::findRankAndFileCheckers( 
-    CSqix           kingSqix, 
-    CBitBoard       bbRooksAndQueens )
+/// @param rMoves
+///     the castling moves will be added to rMoves
+///
+/// @param bbDanger
+///     the squares the enemy attacks
+///
+template <EColor C>
+void CPos::genCastles( CMoves& rMoves, CBitBoard bbDanger ) const
 {
-	//
-    //  Get the rays from the king's position to the edge of the board in
-    //  each of the four directions.  (The kings's square is not included
-    //  in these rays.)
-    //
-    CBitBoard bbSouthRay = CGen::mbbRookRays[kingSqix.get()].mbbSouth;
-	CBitBoard bbOccRay = occupied( bbSouthRay );
-    if ( bbOccRay.get() )
-    {
-		CSqix toSqix = bbOccRay.msb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbRooksAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
-    }
-    CBitBoard bbEastRay = CGen::mbbRookRays[kingSqix.get()].mbbEast;
-    if ( ( bbOccRay = occupied( bbEastRay ) ).get() )
-    {
-        CSqix toSqix = bbOccRay.lsb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbRooksAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
-    }
-    CBitBoard bbWestRay = CGen::mbbRookRays[kingSqix.get()].mbbWest;
-    if ( ( bbOccRay = occupied( bbWestRay ) ).get() )
+    typedef SColorTraits<C> T;
+    CSqix kingSqix( T::kBackRank, EFile::kFileE );
+
+    if ( mPosRights.canOO( C ) 
+        && !( occupied().get() & T::kOOEmpty ) 
+        && !( bbDanger.get() & T::kOOSafe ) )
     {
-        CSqix toSqix = bbOccRay.msb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbRooksAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
+        rMoves.addMove( CMove( kingSqix, 
+            CSqix( T::kBackRank, EFile::kFileG ), CMove::kCastle ) );
     }
-    CBitBoard bbNorthRay = CGen::mbbRookRays[kingSqix.get()].mbbNorth;
-    if ( ( bbOccRay = occupied( bbNorthRay ) ).get() )
+    if ( mPosRights.canOOO( C ) 
+        && !( occupied().get() & T::kOOOEmpty ) 
+        && !( bbDanger.get() & T::kOOOSafe ) )
     {
-        CSqix toSqix = bbOccRay.lsb().get();
-		CBitBoard bbChecker = toSqix.asBitBoard() & bbRooksAndQueens.get();
-		if ( bbChecker.get() )
-		{
-			mbbCheckers |= bbChecker;
-			return;
-		}
+        rMoves.addMove( CMove( kingSqix, 
+            CSqix( T::kBackRank, EFile::kFileC ), CMove::kCastle ) );
     }
 }
 
 ///
-/// finds the white pieces giving check to the black king 
-/// and saves them in mbbCheckers.
-///
-void CPos::findWhiteCheckers()
-{
-    CBitBoard bbKing = getPieces( EColor::kBlack, EPieceType::kKing );
-    CSqix kingSqix = bbKing.msb();
-    mbbCheckers = 0ULL;
-    findWhiteRankAndFileCheckers( kingSqix );
-    findWhiteDiagonalCheckers( kingSqix );
-    if ( mbbCheckers.popcnt() < 2 )
-        findWhiteKnightCheckers( kingSqix );
-    if ( mbbCheckers.popcnt() < 2 )
-        findWhitePawnCheckers( bbKing );
-    if ( mbbCheckers.popcnt() < 2 )
-        findWhiteKingCheckers( kingSqix );
-
-}
-
-///
-/// finds white checkers along the diagonals giving check to
-/// the black king.
+/// generates knight captures
 ///
-void CPos::findWhiteDiagonalCheckers( CSqix kingSqix )
-{
-	CBitBoard bbBishopsAndQueens 
-		= getPieces( EColor::kWhite, EPieceType::kBishop ).get()
-		| getPieces( EColor::kWhite, EPieceType::kQueen ).get();
-    findDiagonalCheckers( kingSqix, bbBishopsAndQueens );
-}
-
-///
-/// finds white kings giving check to the black king.  This is needed because
-/// perft checks my legal moves by trying the move and seeing if it leaves 
-/// the king in check.
+/// @param rMoves
+///     the knight captures will be added to rMoves
 ///
-void CPos::findWhiteKingCheckers( CSqix blackKingSqix )
+template <EColor C>
+void CPos::genKnightCaptures( CMoves& rMoves )
 {
-    CBitBoard bbWhiteKing = getPieces( EColor::kWhite, EPieceType::kKing );
-    mbbCheckers 
-        |= ( CGen::mbbKingAttacks[blackKingSqix.get()] & bbWhiteKing.get() );
+    genPieceMovesFrom<C, EPieceType::kKnight>( rMoves, 
+        getPieces( C, EPieceType::kKnight ), 
+        mbbColor[U8( SColorTraits<C>::kEnemy )] );
 }
 
 ///
-/// finds white knights giving check to the black king
+/// generates knight non-captures
 ///
-void CPos::findWhiteKnightCheckers( CSqix kingSqix )
-{
-    CBitBoard bbKnights = getPieces( EColor::kWhite, EPieceType::kKnight );
-    mbbCheckers |= ( CGen::mbbKnightAttacks[kingSqix.get()] & bbKnights.get() );
-}
-
-///
-/// finds white pawn checkers that give check to the black king.
+/// @param rMoves
+///     the knight moves will be added to rMoves
 ///
-void CPos::findWhitePawnCheckers( CBitBoard bbBlackKing )
+template <EColor C>
+void CPos::genKnightQuiets( CMoves& rMoves )
 {
-
-    CBitBoard bbPawns = getPieces( EColor::kWhite, EPieceType::kPawn );
-    CBitBoard bbKingDown1 = bbBlackKing.retreatRanks( 1 );
-    CBitBoard bbCheckers = bbPawns.get() 
-        & ( bbKingDown1.leftFiles( 1 ).get() 
-            | bbKingDown1.rightFiles( 1 ).get() );
-    mbbCheckers |= bbCheckers;
+    genPieceMovesFrom<C, EPieceType::kKnight>( rMoves, 
+        getPieces( C, EPieceType::kKnight ), ~occupied() );
 }
 
 ///
-/// finds white checkers along the rank and file giving check to
-/// the black king.
+/// @returns 
+///     the squares attacked by the pieces of color C, given the occupied 
+///     squares.  Pass the occupancy without the enemy king to find the 
+///     squares the king can't step back along a checking ray to.
 ///
-void CPos::findWhiteRankAndFileCheckers( CSqix kingSqix )
+template <EColor C>
+CBitBoard CPos::attackedBy( CBitBoard bbOccupied ) const
 {
-	CBitBoard bbRooksAndQueens 
-		= getPieces( EColor::kWhite, EPieceType::kRook ).get()
-		| getPieces( EColor::kWhite, EPieceType::kQueen ).get();
-    findRankAndFileCheckers( kingSqix, bbRooksAndQueens );
+    CBitBoard bbPawnsForward 
+        = SColorTraits<C>::forward( getPieces( C, EPieceType::kPawn ) );
+    CBitBoard bbQueens = getPieces( C, EPieceType::kQueen );
+    CBitBoard bbAttacked 
+        = bbPawnsForward.leftFiles( 1 ).get() 
+        | bbPawnsForward.rightFiles( 1 ).get()
+        | CGen::mbbKingAttacks[getPieces( C, EPieceType::kKing ).lsb().get()];
+
+    CBitBoard bbFrom = getPieces( C, EPieceType::kKnight );
+    while ( bbFrom.get() )
+        bbAttacked |= CGen::mbbKnightAttacks[bbFrom.popLsb().get()];
+    bbFrom = getPieces( C, EPieceType::kBishop ).get() | bbQueens.get();
+    while ( bbFrom.get() )
+        bbAttacked |= CMagic::bishopAttacks( bbFrom.popLsb(), bbOccupied );
+    bbFrom = getPieces( C, EPieceType::kRook ).get() | bbQueens.get();
+    while ( bbFrom.get() )
+        bbAttacked |= CMagic::rookAttacks( bbFrom.popLsb(), bbOccupied );
+    return bbAttacked;
 }
 
 ///
-/// generates all black quasi-legal moves in the position
+/// @returns 
+///     the squares attacked by the pieces of a color, including the 
+///     squares of its own pieces that it defends.  The map is only 
+///     recomputed after a piece has been added or removed.
 ///
-void CPos::genBlackMoves( CMoves& rMoves )
+CBitBoard CPos::getAttacks( CColor c ) const
 {
-    genBlackPawnQuiets( rMoves );
-    genBlackPawnCaptures( rMoves );
-    genBlackKnightQuiets( rMoves );
-    genBlackKnightCaptures( rMoves );
-    genBlackBishopQuiets( rMoves );
-    genBlackBishopCaptures( rMoves );
-    genBlackRookQuiets( rMoves );
-    genBlackRookCaptures( rMoves );
-    genBlackQueenQuiets( rMoves );
-    genBlackQueenCaptures( rMoves );
-    genBlackKingQuiets( rMoves );
-    genBlackKingCaptures( rMoves );
+    U8 colorIx = U8( c.get() );
+    if ( !( mAttacksValid & ( 1 << colorIx ) ) )
+    {
+        mbbAttacks[colorIx] = c.isWhite() 
+            ? attackedBy<EColor::kWhite>( mbbOccupied ) 
+            : attackedBy<EColor::kBlack>( mbbOccupied );
+        mAttacksValid |= 1 << colorIx;
+    }
+    return mbbAttacks[colorIx];
 }
 
 ///
-/// generates all black legal moves in the position
+/// @returns 
+///     the pieces of color C that are pinned to their king by an enemy 
+///     slider.  A pinned piece can only move along the line through the 
+///     king and the pinner.
 ///
-void CPos::genBlackLegalMoves( CMoves& rMoves )
+template <EColor C>
+CBitBoard CPos::findPinned( CSqix kingSqix ) const
 {
-    CMoves			quasiMoves;
-	CUndoContext	undoContext;
+    const EColor kEnemy = SColorTraits<C>::kEnemy;
+    CBitBoard bbEnemy = mbbColor[U8( kEnemy )];
+    CBitBoard bbQueens = getPieces( kEnemy, EPieceType::kQueen );
+    CBitBoard bbPinned( 0ULL );
 
-    genBlackMoves( quasiMoves );
-    for ( int moveIx = 0; moveIx < quasiMoves.getNumMoves(); moveIx++ )
+    //
+    //  The snipers are the enemy sliders that would attack the king if only
+    //  the enemy pieces were on the board.  A sniper pins the piece between
+    //  it and the king if that's the only piece in between and it is ours.
+    //
+    CBitBoard bbSnipers 
+        = ( CMagic::rookAttacks( kingSqix, bbEnemy ).get() 
+            & ( getPieces( kEnemy, EPieceType::kRook ).get() 
+                | bbQueens.get() ) )
+        | ( CMagic::bishopAttacks( kingSqix, bbEnemy ).get() 
+            & ( getPieces( kEnemy, EPieceType::kBishop ).get() 
+                | bbQueens.get() ) );
+    while ( bbSnipers.get() )
     {
-        makeMoveForPerft( quasiMoves.get( moveIx ), undoContext );
-        if ( !getCheckers().get() )
-        {
-            rMoves.addMove( quasiMoves.get( moveIx ) );
-        }
-        unmakeMoveForPerft( quasiMoves.get( moveIx ), undoContext );
+        YBitBoard bbBetween = CGen::mbbBetween[kingSqix.get()]
+            [bbSnipers.popLsb().get()] & occupied().get();
+        if ( bbBetween && !( bbBetween & ( bbBetween - 1 ) ) )
+            bbPinned |= bbBetween & mbbColor[U8( C )].get();
     }
+    return bbPinned;
 }
 
 ///
-/// generates bishop captures for black
-///
-/// @param rMoves
-///     the bishop captures will be added to rMoves
-///
-void CPos::genBlackBishopCaptures( CMoves& rMoves )
-{
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kBishop );
-    genBlackBishopCapturesFrom( rMoves, bbFrom );
-}
-
-///
-/// generates bishop captures for black
-///
-/// @param rMoves
-///     the bishop captures will be added to rMoves
+/// generates the legal en passant captures.  The capture removes two pieces
+/// from the capturer's rank, so rather than reason about pins the 
+/// occupancy after the capture is tested for slider attacks on the king.
+/// That also covers the capture of a pawn that has just given check, and 
+/// the discovered check along the rank when the king, both pawns and an 
+/// enemy rook or queen share it.
 ///
-void CPos::genBlackBishopCapturesFrom( CMoves& rMoves, CBitBoard bbFrom )
+template <EColor C>
+void CPos::genLegalEnPassant( CMoves& rMoves, CSqix kingSqix )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
-    while ( bbFrom.get() )
+    typedef SColorTraits<C> T;
+    const EColor kEnemy = T::kEnemy;
+
+    if ( !mPosRights.isEnPassantLegal() )
+        return;
+    CSqix toSqix( T::kEnPassantRank, mPosRights.getEnPassantFile() );
+    CSqix victimSqix = T::behind( toSqix, 1 );
+    if ( !( getPieces( kEnemy, EPieceType::kPawn ).get() 
+            & victimSqix.asBitBoard() )
+        || ( occupied().get() & toSqix.asBitBoard() ) )
     {
-        fromSqix = bbFrom.popLsb(); 
+        return;
+    }
 
-        //
-        //  Get the rays from the rook position to the edge of the board in
-        //  each of the four directions.  (The rook's square is not included
-        //  in these rays.
-        //
-        CBitBoard bbNorthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthEast;
-        CBitBoard bbSouthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthEast;
-        CBitBoard bbSouthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthWest;
-        CBitBoard bbNorthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthWest;
-        
+    CBitBoard bbQueens = getPieces( kEnemy, EPieceType::kQueen );
+    CBitBoard bbRooks 
+        = getPieces( kEnemy, EPieceType::kRook ).get() | bbQueens.get();
+    CBitBoard bbBishops 
+        = getPieces( kEnemy, EPieceType::kBishop ).get() | bbQueens.get();
 
-        //
-        //  Find the square of the blocking piece in each direction, and if 
-        //  it's black, generate a capture
-        //
-        if ( ( bbOccRay = occupied( bbNorthEastRay ) ).get() )
-        {
-            toSqix = bbOccRay.lsb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbNorthWestRay ) ).get() )
-        {
-            toSqix = bbOccRay.lsb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbSouthEastRay ) ).get() )
-        {
-            toSqix = bbOccRay.msb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbSouthWestRay ) ).get() )
-        {
-            toSqix = bbOccRay.msb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+    //
+    //  A knight giving check can't be answered by an en passant capture, 
+    //  and the only pawn check it answers is by the victim.
+    //
+    if ( mbbCheckers.get() & ~victimSqix.asBitBoard() 
+        & ( getPieces( kEnemy, EPieceType::kKnight ).get() 
+            | getPieces( kEnemy, EPieceType::kPawn ).get() ) )
+    {
+        return;
     }
-}
 
-///
-/// generates bishop non-captures for black
-///
-/// @param rMoves
-///     the bishop moves will be added to rMoves
-///
-void CPos::genBlackBishopQuiets( CMoves& rMoves )
-{
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kBishop );
-    genBlackBishopQuietsFrom( rMoves, bbFrom );
-}
-
-///
-/// generates bishop non-captures for black
-///
-/// @param rMoves
-///     the bishop moves will be added to rMoves
-///
-void CPos::genBlackBishopQuietsFrom( CMoves& rMoves, CBitBoard bbFrom )
-{
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
+    CBitBoard bbFrom = CGen::mbbPawnAttacks[U8( kEnemy )][toSqix.get()] 
+        & getPieces( C, EPieceType::kPawn ).get();
     while ( bbFrom.get() )
     {
-        fromSqix = bbFrom.popLsb(); 
-
-        //
-        //  Get the rays from the bishop position to the edge of the board in
-        //  each of the four directions.  (The bishop's square is not included
-        //  in these rays.)
-        //
-        CBitBoard bbNorthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthEast;
-        CBitBoard bbSouthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthEast;
-        CBitBoard bbSouthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthWest;
-        CBitBoard bbNorthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthWest;
-
-        //
-        //  For each of thes rays, find the blocker (if any) and mask off
-        //  the squares beyond the blocker.
-        //
-        if ( ( bbOccRay = occupied( bbNorthEastRay ) ).get() )
-        {
-            bbNorthEastRay 
-                &= CGen::mbbBishopRays[bbOccRay.lsb().get()].mbbSouthWest;
-        }
-        if ( ( bbOccRay = occupied( bbSouthEastRay ) ).get() )
-        {
-            bbSouthEastRay 
-                &= CGen::mbbBishopRays[bbOccRay.msb().get()].mbbNorthWest;
-        }
-        if ( ( bbOccRay = occupied( bbSouthWestRay ) ).get() )
-        {
-            bbSouthWestRay 
-                &= CGen::mbbBishopRays[bbOccRay.msb().get()].mbbNorthEast;
-        }
-        if ( ( bbOccRay = occupied( bbNorthWestRay ) ).get() )
+        CSqix fromSqix = T::popNext( bbFrom );
+        CBitBoard bbOccupied = ( occupied().get() ^ fromSqix.asBitBoard() 
+            ^ victimSqix.asBitBoard() ) | toSqix.asBitBoard();
+        if ( !( CMagic::rookAttacks( kingSqix, bbOccupied ).get() 
+                & bbRooks.get() )
+            && !( CMagic::bishopAttacks( kingSqix, bbOccupied ).get() 
+                & bbBishops.get() ) )
         {
-            bbNorthWestRay 
-                &= CGen::mbbBishopRays[bbOccRay.lsb().get()].mbbSouthEast;
-        }
-        CBitBoard bbTo 
-            = bbNorthEastRay.get() 
-            | bbSouthEastRay.get() 
-            | bbSouthWestRay.get() 
-            | bbNorthWestRay.get();
-        while ( bbTo.get() )
-        {
-            toSqix = bbTo.popLsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
+            rMoves.addMove( CMove( fromSqix, toSqix, CMove::kEnPassant ) );
         }
     }
 }
 
 ///
-/// generates knight non-captures for black
+/// generates the legal replies to a check: king moves to squares the enemy
+/// doesn't attack and, for a single check only, captures of the checker 
+/// and blocks on the squares between it and the king.  A pinned piece can
+/// never do either, so pinned pieces aren't even looked at.
+///
+/// mbbCheckers must hold the pieces checking C's king, as left by 
+/// findCheckers<kEnemy>().
 ///
 /// @param rMoves
-///     the knight moves will be added to rMoves
+///     the evasions will be added to rMoves
 ///
-void CPos::genBlackKnightQuiets( CMoves& rMoves )
+template <EColor C>
+void CPos::genEvasions( CMoves& rMoves )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kKnight );
-    while ( bbFrom.get() )
-    {
-        fromSqix = bbFrom.popLsb(); 
-        CBitBoard bbTo = unoccupied( CGen::mbbKnightAttacks[fromSqix.get()] );
-        while ( bbTo.get() )
-        {
-            toSqix = bbTo.popLsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-    }
+    const EColor kEnemy = SColorTraits<C>::kEnemy;
+    CBitBoard bbKing = getPieces( C, EPieceType::kKing );
+    CSqix kingSqix = bbKing.lsb();
+
+    //
+    //  The enemy attacks are found with the king off the board, so that it
+    //  can't step back along the ray of a checking slider.
+    //
+    assert( mbbCheckers.get() );
+    CBitBoard bbDanger 
+        = attackedBy<kEnemy>( occupied().get() ^ bbKing.get() );
+    genPieceMovesFrom<C, EPieceType::kKing>( rMoves, bbKing, 
+        ~mbbColor[U8( C )].get() & ~bbDanger.get() );
+    if ( mbbCheckers.popcnt() > 1 )
+        return;
+
+    CBitBoard bbBetween 
+        = CGen::mbbBetween[kingSqix.get()][mbbCheckers.lsb().get()];
+    CBitBoard bbTargets = mbbCheckers.get() | bbBetween.get();
+    CBitBoard bbFree = ~findPinned<C>( kingSqix ).get();
+    CBitBoard bbPawns = getPieces( C, EPieceType::kPawn ).get() & bbFree.get();
+    genPawnQuietsFrom<C>( rMoves, bbPawns, bbBetween );
+    genPawnCapturesFrom<C>( rMoves, bbPawns, mbbCheckers );
+    genPieceMovesFrom<C, EPieceType::kKnight>( rMoves, 
+        getPieces( C, EPieceType::kKnight ).get() & bbFree.get(), bbTargets );
+    genPieceMovesFrom<C, EPieceType::kBishop>( rMoves, 
+        getPieces( C, EPieceType::kBishop ).get() & bbFree.get(), bbTargets );
+    genPieceMovesFrom<C, EPieceType::kRook>( rMoves, 
+        getPieces( C, EPieceType::kRook ).get() & bbFree.get(), bbTargets );
+    genPieceMovesFrom<C, EPieceType::kQueen>( rMoves, 
+        getPieces( C, EPieceType::kQueen ).get() & bbFree.get(), bbTargets );
+    genLegalEnPassant<C>( rMoves, kingSqix );
 }
 
 ///
-/// generates king captures for black
+/// generates all legal moves in the position.  The checkers are found 
+/// first, and a position in check is handed over to genEvasions.  
+/// Otherwise the pinned pieces and the squares attacked by the enemy are 
+/// found once, and then only moves that respect them are generated:
+///
+///     - the king may go to any square the enemy doesn't attack.
+///     - it may castle across squares the enemy doesn't attack.
+///     - a pinned piece may only move along the line through its king.
 ///
 /// @param rMoves
-///     the king captures will be added to rMoves
+///     the legal moves will be added to rMoves
 ///
-void CPos::genBlackKingCaptures( CMoves& rMoves )
+template <EColor C>
+void CPos::genLegalMoves( CMoves& rMoves )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kKing );
-    fromSqix = bbFrom.lsb(); 
-    CBitBoard bbTo = CGen::mbbKingAttacks[fromSqix.get()] 
-        & mbbColor[U8( EColor::kWhite )].get();
-    while ( bbTo.get() )
+    const EColor kEnemy = SColorTraits<C>::kEnemy;
+    CBitBoard bbKing = getPieces( C, EPieceType::kKing );
+    CSqix kingSqix = bbKing.lsb();
+    CBitBoard bbTargets = ~mbbColor[U8( C )];
+
+    findCheckers<kEnemy>();
+    if ( mbbCheckers.get() )
     {
-        toSqix = bbTo.popLsb(); 
-        rMoves.addMove( CMove( fromSqix, toSqix ) );
+        genEvasions<C>( rMoves );
+        return;
     }
+
+    CBitBoard bbDanger 
+        = attackedBy<kEnemy>( occupied().get() ^ bbKing.get() );
+    genPieceMovesFrom<C, EPieceType::kKing>( 
+        rMoves, bbKing, bbTargets.get() & ~bbDanger.get() );
+
+    //
+    //  Taking the king off the board only opens the back rank beyond it, 
+    //  which an enemy rook could only reach by giving check, so the danger
+    //  map serves for castling too.
+    //
+    genCastles<C>( rMoves, bbDanger );
+
+    CBitBoard bbPinned = findPinned<C>( kingSqix );
+    genPinnedAwareMoves<C, EPieceType::kPawn>( 
+        rMoves, bbTargets, bbPinned, kingSqix );
+    genPinnedAwareMoves<C, EPieceType::kKnight>( 
+        rMoves, bbTargets, bbPinned, kingSqix );
+    genPinnedAwareMoves<C, EPieceType::kBishop>( 
+        rMoves, bbTargets, bbPinned, kingSqix );
+    genPinnedAwareMoves<C, EPieceType::kRook>( 
+        rMoves, bbTargets, bbPinned, kingSqix );
+    genPinnedAwareMoves<C, EPieceType::kQueen>( 
+        rMoves, bbTargets, bbPinned, kingSqix );
+    genLegalEnPassant<C>( rMoves, kingSqix );
 }
 
 ///
-/// generates king non-captures for white
-///
-/// @param rMoves
-///     the king moves will be added to rMoves
+/// generates all quasi-legal moves in the position
 ///
-void CPos::genBlackKingQuiets( CMoves& rMoves )
+template <EColor C>
+void CPos::genMoves( CMoves& rMoves )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kKing );
-    fromSqix = bbFrom.lsb(); 
-    CBitBoard bbTo = unoccupied( CGen::mbbKingAttacks[fromSqix.get()] );
-    while ( bbTo.get() )
-    {
-        toSqix = bbTo.popLsb(); 
-        rMoves.addMove( CMove( fromSqix, toSqix ) );
-    }
+    genPawnQuiets<C>( rMoves );
+    genPawnCaptures<C>( rMoves );
+    genKnightQuiets<C>( rMoves );
+    genKnightCaptures<C>( rMoves );
+    genBishopQuiets<C>( rMoves );
+    genBishopCaptures<C>( rMoves );
+    genRookQuiets<C>( rMoves );
+    genRookCaptures<C>( rMoves );
+    genQueenQuiets<C>( rMoves );
+    genQueenCaptures<C>( rMoves );
+    genKingQuiets<C>( rMoves );
+    genKingCaptures<C>( rMoves );
+    genCastles<C>( rMoves );
 }
 
-
 ///
-/// generates knight captures for black
+/// generates pawn captures
 ///
 /// @param rMoves
-///     the knight captures will be added to rMoves
+///     the pawn captures will be added to rMoves
 ///
-void CPos::genBlackKnightCaptures( CMoves& rMoves )
+template <EColor C>
+void CPos::genPawnCaptures( CMoves& rMoves )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kKnight );
-    while ( bbFrom.get() )
+    typedef SColorTraits<C> T;
+
+    //
+    //  We can capture on squares that have an enemy piece or that have just
+    //  been passed by (for an en-passant).
+    //
+    CBitBoard bbTargets = mbbColor[U8( T::kEnemy )];
+    if ( mPosRights.isEnPassantLegal() )
     {
-        fromSqix = bbFrom.popLsb(); 
-        CBitBoard bbTo = CGen::mbbKnightAttacks[fromSqix.get()] 
-            & mbbColor[U8( EColor::kWhite )].get();
-        while ( bbTo.get() )
-        {
-            toSqix = bbTo.popLsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+        bbTargets.setSquare( 
+            CSqix( T::kEnPassantRank, mPosRights.getEnPassantFile() ).get() );
     }
+    genPawnCapturesFrom<C>( 
+        rMoves, getPieces( C, EPieceType::kPawn ), bbTargets );
 }
 
 ///
-/// generates pawn captures for black
+/// generates pawn captures from a set of squares 
 ///
 /// @param rMoves
 ///     the pawn captures will be added to rMoves
 ///
-void CPos::genBlackPawnCaptures( CMoves& rMoves )
+/// @param bbFrom
+///     the pawns to generate the captures of
+///
+/// @param bbTargets
+///     the squares that may be captured on
+///
+template <EColor C>
+void CPos::genPawnCapturesFrom( 
+    CMoves&         rMoves, 
+    CBitBoard       bbFrom, 
+    CBitBoard       bbTargets )
 {
+    typedef SColorTraits<C> T;
     CSqix           toSqix;
     CSqix           fromSqix;
    
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kPawn );
-
-    //
-    //  We can capture on squares that have a white piece or that have just
-    //  passed by (for an en-passant).
-    //
-    CBitBoard bbTargets = mbbColor[U8( EColor::kWhite )];
-    if ( mPosRights.isEnPassantLegal() )
-    {
-        bbTargets.setSquare( 
-            CSqix( ERank::kRank3, mPosRights.getEnPassantFile() ).get() );
-    }
-    CBitBoard bbDown1 = bbFrom.retreatRanks( 1 );
+    CBitBoard bbForward1 = T::forward( bbFrom );
     CBitBoard bbTo = bbTargets.get() 
-        & ( bbDown1.leftFiles( 1 ).get() | bbDown1.rightFiles( 1 ).get() );
+        & ( bbForward1.leftFiles( 1 ).get() 
+            | bbForward1.rightFiles( 1 ).get() );
     while ( bbTo.get() )
     {
-        toSqix = bbTo.popLsb();
+        toSqix = T::popNext( bbTo );
+
+        //
+        //  A target that is empty is the en passant square.
+        //
+        bool bEnPassant = !occupied( toSqix.asBitBoard() ).get();
 
         //
         //  Is there a capturing pawn to the left of the target?
         //
         if ( toSqix.getFile().get() != EFile::kFileA )
         {
-            fromSqix = toSqix.plusRanks( 1 ).minusFiles( 1 );
+            fromSqix = T::behind( toSqix, 1 ).minusFiles( 1 );
             if ( bbFrom.atSquare( fromSqix ).get() )
-            {
-                if ( toSqix.getRank().get() == ERank::kRank1 )
-                {
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kQueen ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kRook ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kBishop ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kKnight ) );
-                }
-                else
-                {
-                    rMoves.addMove( CMove( fromSqix, toSqix ) );
-                }
-            }
+                addPawnCapture<C>( rMoves, fromSqix, toSqix, bEnPassant );
         }
 
         //
@@ -780,845 +685,1069 @@ void CPos::genBlackPawnCaptures( CMoves& rMoves )
         //
         if ( toSqix.getFile().get() != EFile::kFileH )
         {
-            fromSqix = toSqix.plusRanks( 1 ).plusFiles( 1 );
+            fromSqix = T::behind( toSqix, 1 ).plusFiles( 1 );
             if ( bbFrom.atSquare( fromSqix ).get() )
-            {
-                if ( toSqix.getRank().get() == ERank::kRank1 )
-                {
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kQueen ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kRook ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kBishop ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kKnight ) );
-                }
-                else
-                {
-                    rMoves.addMove( CMove( fromSqix, toSqix ) );
-                }
-            }
+                addPawnCapture<C>( rMoves, fromSqix, toSqix, bEnPassant );
         }
     }
 }
 
 ///
-/// generates pawn pushes for black
+/// generates pawn pushes
 ///
 /// @param rMoves
 ///     the pawn moves will be added to rMoves
 ///
-void CPos::genBlackPawnQuiets( CMoves& rMoves )
+template <EColor C>
+void CPos::genPawnQuiets( CMoves& rMoves )
 {
+    genPawnQuietsFrom<C>( 
+        rMoves, getPieces( C, EPieceType::kPawn ), ~CBitBoard( 0ULL ) );
+}
+
+///
+/// generates pawn pushes from a set of squares 
+///
+/// @param rMoves
+///     the pawn moves will be added to rMoves
+///
+/// @param bbFrom
+///     the pawns to generate the pushes of
+///
+/// @param bbTargets
+///     the squares the pushes may end on.  The square a double push passes
+///     over only has to be empty.
+///
+template <EColor C>
+void CPos::genPawnQuietsFrom( 
+    CMoves&         rMoves, 
+    CBitBoard       bbFrom, 
+    CBitBoard       bbTargets )
+{
+    typedef SColorTraits<C> T;
     CSqix           toSqix;
-    CSqix           fromSqix;
-    CBitBoard       bbTo;
    
     //
     //  Start with the single pushes
     //
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kPawn );
-    CBitBoard bbPop = bbTo = unoccupied( bbFrom.retreatRanks( 1 ) );
+    CBitBoard bbTo = unoccupied( T::forward( bbFrom ) );
+    CBitBoard bbPop = bbTo.get() & bbTargets.get();
     while ( bbPop.get() )
     {
-        toSqix = bbPop.popLsb();
-        fromSqix = toSqix.plusRanks( 1 );
-        if ( toSqix.getRank().get() == ERank::kRank1 )
-        {
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kQueen ) );
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kRook ) );
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kBishop ) );
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kKnight ) );
-        }
-        else
-        {
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+        toSqix = T::popNext( bbPop );
+        addPawnMoves<C>( rMoves, T::behind( toSqix, 1 ), toSqix, false );
     }
 
     //
-    //  Push forward a second level if we are on the third rand.
+    //  Push forward a second rank if we just left the starting rank.
     //
-    bbPop = unoccupied( bbTo.onRank( ERank::kRank6 ).retreatRanks( 1 ) );
+    bbPop = unoccupied( T::forward( bbTo.onRank( T::kDoublePushRank ) ) ).get() 
+        & bbTargets.get();
     while ( bbPop.get() )
     {
-        toSqix = bbPop.popLsb();
-        fromSqix = toSqix.plusRanks( 2 );
-        rMoves.addMove( CMove( fromSqix, toSqix ) );
+        toSqix = T::popNext( bbPop );
+        rMoves.addMove( 
+            CMove( T::behind( toSqix, 2 ), toSqix, CMove::kDoublePush ) );
     }
 }
 
 ///
-/// generates rook captures for black
+/// generates the moves of a knight, bishop, rook, queen or king from a set 
+/// of squares to a set of target squares.
 ///
 /// @param rMoves
-///     the rook captures will be added to rMoves
+///     the moves will be added to rMoves
 ///
-void CPos::genBlackRookCaptures( CMoves& rMoves )
+/// @param bbFrom
+///     the squares from which the moves are to be generated
+///
+/// @param bbTargets
+///     the squares the moves may go to: the enemy pieces for captures, the
+///     empty squares for quiet moves, or both.  Each move is marked as a
+///     capture or not by whether its to square is occupied.
+///
+template <EColor C, EPieceType PT>
+void CPos::genPieceMovesFrom( 
+    CMoves&         rMoves, 
+    CBitBoard       bbFrom, 
+    CBitBoard       bbTargets )
 {
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kRook );
-    genBlackRookCapturesFrom( rMoves, bbFrom );
+    CSqix           toSqix;
+    CSqix           fromSqix;
+   
+    while ( bbFrom.get() )
+    {
+        fromSqix = SColorTraits<C>::popNext( bbFrom ); 
+        CBitBoard bbTo = attacksFrom<PT>( fromSqix ).get() & bbTargets.get();
+        while ( bbTo.get() )
+        {
+            toSqix = SColorTraits<C>::popNext( bbTo ); 
+            rMoves.addMove( CMove( fromSqix, toSqix, 
+                occupied( toSqix.asBitBoard() ).get() 
+                    ? CMove::kCapture : CMove::kQuiet ) );
+        }
+    }
 }
 
 ///
-/// generates rook captures for black from a set of squares
+/// generates the moves of one type of piece to a set of target squares, 
+/// keeping pinned pieces on the line through their king.  Pinned knights 
+/// end up with no moves, since no knight move stays on a line.
 ///
-/// @param rMoves
-///     the rook captures will be added to rMoves
+/// @param bbTargets
+///     the squares the moves may go to
+///
+/// @param bbPinned
+///     our pinned pieces
 ///
-void CPos::genBlackRookCapturesFrom( CMoves& rMoves, CBitBoard bbFrom )
+template <EColor C, EPieceType PT>
+void CPos::genPinnedAwareMoves( 
+    CMoves&         rMoves, 
+    CBitBoard       bbTargets, 
+    CBitBoard       bbPinned, 
+    CSqix           kingSqix )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
-    while ( bbFrom.get() )
-    {
-        fromSqix = bbFrom.popLsb(); 
+    CBitBoard bbFrom = getPieces( C, PT ).get() & ~bbPinned.get();
+    CBitBoard bbPinnedFrom = getPieces( C, PT ).get() & bbPinned.get();
+    CBitBoard bbCaptureTargets 
+        = bbTargets.get() & mbbColor[U8( SColorTraits<C>::kEnemy )].get();
 
-        //
-        //  Get the rays from the rook position to the edge of the board in
-        //  each of the four directions.  (The rook's square is not included
-        //  in these rays.
-        //
-        CBitBoard bbNorthRay = CGen::mbbRookRays[fromSqix.get()].mbbNorth;
-        CBitBoard bbEastRay = CGen::mbbRookRays[fromSqix.get()].mbbEast;
-        CBitBoard bbSouthRay = CGen::mbbRookRays[fromSqix.get()].mbbSouth;
-        CBitBoard bbWestRay = CGen::mbbRookRays[fromSqix.get()].mbbWest;
+    if ( PT == EPieceType::kPawn )
+    {
+        genPawnQuietsFrom<C>( rMoves, bbFrom, bbTargets );
+        genPawnCapturesFrom<C>( rMoves, bbFrom, bbCaptureTargets );
+    }
+    else
+    {
+        genPieceMovesFrom<C, PT>( rMoves, bbFrom, bbTargets );
+    }
 
-        //
-        //  Find the square of the blocking piece in each direction, and if 
-        //  it's black, generate a capture
-        //
-        if ( ( bbOccRay = occupied( bbSouthRay ) ).get() )
-        {
-            toSqix = bbOccRay.msb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbEastRay ) ).get() )
-        {
-            toSqix = bbOccRay.lsb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbWestRay ) ).get() )
+    while ( bbPinnedFrom.get() )
+    {
+        CSqix fromSqix = SColorTraits<C>::popNext( bbPinnedFrom );
+        YBitBoard bbLine = CGen::mbbLine[kingSqix.get()][fromSqix.get()];
+        if ( PT == EPieceType::kPawn )
         {
-            toSqix = bbOccRay.msb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
+            genPawnQuietsFrom<C>( rMoves, fromSqix.asBitBoard(), 
+                bbTargets.get() & bbLine );
+            genPawnCapturesFrom<C>( rMoves, fromSqix.asBitBoard(), 
+                bbCaptureTargets.get() & bbLine );
         }
-        if ( ( bbOccRay = occupied( bbNorthRay ) ).get() )
+        else
         {
-            toSqix = bbOccRay.lsb().get();
-            if ( isWhite( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
+            genPieceMovesFrom<C, PT>( rMoves, fromSqix.asBitBoard(), 
+                bbTargets.get() & bbLine );
         }
     }
 }
 
 ///
-/// generates captures for the black queen.
+/// generates captures for the queens.  The rook-wise captures of every 
+/// queen come first, then the bishop-wise captures.
 ///
 /// @param rMoves
 ///     the queen captures will be added to rMoves
 ///
-void CPos::genBlackQueenCaptures( CMoves& rMoves )
+template <EColor C>
+void CPos::genQueenCaptures( CMoves& rMoves )
 {
-    genBlackRookCapturesFrom( 
-        rMoves, getPieces( EColor::kBlack, EPieceType::kQueen ) );
-    genBlackBishopCapturesFrom( 
-        rMoves, getPieces( EColor::kBlack, EPieceType::kQueen ) );
+    CBitBoard bbQueens = getPieces( C, EPieceType::kQueen );
+    CBitBoard bbEnemy = mbbColor[U8( SColorTraits<C>::kEnemy )];
+    genPieceMovesFrom<C, EPieceType::kRook>( rMoves, bbQueens, bbEnemy );
+    genPieceMovesFrom<C, EPieceType::kBishop>( rMoves, bbQueens, bbEnemy );
 }
 
 ///
-/// generates quiet moves for the black queen.
+/// generates quiet moves for the queens, rook-wise first then bishop-wise.
 ///
 /// @param rMoves
 ///     the queen moves will be added to rMoves
 ///
-void CPos::genBlackQueenQuiets( CMoves& rMoves )
+template <EColor C>
+void CPos::genQueenQuiets( CMoves& rMoves )
 {
-    genBlackRookQuietsFrom( 
-        rMoves, getPieces( EColor::kBlack, EPieceType::kQueen ) );
-    genBlackBishopQuietsFrom( 
-        rMoves, getPieces( EColor::kBlack, EPieceType::kQueen ) );
+    CBitBoard bbQueens = getPieces( C, EPieceType::kQueen );
+    genPieceMovesFrom<C, EPieceType::kRook>( rMoves, bbQueens, ~occupied() );
+    genPieceMovesFrom<C, EPieceType::kBishop>( 
+        rMoves, bbQueens, ~occupied() );
 }
 
 ///
-/// generates rook non-captures for black
+/// generates rook captures
 ///
 /// @param rMoves
-///     the rook moves will be added to rMoves
+///     the rook captures will be added to rMoves
 ///
-void CPos::genBlackRookQuiets( CMoves& rMoves )
+template <EColor C>
+void CPos::genRookCaptures( CMoves& rMoves )
 {
-    CBitBoard bbFrom = getPieces( EColor::kBlack, EPieceType::kRook );
-    genBlackRookQuietsFrom( rMoves, bbFrom );
+    genPieceMovesFrom<C, EPieceType::kRook>( rMoves, 
+        getPieces( C, EPieceType::kRook ), 
+        mbbColor[U8( SColorTraits<C>::kEnemy )] );
 }
 
 ///
-/// generates rook non-captures for black
+/// generates rook non-captures
 ///
 /// @param rMoves
 ///     the rook moves will be added to rMoves
 ///
-void CPos::genBlackRookQuietsFrom( CMoves& rMoves, CBitBoard bbFrom )
+template <EColor C>
+void CPos::genRookQuiets( CMoves& rMoves )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
-    while ( bbFrom.get() )
+    genPieceMovesFrom<C, EPieceType::kRook>( rMoves, 
+        getPieces( C, EPieceType::kRook ), ~occupied() );
+}
+
+//
+//  The generators are instantiated here for both colors, so that callers 
+//  only need the declarations in position.h.
+//
+template void CPos::findCheckers<EColor::kWhite>();
+template void CPos::findCheckers<EColor::kBlack>();
+template void CPos::genPawnQuiets<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genPawnQuiets<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genPawnCaptures<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genPawnCaptures<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genKnightQuiets<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genKnightQuiets<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genKnightCaptures<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genKnightCaptures<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genBishopQuiets<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genBishopQuiets<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genBishopCaptures<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genBishopCaptures<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genRookQuiets<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genRookQuiets<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genRookCaptures<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genRookCaptures<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genQueenQuiets<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genQueenQuiets<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genQueenCaptures<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genQueenCaptures<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genKingQuiets<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genKingQuiets<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genKingCaptures<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genKingCaptures<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genCastles<EColor::kWhite>( CMoves& rMoves ) const;
+template void CPos::genCastles<EColor::kBlack>( CMoves& rMoves ) const;
+template void CPos::genMoves<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genMoves<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genEvasions<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genEvasions<EColor::kBlack>( CMoves& rMoves );
+template void CPos::genLegalMoves<EColor::kWhite>( CMoves& rMoves );
+template void CPos::genLegalMoves<EColor::kBlack>( CMoves& rMoves );
+
+///
+/// checks a move from outside the generators, such as a hash move or a 
+/// killer, against this position.  The kind of the move has to be the one
+/// the generators would give it here.  It does not check that the king is
+/// left safe.
+///
+/// @param m
+///     is the move to check
+///
+/// @returns 
+///     true if one of the pseudo-legal generators would generate the move
+///
+bool CPos::isPseudoLegal( CMove m ) const
+{
+    CSqix fromSqix = m.getFrom();
+    CSqix toSqix = m.getTo();
+    CPiece pieceMoved = mBoard[fromSqix.get()];
+    CPiece pieceCaptured = mBoard[toSqix.get()];
+    bool bOccupied = pieceCaptured.get() != EPiece::kNone;
+
+    if ( m.isNull() || pieceMoved.get() == EPiece::kNone 
+        || pieceMoved.getColor().get() != mWhoseMove.get() )
     {
-        fromSqix = bbFrom.popLsb(); 
+        return false;
+    }
+    if ( bOccupied && pieceCaptured.getColor().get() == mWhoseMove.get() )
+        return false;
 
-        //
-        //  Get the rays from the rook position to the edge of the board in
-        //  each of the four directions.  (The rook's square is not included
-        //  in these rays.
-        //
-        CBitBoard bbNorthRay = CGen::mbbRookRays[fromSqix.get()].mbbNorth;
-        CBitBoard bbEastRay = CGen::mbbRookRays[fromSqix.get()].mbbEast;
-        CBitBoard bbSouthRay = CGen::mbbRookRays[fromSqix.get()].mbbSouth;
-        CBitBoard bbWestRay = CGen::mbbRookRays[fromSqix.get()].mbbWest;
+    //
+    //  Only en passant captures onto an empty square.
+    //
+    if ( m.isEnPassant() ? bOccupied : m.isCapture() != bOccupied )
+        return false;
 
-        //
-        //  For each of thes rays, find the blocker (if any) and mask off
-        //  the squares beyond the blocker.
-        //
-        if ( ( bbOccRay = occupied( bbSouthRay ) ).get() )
-            bbSouthRay &= CGen::mbbRookRays[bbOccRay.msb().get()].mbbNorth;
-        if ( ( bbOccRay = occupied( bbEastRay ) ).get() )
-            bbEastRay &= CGen::mbbRookRays[bbOccRay.lsb().get()].mbbWest;
-        if ( ( bbOccRay = occupied( bbWestRay ) ).get() )
-            bbWestRay &= CGen::mbbRookRays[bbOccRay.msb().get()].mbbEast;
-        if ( ( bbOccRay = occupied( bbNorthRay ) ).get() )
-            bbNorthRay &= CGen::mbbRookRays[bbOccRay.lsb().get()].mbbSouth;
-        CBitBoard bbTo = bbNorthRay.get() 
-            | bbEastRay.get() | bbSouthRay.get() | bbWestRay.get();
-        while ( bbTo.get() )
+    CBitBoard bbTo = toSqix.asBitBoard();
+    CMove::EKind plainKind = bOccupied ? CMove::kCapture : CMove::kQuiet;
+    switch ( pieceMoved.getPieceType().get() )
+    {
+    case EPieceType::kPawn:
+        break;
+    case EPieceType::kKnight:
+        return m.getKind() == plainKind
+            && ( attacksFrom<EPieceType::kKnight>( fromSqix ).get() 
+                & bbTo.get() );
+    case EPieceType::kBishop:
+        return m.getKind() == plainKind
+            && ( attacksFrom<EPieceType::kBishop>( fromSqix ).get() 
+                & bbTo.get() );
+    case EPieceType::kRook:
+        return m.getKind() == plainKind
+            && ( attacksFrom<EPieceType::kRook>( fromSqix ).get() 
+                & bbTo.get() );
+    case EPieceType::kQueen:
+        return m.getKind() == plainKind
+            && ( attacksFrom<EPieceType::kQueen>( fromSqix ).get() 
+                & bbTo.get() );
+    default:
+        if ( m.isCastle() )
         {
-            toSqix = bbTo.popLsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
+            CMoves castles;
+            if ( mWhoseMove.isWhite() )
+                genCastles<EColor::kWhite>( castles );
+            else
+                genCastles<EColor::kBlack>( castles );
+            for ( U16 ix = 0; ix < castles.getNumMoves(); ix++ )
+            {
+                if ( castles.get( ix ) == m )
+                    return true;
+            }
+            return false;
         }
+        return m.getKind() == plainKind
+            && ( attacksFrom<EPieceType::kKing>( fromSqix ).get() 
+                & bbTo.get() );
     }
-}
-
-///
-/// generates all quasi-legal moves in the position
-///
-void CPos::genWhiteMoves( CMoves& rMoves )
-{
-    genWhitePawnQuiets( rMoves );
-    genWhitePawnCaptures( rMoves );
-    genWhiteKnightQuiets( rMoves );
-    genWhiteKnightCaptures( rMoves );
-    genWhiteBishopQuiets( rMoves );
-    genWhiteBishopCaptures( rMoves );
-    genWhiteRookQuiets( rMoves );
-    genWhiteRookCaptures( rMoves );
-    genWhiteQueenQuiets( rMoves );
-    genWhiteQueenCaptures( rMoves );
-    genWhiteKingQuiets( rMoves );
-    genWhiteKingCaptures( rMoves );
-}
 
-///
-/// generates all quasi-legal moves in the position
-///
-void CPos::genWhiteLegalMoves( CMoves& rMoves )
-{
-    CMoves      quasiMoves;
+    //
+    //  A pawn move promotes exactly when it reaches the last rank.
+    //
+    bool bWhite = mWhoseMove.isWhite();
+    ERank promoRank = bWhite ? ERank::kRank8 : ERank::kRank1;
+    if ( m.isPromo() != ( toSqix.getRank().get() == promoRank ) )
+        return false;
 
-    genWhiteMoves( quasiMoves );
-    for ( int moveIx = 0; moveIx < quasiMoves.getNumMoves(); moveIx++ )
+    if ( fromSqix.getFile().get() != toSqix.getFile().get() )
     {
-        makeMove( quasiMoves.get( moveIx ) );
-        if ( !getCheckers().get() )
+        if ( !m.isCapture() 
+            || !( CGen::mbbPawnAttacks[U8( mWhoseMove.get() )]
+                [fromSqix.get()] & bbTo.get() ) )
         {
-            rMoves.addMove( quasiMoves.get( moveIx ) );
+            return false;
         }
-        unmakeMove( quasiMoves.get( moveIx ) );
+        if ( !m.isEnPassant() )
+            return true;
+        return mPosRights.isEnPassantLegal() 
+            && toSqix.get() == CSqix( 
+                bWhite ? ERank::kRank6 : ERank::kRank3,
+                mPosRights.getEnPassantFile() ).get();
     }
+
+    //
+    //  Pushes need empty squares, and a double push must start on the 
+    //  pawn's home rank.
+    //
+    if ( m.isCapture() || m.isCastle() )
+        return false;
+    CSqix oneSqix = bWhite ? fromSqix.plusRanks( 1 ) : fromSqix.minusRanks( 1 );
+    if ( toSqix.get() == oneSqix.get() )
+        return !m.isDoublePush();
+    ERank homeRank = bWhite ? ERank::kRank2 : ERank::kRank7;
+    CSqix twoSqix = bWhite ? fromSqix.plusRanks( 2 ) : fromSqix.minusRanks( 2 );
+    return m.isDoublePush()
+        && fromSqix.getRank().get() == homeRank 
+        && toSqix.get() == twoSqix.get()
+        && mBoard[oneSqix.get()].get() == EPiece::kNone;
 }
 
 ///
-/// generates bishop captures for white
+/// finds, for the side to move, the squares each type of piece would check
+/// the enemy king from, and the discoverers: our pieces that are the only
+/// piece between the king and one of our sliders.
 ///
-/// @param rMoves
-///     the bishop captures will be added to rMoves
-///
-void CPos::genWhiteBishopCaptures( CMoves& rMoves )
+void CPos::computeCheckInfo() const
 {
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kBishop );
-    genWhiteBishopCapturesFrom( rMoves, bbFrom );
+    CColor us = mWhoseMove;
+    CColor them = us.getOpponent();
+    CSqix kingSqix = getPieces( them, EPieceType::kKing ).lsb();
+    CBitBoard bbBishopChecks = CMagic::bishopAttacks( kingSqix, occupied() );
+    CBitBoard bbRookChecks = CMagic::rookAttacks( kingSqix, occupied() );
+
+    //
+    //  Our pawns check the king from the squares an enemy pawn on the 
+    //  king's square would attack.
+    //
+    mbbCheckSquares[U8( EPieceType::kPawn )] 
+        = CGen::mbbPawnAttacks[U8( them.get() )][kingSqix.get()];
+    mbbCheckSquares[U8( EPieceType::kKnight )] 
+        = CGen::mbbKnightAttacks[kingSqix.get()];
+    mbbCheckSquares[U8( EPieceType::kBishop )] = bbBishopChecks;
+    mbbCheckSquares[U8( EPieceType::kRook )] = bbRookChecks;
+    mbbCheckSquares[U8( EPieceType::kQueen )] 
+        = bbBishopChecks.get() | bbRookChecks.get();
+    mbbCheckSquares[U8( EPieceType::kKing )] = 0ULL;
+
+    //
+    //  The snipers are our sliders that would attack the king on an empty
+    //  board.
+    //
+    CBitBoard bbQueens = getPieces( us, EPieceType::kQueen );
+    CBitBoard bbSnipers 
+        = ( CMagic::rookAttacks( kingSqix, CBitBoard( 0ULL ) ).get() 
+            & ( getPieces( us, EPieceType::kRook ).get() 
+                | bbQueens.get() ) )
+        | ( CMagic::bishopAttacks( kingSqix, CBitBoard( 0ULL ) ).get() 
+            & ( getPieces( us, EPieceType::kBishop ).get() 
+                | bbQueens.get() ) );
+    mbbDiscoverers = 0ULL;
+    while ( bbSnipers.get() )
+    {
+        YBitBoard bbBetween = CGen::mbbBetween[kingSqix.get()]
+            [bbSnipers.popLsb().get()] & occupied().get();
+        if ( bbBetween && !( bbBetween & ( bbBetween - 1 ) ) )
+            mbbDiscoverers |= bbBetween & mbbColor[U8( us.get() )].get();
+    }
+    mbCheckInfoValid = true;
 }
 
 ///
-/// generates bishop captures for white from the squares in the bitboard that 
-/// is passed.
+/// tells whether a move gives check, without making it.  Most moves take
+/// a few bitboard operations on the check info cached for the node.  
+/// Promotions, en passant and castling look at the occupancy the move 
+/// would leave.
 ///
-/// @param bbFrom
-///     the squares from which the diagonal moves are to be generated
+/// @param m
+///     is the move, which must be pseudo-legal in this position
 ///
-/// @param rMoves
-///     the bishop captures will be added to rMoves
+/// @returns
+///     true if the move checks the enemy king
 ///
-void CPos::genWhiteBishopCapturesFrom( CMoves& rMoves, CBitBoard bbFrom )
+bool CPos::givesCheck( CMove m ) const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
-    while ( bbFrom.get() )
+    if ( !mbCheckInfoValid )
+        computeCheckInfo();
+
+    CSqix fromSqix = m.getFrom();
+    CSqix toSqix = m.getTo();
+    CColor us = mWhoseMove;
+    CSqix kingSqix = getPieces( us.getOpponent(), EPieceType::kKing ).lsb();
+    YBitBoard bbFrom = fromSqix.asBitBoard();
+    YBitBoard bbTo = toSqix.asBitBoard();
+    YBitBoard bbKing = kingSqix.asBitBoard();
+
+    //
+    //  A direct check by the piece moved, or a discovered one if it leaves
+    //  the line between the king and the slider behind it.
+    //
+    if ( mbbCheckSquares[U8( 
+            mBoard[fromSqix.get()].getPieceType().get() )].get() & bbTo )
+    {
+        return true;
+    }
+    if ( ( mbbDiscoverers.get() & bbFrom ) 
+        && !( CGen::mbbLine[kingSqix.get()][fromSqix.get()] & bbTo ) )
     {
-        fromSqix = bbFrom.popMsb(); 
+        return true;
+    }
 
-        //
-        //  Get the rays from the rook position to the edge of the board in
-        //  each of the four directions.  (The rook's square is not included
-        //  in these rays.
-        //
-        CBitBoard bbNorthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthEast;
-        CBitBoard bbSouthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthEast;
-        CBitBoard bbSouthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthWest;
-        CBitBoard bbNorthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthWest;
-        
-        //
-        //  Find the square of the blocking piece in each direction, and if 
-        //  it's black, generate a capture
-        //
-        if ( ( bbOccRay = occupied( bbNorthEastRay ) ).get() )
-        {
-            toSqix = bbOccRay.lsb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbNorthWestRay ) ).get() )
-        {
-            toSqix = bbOccRay.lsb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbSouthEastRay ) ).get() )
-        {
-            toSqix = bbOccRay.msb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbSouthWestRay ) ).get() )
+    CBitBoard bbOccupied = ( occupied().get() ^ bbFrom ) | bbTo;
+    switch ( m.getKind() )
+    {
+    case CMove::kPromo:
+    case CMove::kPromoCapture:
+        switch ( m.getPromo().get() )
         {
-            toSqix = bbOccRay.msb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
+        case EPieceType::kKnight:
+            return ( CGen::mbbKnightAttacks[toSqix.get()] & bbKing ) != 0;
+        case EPieceType::kBishop:
+            return ( CMagic::bishopAttacks( toSqix, bbOccupied ).get() 
+                & bbKing ) != 0;
+        case EPieceType::kRook:
+            return ( CMagic::rookAttacks( toSqix, bbOccupied ).get() 
+                & bbKing ) != 0;
+        default:
+            return ( CMagic::queenAttacks( toSqix, bbOccupied ).get() 
+                & bbKing ) != 0;
         }
-    }
-}
-
-///
-/// generates bishop non-captures for white
-///
-/// @param rMoves
-///     the bishop moves will be added to rMoves
-///
-void CPos::genWhiteBishopQuiets( CMoves& rMoves )
-{
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kBishop );
-    genWhiteBishopQuietsFrom( rMoves, bbFrom );
-}
 
-///
-/// generates bishop non-captures for white
-///
-/// @param rMoves
-///     the bishop moves will be added to rMoves
-///
-/// @param bbFrom
-///     the set of squares from which the diagonal moves are to be made
-///
-void CPos::genWhiteBishopQuietsFrom( CMoves& rMoves, CBitBoard bbFrom )
-{
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
-    while ( bbFrom.get() )
+    case CMove::kEnPassant:
     {
-        fromSqix = bbFrom.popMsb(); 
-
         //
-        //  Get the rays from the bishop position to the edge of the board in
-        //  each of the four directions.  (The bishop's square is not included
-        //  in these rays.
+        //  Taking the pawn beside ours off the board can open a line.
         //
-        CBitBoard bbNorthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthEast;
-        CBitBoard bbSouthEastRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthEast;
-        CBitBoard bbSouthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbSouthWest;
-        CBitBoard bbNorthWestRay 
-            = CGen::mbbBishopRays[fromSqix.get()].mbbNorthWest;
+        bbOccupied ^= CSqix( fromSqix.getRank(), toSqix.getFile() )
+            .asBitBoard();
+        CBitBoard bbQueens = getPieces( us, EPieceType::kQueen );
+        return ( CMagic::rookAttacks( kingSqix, bbOccupied ).get() 
+                & ( getPieces( us, EPieceType::kRook ).get() 
+                    | bbQueens.get() ) )
+            || ( CMagic::bishopAttacks( kingSqix, bbOccupied ).get() 
+                & ( getPieces( us, EPieceType::kBishop ).get() 
+                    | bbQueens.get() ) );
+    }
 
-        //
-        //  For each of thes rays, find the blocker (if any) and mask off
-        //  the squares beyond the blocker.
-        //
-        if ( ( bbOccRay = occupied( bbNorthEastRay ) ).get() )
-        {
-            bbNorthEastRay 
-                &= CGen::mbbBishopRays[bbOccRay.lsb().get()].mbbSouthWest;
-        }
-        if ( ( bbOccRay = occupied( bbSouthEastRay ) ).get() )
-        {
-            bbSouthEastRay 
-                &= CGen::mbbBishopRays[bbOccRay.msb().get()].mbbNorthWest;
-        }
-        if ( ( bbOccRay = occupied( bbSouthWestRay ) ).get() )
-        {
-            bbSouthWestRay 
-                &= CGen::mbbBishopRays[bbOccRay.msb().get()].mbbNorthEast;
-        }
-        if ( ( bbOccRay = occupied( bbNorthWestRay ) ).get() )
-        {
-            bbNorthWestRay 
-                &= CGen::mbbBishopRays[bbOccRay.lsb().get()].mbbSouthEast;
-        }
-        CBitBoard bbTo 
-            = bbNorthEastRay.get() 
-            | bbSouthEastRay.get() 
-            | bbSouthWestRay.get() 
-            | bbNorthWestRay.get();
-        while ( bbTo.get() )
-        {
-            toSqix = bbTo.popMsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+    case CMove::kCastle:
+    {
+        CSqix rookFromSqix;
+        CSqix rookToSqix;
+        getCastleRookSqixes( toSqix, rookFromSqix, rookToSqix );
+        bbOccupied = ( bbOccupied.get() ^ rookFromSqix.asBitBoard() ) 
+            | rookToSqix.asBitBoard();
+        return ( CMagic::rookAttacks( rookToSqix, bbOccupied ).get() 
+            & bbKing ) != 0;
+    }
+
+    default:
+        return false;
     }
 }
 
+//
+//  Piece values for the static exchange evaluation, indexed by EPieceType.
+//  The king outweighs everything else, so an exchange never trades it.
+//
+static const S32 kSeeValues[U8( EPieceType::kNum )] =
+    { 100, 320, 330, 500, 900, 20000 };
+
 ///
-/// generates king captures for white
-///
-/// @param rMoves
-///     the king captures will be added to rMoves
+/// @returns
+///     the pieces of both colors that attack a square through the given 
+///     occupancy.  Sliders are found through the occupancy, and the other 
+///     pieces from the board, so mask the result with the occupancy when 
+///     pieces have been taken off it.
 ///
-void CPos::genWhiteKingCaptures( CMoves& rMoves )
+CBitBoard CPos::attackersTo( CSqix sqix, CBitBoard bbOccupied ) const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kKing );
-    fromSqix = bbFrom.msb(); 
-    CBitBoard bbTo = CGen::mbbKingAttacks[fromSqix.get()] 
-        & mbbColor[U8( EColor::kBlack )].get();
-    while ( bbTo.get() )
-    {
-        toSqix = bbTo.popMsb(); 
-        rMoves.addMove( CMove( fromSqix, toSqix ) );
-    }
+    YBitBoard bbQueens = mbbPieceType[U8( EPieceType::kQueen )].get();
+    return ( CGen::mbbPawnAttacks[U8( EColor::kBlack )][sqix.get()]
+            & getPieces( EColor::kWhite, EPieceType::kPawn ).get() )
+        | ( CGen::mbbPawnAttacks[U8( EColor::kWhite )][sqix.get()]
+            & getPieces( EColor::kBlack, EPieceType::kPawn ).get() )
+        | ( CGen::mbbKnightAttacks[sqix.get()] 
+            & mbbPieceType[U8( EPieceType::kKnight )].get() )
+        | ( CGen::mbbKingAttacks[sqix.get()] 
+            & mbbPieceType[U8( EPieceType::kKing )].get() )
+        | ( CMagic::bishopAttacks( sqix, bbOccupied ).get() 
+            & ( mbbPieceType[U8( EPieceType::kBishop )].get() | bbQueens ) )
+        | ( CMagic::rookAttacks( sqix, bbOccupied ).get() 
+            & ( mbbPieceType[U8( EPieceType::kRook )].get() | bbQueens ) );
 }
 
 ///
-/// generates king non-captures for white
+/// @returns
+///     true if the king of a color is attacked, as after a pseudo-legal 
+///     move that left it in check
 ///
-/// @param rMoves
-///     the king moves will be added to rMoves
+bool CPos::isKingAttacked( CColor c ) const
+{
+    return ( attackersTo( getPieces( c, EPieceType::kKing ).lsb(), 
+        occupied() ).get() & mbbColor[U8( c.getOpponent().get() )].get() ) 
+        != 0;
+}
+
 ///
-void CPos::genWhiteKingQuiets( CMoves& rMoves )
+/// tells whether the position is drawn by the fifty move rule or by 
+/// repeating a position reached by the moves on the undo stack.  The 
+/// search counts a single repetition as a draw, since whoever could avoid
+/// it would have.  Only positions since the last capture or pawn move, 
+/// with the same side to move, can repeat.
+///
+bool CPos::isDraw() const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kKing );
-    fromSqix = bbFrom.msb(); 
-    CBitBoard bbTo = unoccupied( CGen::mbbKingAttacks[fromSqix.get()] );
-    while ( bbTo.get() )
+    if ( mHalfMoveClock >= 100 )
+        return true;
+
+    U16 numBack = std::min( U16( mHalfMoveClock ), mNumUndos );
+    for ( U16 back = 4; back <= numBack; back += 2 )
     {
-        toSqix = bbTo.popMsb(); 
-        rMoves.addMove( CMove( fromSqix, toSqix ) );
+        if ( mpUndos[mNumUndos - back].mHashKey == mHashKey )
+            return true;
     }
+    return false;
 }
 
 ///
-/// generates knight captures for white
+/// starts an exchange with the move itself
 ///
-/// @param rMoves
-///     the knight captures will be added to rMoves
+/// @param rOnTarget
+///     receives the value of the piece the move leaves on its to square, 
+///     which the first recapture wins
+///
+/// @param rbbOccupied
+///     receives the occupied squares after the move
+///
+/// @returns
+///     the value the move captures, plus what a promotion gains
 ///
-void CPos::genWhiteKnightCaptures( CMoves& rMoves )
+S32 CPos::seeFirstCapture( 
+    CMove           m, 
+    S32&            rOnTarget, 
+    CBitBoard&      rbbOccupied ) const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kKnight );
-    while ( bbFrom.get() )
+    CSqix fromSqix = m.getFrom();
+    CSqix toSqix = m.getTo();
+    S32 gain = 0;
+
+    rbbOccupied = ( occupied().get() ^ fromSqix.asBitBoard() ) 
+        | toSqix.asBitBoard();
+    if ( m.isEnPassant() )
     {
-        fromSqix = bbFrom.popMsb(); 
-        CBitBoard bbTo = CGen::mbbKnightAttacks[fromSqix.get()] 
-            & mbbColor[U8( EColor::kBlack )].get();
-        while ( bbTo.get() )
-        {
-            toSqix = bbTo.popMsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+        gain = kSeeValues[U8( EPieceType::kPawn )];
+        rbbOccupied ^= CSqix( fromSqix.getRank(), toSqix.getFile() )
+            .asBitBoard();
+    }
+    else if ( m.isCapture() )
+    {
+        gain = kSeeValues[U8( mBoard[toSqix.get()].getPieceType().get() )];
+    }
+
+    rOnTarget 
+        = kSeeValues[U8( mBoard[fromSqix.get()].getPieceType().get() )];
+    if ( m.isPromo() )
+    {
+        rOnTarget = kSeeValues[U8( m.getPromo().get() )];
+        gain += rOnTarget - kSeeValues[U8( EPieceType::kPawn )];
     }
+    return gain;
 }
 
 ///
-/// generates knight non-captures for white
+/// takes the least valuable attacker of one side off the board for the 
+/// next capture of an exchange, and adds the sliders behind it
 ///
-/// @param rMoves
-///     the knight moves will be added to rMoves
+/// @param bbSideAttackers
+///     are the attackers of the side to capture, at least one
 ///
-void CPos::genWhiteKnightQuiets( CMoves& rMoves )
+/// @param rbbOccupied
+///     are the occupied squares, which lose the attacker
+///
+/// @param rbbAttackers
+///     are the attackers of both sides still on the board, which lose the
+///     attacker and gain the sliders it uncovers
+///
+/// @returns
+///     the type of the attacker
+///
+EPieceType CPos::popLeastValuable( 
+    CSqix           toSqix, 
+    CBitBoard       bbSideAttackers, 
+    CBitBoard&      rbbOccupied, 
+    CBitBoard&      rbbAttackers ) const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kKnight );
-    while ( bbFrom.get() )
+    U8 pt = U8( EPieceType::kPawn );
+    YBitBoard bbPieces;
+    while ( !( bbPieces = bbSideAttackers.get() & mbbPieceType[pt].get() ) )
+        pt++;
+    rbbOccupied ^= bbPieces & ( 0 - bbPieces );
+
+    //
+    //  Only a capture along a line can uncover another slider on it.
+    //
+    YBitBoard bbQueens = mbbPieceType[U8( EPieceType::kQueen )].get();
+    if ( pt == U8( EPieceType::kPawn ) || pt == U8( EPieceType::kBishop )
+        || pt == U8( EPieceType::kQueen ) )
     {
-        fromSqix = bbFrom.popMsb(); 
-        CBitBoard bbTo = unoccupied( CGen::mbbKnightAttacks[fromSqix.get()] );
-        while ( bbTo.get() )
-        {
-            toSqix = bbTo.popMsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+        rbbAttackers |= CMagic::bishopAttacks( toSqix, rbbOccupied ).get() 
+            & ( mbbPieceType[U8( EPieceType::kBishop )].get() | bbQueens );
+    }
+    if ( pt == U8( EPieceType::kRook ) || pt == U8( EPieceType::kQueen ) )
+    {
+        rbbAttackers |= CMagic::rookAttacks( toSqix, rbbOccupied ).get() 
+            & ( mbbPieceType[U8( EPieceType::kRook )].get() | bbQueens );
     }
+    rbbAttackers &= rbbOccupied;
+    return EPieceType( pt );
 }
 
 ///
-/// generates pawn captures for white
+/// the static exchange evaluation of a move: the material the side to move
+/// ends up with if both sides keep capturing on the move's to square with
+/// their least valuable piece, each stopping when that pays better.  The
+/// position is not changed.  Pins are ignored, and a king only captures 
+/// onto an undefended square.
 ///
-/// @param rMoves
-///     the pawn captures will be added to rMoves
+/// @param m
+///     is the move, usually a capture
+///
+/// @returns
+///     the material won, negative if the move loses material
 ///
-void CPos::genWhitePawnCaptures( CMoves& rMoves )
+S32 CPos::see( CMove m ) const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-   
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kPawn );
+    if ( m.isCastle() )
+        return 0;
 
     //
-    //  We can capture on squares that have a black piece or that have just
-    //  passed by (for an en-passant).
+    //  gains[d] is what the side making capture d wins, if the other side 
+    //  then stops.  An exchange has fewer captures than there are pieces.
     //
-    CBitBoard bbTargets = mbbColor[U8( EColor::kBlack )];
-    if ( mPosRights.isEnPassantLegal() )
+    S32 gains[32];
+    S32 onTarget;
+    CBitBoard bbOccupied;
+    CSqix toSqix = m.getTo();
+    gains[0] = seeFirstCapture( m, onTarget, bbOccupied );
+
+    CBitBoard bbAttackers 
+        = attackersTo( toSqix, bbOccupied ).get() & bbOccupied.get();
+    CColor side = mWhoseMove.getOpponent();
+    U8 depth = 0;
+    for ( ;; )
     {
-        bbTargets.setSquare( 
-            CSqix( ERank::kRank6, mPosRights.getEnPassantFile() ).get() );
-    }
-    CBitBoard bbUp1 = bbFrom.advanceRanks( 1 );
-    CBitBoard bbTo = bbTargets.get() 
-        & ( bbUp1.leftFiles( 1 ).get() | bbUp1.rightFiles( 1 ).get() );
-    while ( bbTo.get() )
-    {
-        toSqix = bbTo.popMsb();
-        //
-        //  Is there a capturing pawn to the left of the target?
-        //
-        if ( toSqix.getFile().get() != EFile::kFileA )
+        CBitBoard bbSideAttackers 
+            = bbAttackers.get() & mbbColor[U8( side.get() )].get();
+        if ( !bbSideAttackers.get() )
+            break;
+        EPieceType pt = popLeastValuable( 
+            toSqix, bbSideAttackers, bbOccupied, bbAttackers );
+        if ( pt == EPieceType::kKing && ( bbAttackers.get() 
+                & mbbColor[U8( side.getOpponent().get() )].get() ) )
         {
-            fromSqix = toSqix.minusRanks( 1 ).minusFiles( 1 );
-            if ( bbFrom.atSquare( fromSqix ).get() )
-            {
-                if ( toSqix.getRank().get() == ERank::kRank8 )
-                {
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kQueen ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kRook ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kBishop ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kKnight ) );
-                }
-                else
-                {
-                    rMoves.addMove( CMove( fromSqix, toSqix ) );
-                }
-            }
+            break;
         }
+        depth++;
+        gains[depth] = onTarget - gains[depth - 1];
+        onTarget = kSeeValues[U8( pt )];
+        side = side.getOpponent();
+    }
 
-        //
-        //  Is there a capturing pawn to the right of the target?
-        //
-        if ( toSqix.getFile().get() != EFile::kFileH )
-        {
-            fromSqix = toSqix.minusRanks( 1 ).plusFiles( 1 );
-            if ( bbFrom.atSquare( fromSqix ).get() )
-            {
-                if ( toSqix.getRank().get() == ERank::kRank8 )
-                {
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kQueen ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kRook ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kBishop ) );
-                    rMoves.addMove( 
-                        CMove( fromSqix, toSqix, EPieceType::kKnight ) );
-                }
-                else
-                {
-                    rMoves.addMove( CMove( fromSqix, toSqix ) );
-                }
-            }
-        }
+    //
+    //  Each side may stop instead of capturing, working back from the end.
+    //
+    while ( depth > 0 )
+    {
+        gains[depth - 1] = -std::max( -gains[depth - 1], gains[depth] );
+        depth--;
     }
+    return gains[0];
 }
 
 ///
-/// generates pawn pushes for white
+/// tells whether the static exchange evaluation of a move reaches a 
+/// threshold, which is cheaper than computing it: the exchange stops as 
+/// soon as one side can't get back across the threshold.
 ///
-/// @param rMoves
-///     the pawn moves will be added to rMoves
+/// @param m
+///     is the move, usually a capture
+///
+/// @param threshold
+///     is the material the move has to win, or minus what it may lose
 ///
-void CPos::genWhitePawnQuiets( CMoves& rMoves )
+/// @returns
+///     true if see( m ) >= threshold
+///
+bool CPos::seeGE( CMove m, S32 threshold ) const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CBitBoard       bbTo;
-   
+    if ( m.isCastle() )
+        return threshold <= 0;
+
     //
-    //  Start with the single pushes
+    //  swap is how far past the threshold the side that just captured is
+    //  if the other side stops now, from the other side's point of view.
     //
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kPawn );
-    CBitBoard bbPop = bbTo = unoccupied( bbFrom.advanceRanks( 1 ) );
-    while ( bbPop.get() )
+    S32 onTarget;
+    CBitBoard bbOccupied;
+    CSqix toSqix = m.getTo();
+    S32 swap = seeFirstCapture( m, onTarget, bbOccupied ) - threshold;
+    if ( swap < 0 )
+        return false;
+    swap = onTarget - swap;
+    if ( swap <= 0 )
+        return true;
+
+    CBitBoard bbAttackers 
+        = attackersTo( toSqix, bbOccupied ).get() & bbOccupied.get();
+    CColor side = mWhoseMove;
+    bool bResult = true;
+    for ( ;; )
     {
-        toSqix = bbPop.popMsb();
-        fromSqix = toSqix.minusRanks( 1 );
-        if ( toSqix.getRank().get() == ERank::kRank8 )
-        {
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kQueen ) );
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kRook ) );
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kBishop ) );
-            rMoves.addMove( CMove( fromSqix, toSqix, EPieceType::kKnight ) );
-        }
-        else
+        side = side.getOpponent();
+        CBitBoard bbSideAttackers 
+            = bbAttackers.get() & mbbColor[U8( side.get() )].get();
+        if ( !bbSideAttackers.get() )
+            break;
+        bResult = !bResult;
+        EPieceType pt = popLeastValuable( 
+            toSqix, bbSideAttackers, bbOccupied, bbAttackers );
+        if ( pt == EPieceType::kKing )
         {
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
+            return ( bbAttackers.get() 
+                & mbbColor[U8( side.getOpponent().get() )].get() ) 
+                ? !bResult : bResult;
         }
+        swap = kSeeValues[U8( pt )] - swap;
+        if ( swap < S32( bResult ) )
+            break;
     }
+    return bResult;
+}
 
+///
+/// makes the specified move in this position, ignoring duplicate positions.
+/// The move must be legal.  What is needed to unmake it is pushed on the
+/// undo stack.  The checkers are left as they were, for the move generator
+/// to find.
+///
+/// @param m
+///     is the move to make
+///
+void CPos::makeMove( CMove m )
+{
     //
-    //  Push forward a second level if we are on the third rand.
+    //  Checked in release builds too, since going on would write past the
+    //  end of the stack.  A copy-made child has no stack to write to.
     //
-    bbPop = unoccupied( bbTo.onRank( ERank::kRank3 ).advanceRanks( 1 ) );
-    while ( bbPop.get() )
+    if ( !mpUndos || mNumUndos >= kMaxUndos )
+        std::abort();
+    SUndo& rUndo = mpUndos[mNumUndos++];
+    rUndo.mHashKey = mHashKey;
+    rUndo.mbbCheckers = mbbCheckers;
+    rUndo.mPieceCaptured = mBoard[m.getTo().get()];
+    rUndo.mRights = mPosRights.asU8();
+    rUndo.mHalfMoveClock = mHalfMoveClock;
+    applyMove( m );
+}
+
+///
+/// copies a position along with its undo stack, so that the copy can 
+/// unmake the moves made before it was copied, and can tell when they are
+/// repeated.  Only the entries in use are copied.  The copy gets a stack 
+/// of its own even if the other is a copy-made child, so that moves can 
+/// be made in it.
+///
+CPos::CPos( const CPos& other ) : mpUndos( new SUndo[kMaxUndos] )
+{
+    copyBoard( other );
+    copyUndos( other );
+}
+
+CPos& CPos::operator=( const CPos& other )
+{
+    if ( this != &other )
     {
-        toSqix = bbPop.popMsb();
-        fromSqix = toSqix.minusRanks( 2 );
-        rMoves.addMove( CMove( fromSqix, toSqix ) );
+        copyBoard( other );
+        copyUndos( other );
     }
+    return *this;
 }
 
 ///
-/// generates captures for the white queen.
+/// copy-make: constructs the position after a legal move in the parent,
+/// which is left as it was.  Only the board state is copied, so the copy 
+/// is three cache lines, and the child has no undo stack.  Moves are 
+/// copy-made from it rather than made in it, and searches that would 
+/// rather copy than unmake throw the child away instead of unmaking the 
+/// move.  A copy of the child, which gets a stack, can make moves.
 ///
-/// @param rMoves
-///     the queen captures will be added to rMoves
+/// @param parent
+///     is the position the move is made in
 ///
-void CPos::genWhiteQueenCaptures( CMoves& rMoves )
+/// @param m
+///     is the move to make
+///
+CPos::CPos( const CPos& parent, CMove m )
 {
-    genWhiteRookCapturesFrom( rMoves, 
-        getPieces( EColor::kWhite, EPieceType::kQueen ) );
-    genWhiteBishopCapturesFrom( rMoves, 
-        getPieces( EColor::kWhite, EPieceType::kQueen ) );
+    copyMake( parent, m );
 }
 
 ///
-/// generates quiet moves for the white queen.
+/// copy-make into an existing position, which becomes the position after 
+/// the move in the parent.  Whatever this position held is dropped, 
+/// including the entries on its undo stack, if it has one.
 ///
-/// @param rMoves
-///     the queen moves will be added to rMoves
+/// @param parent
+///     is the position the move is made in
+///
+/// @param m
+///     is the move to make
 ///
-void CPos::genWhiteQueenQuiets( CMoves& rMoves )
+void CPos::copyMake( const CPos& parent, CMove m )
 {
-    genWhiteRookQuietsFrom( rMoves, 
-        getPieces( EColor::kWhite, EPieceType::kQueen ) );
-    genWhiteBishopQuietsFrom( rMoves, 
-        getPieces( EColor::kWhite, EPieceType::kQueen ) );
+    copyBoard( parent );
+    mNumUndos = 0;
+    applyMove( m );
 }
 
 ///
-/// generates rook captures for white
+/// copies the board state, leaving out the attack maps and check info, 
+/// which are computed again when needed
 ///
-/// @param rMoves
-///     the rook captures will be added to rMoves
+void CPos::copyBoard( const CPos& other )
+{
+    std::memcpy( mbbPieceType, other.mbbPieceType, sizeof( mbbPieceType ) );
+    std::memcpy( mbbColor, other.mbbColor, sizeof( mbbColor ) );
+    mbbCheckers = other.mbbCheckers;
+    mbbOccupied = other.mbbOccupied;
+    mHashKey = other.mHashKey;
+    std::memcpy( mBoard, other.mBoard, sizeof( mBoard ) );
+    mMoveNum = other.mMoveNum;
+    mWhoseMove = other.mWhoseMove;
+    mHalfMoveClock = other.mHalfMoveClock;
+    mDups = other.mDups;
+    mPosRights = other.mPosRights;
+    mAttacksValid = 0;
+    mbCheckInfoValid = false;
+}
+
+///
+/// copies the entries of the undo stack that are in use.  Only a copy-made
+/// child is without a stack, and it gets one here, since it is being made
+/// into a position that moves can be made in.
 ///
-void CPos::genWhiteRookCapturesFrom( CMoves& rMoves, CBitBoard bbFrom )
+void CPos::copyUndos( const CPos& other )
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
-    while ( bbFrom.get() )
-    {
-        fromSqix = bbFrom.popMsb(); 
+    mNumUndos = other.mNumUndos;
+    if ( !mpUndos )
+        mpUndos.reset( new SUndo[kMaxUndos] );
+    std::memcpy( mpUndos.get(), other.mpUndos.get(), 
+        mNumUndos * sizeof( SUndo ) );
+}
 
-        //
-        //  Get the rays from the rook position to the edge of the board in
-        //  each of the four directions.  (The rook's square is not included
-        //  in these rays.
-        //
-        CBitBoard bbNorthRay = CGen::mbbRookRays[fromSqix.get()].mbbNorth;
-        CBitBoard bbEastRay = CGen::mbbRookRays[fromSqix.get()].mbbEast;
-        CBitBoard bbSouthRay = CGen::mbbRookRays[fromSqix.get()].mbbSouth;
-        CBitBoard bbWestRay = CGen::mbbRookRays[fromSqix.get()].mbbWest;
+///
+/// moves the pieces and updates the rights, clocks and hash key for a 
+/// legal move, for makeMove and copy-make.
+///
+void CPos::applyMove( CMove m )
+{
+    CSqix fromSqix = m.getFrom();
+    CSqix toSqix = m.getTo();
+    CPiece pieceMoved = mBoard[fromSqix.get()];
+
+    mHashKey ^= mPosRights.getHashKey();
+    updatePosRights( m );
+    mHashKey ^= mPosRights.getHashKey() ^ CGen::mZobrist.mBlackToMove;
 
+    if ( m.isEnPassant() )
+    {
         //
-        //  Find the square of the blocking piece in each direction, and if 
-        //  it's black, generate a capture
+        //  The pawn taken en passant is beside the capturing pawn.
         //
-        if ( ( bbOccRay = occupied( bbNorthRay ) ).get() )
-        {
-            toSqix = bbOccRay.lsb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbEastRay ) ).get() )
-        {
-            toSqix = bbOccRay.lsb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbWestRay ) ).get() )
-        {
-            toSqix = bbOccRay.msb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
-        if ( ( bbOccRay = occupied( bbSouthRay ) ).get() )
-        {
-            toSqix = bbOccRay.msb().get();
-            if ( isBlack( toSqix ).get() )
-                rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+        removePiece( CSqix( fromSqix.getRank(), toSqix.getFile() ) );
+    }
+    else if ( m.isCapture() )
+    {
+        removePiece( toSqix );
+    }
+    else if ( m.isCastle() )
+    {
+        CSqix rookFromSqix;
+        CSqix rookToSqix;
+        getCastleRookSqixes( toSqix, rookFromSqix, rookToSqix );
+        CPiece rook = mBoard[rookFromSqix.get()];
+        removePiece( rookFromSqix );
+        addPiece( rook, rookToSqix );
+    }
+    removePiece( fromSqix );
+    addPiece( m.isPromo() 
+        ? CPiece( pieceMoved.getColor(), m.getPromo() ) : pieceMoved, 
+        toSqix );
+
+    if ( m.isCapture() 
+        || pieceMoved.getPieceType().get() == EPieceType::kPawn )
+    {
+        mHalfMoveClock = 0;
+    }
+    else
+    {
+        mHalfMoveClock++;
     }
+    mWhoseMove = mWhoseMove.getOpponent();
+    ++mMoveNum;
 }
 
 ///
-/// generates rook captures for white
+/// unmakes the specified move, which must be the last move made, and pops
+/// it off the undo stack.
 ///
-/// @param rMoves
-///     the rook captures will be added to rMoves
+/// @param m
+///     is the move to unmake
 ///
-void CPos::genWhiteRookCaptures( CMoves& rMoves )
+void CPos::unmakeMove( CMove m )
 {
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kRook );
-    genWhiteRookCapturesFrom( rMoves, bbFrom );
+    CSqix fromSqix = m.getFrom();
+    CSqix toSqix = m.getTo();
+    assert( mNumUndos > 0 );
+    const SUndo& rUndo = mpUndos[--mNumUndos];
+    CPiece pieceMoved = m.isPromo()
+        ? CPiece( mBoard[toSqix.get()].getColor(), EPieceType::kPawn )
+        : mBoard[toSqix.get()];
+
+    removePiece( toSqix );
+    addPiece( pieceMoved, fromSqix );
+    if ( m.isEnPassant() )
+    {
+        addPiece( CPiece( mWhoseMove, EPieceType::kPawn ), 
+            CSqix( fromSqix.getRank(), toSqix.getFile() ) );
+    }
+    else if ( m.isCapture() )
+    {
+        addPiece( rUndo.mPieceCaptured, toSqix );
+    }
+    else if ( m.isCastle() )
+    {
+        CSqix rookFromSqix;
+        CSqix rookToSqix;
+        getCastleRookSqixes( toSqix, rookFromSqix, rookToSqix );
+        CPiece rook = mBoard[rookToSqix.get()];
+        removePiece( rookToSqix );
+        addPiece( rook, rookFromSqix );
+    }
+
+    mHashKey = rUndo.mHashKey;
+    mbbCheckers = rUndo.mbbCheckers;
+    mPosRights = CPosRights::fromU8( rUndo.mRights );
+    mHalfMoveClock = rUndo.mHalfMoveClock;
+    mWhoseMove = mWhoseMove.getOpponent();
+    --mMoveNum;
 }
 
 ///
-/// generates rook non-captures for white
+/// finds where the rook of a castling move comes from and goes to: from 
+/// its corner to the square the king crosses
 ///
-/// @param rMoves
-///     the rook moves will be added to rMoves
+/// @param kingToSqix
+///     is the square the king lands on
 ///
-void CPos::genWhiteRookQuiets( CMoves& rMoves )
+void CPos::getCastleRookSqixes( 
+    CSqix       kingToSqix, 
+    CSqix&      rFromSqix, 
+    CSqix&      rToSqix )
 {
-    CBitBoard bbFrom = getPieces( EColor::kWhite, EPieceType::kRook );
-    genWhiteRookQuietsFrom( rMoves, bbFrom );
+    bool bOO = kingToSqix.getFile().get() == EFile::kFileG;
+    rFromSqix = CSqix( kingToSqix.getRank(), 
+        bOO ? EFile::kFileH : EFile::kFileA );
+    rToSqix = CSqix( kingToSqix.getRank(), 
+        bOO ? EFile::kFileF : EFile::kFileD );
 }
 
 ///
-/// generates rook non-captures for white
-///
-/// @param rMoves
-///     the rook moves will be added to rMoves
+/// @returns
+///     the Zobrist hash key of the position computed from scratch, for 
+///     setting up a position and for checking the key kept up to date by
+///     make and unmake.
 ///
-/// @param bbFrom
-///     the set of squares from w
-///     
-void CPos::genWhiteRookQuietsFrom( CMoves& rMoves, CBitBoard bbFrom )
+YHashKey CPos::computeHashKey() const
 {
-    CSqix           toSqix;
-    CSqix           fromSqix;
-    CSqix           blockerSqix;
-    CBitBoard       bbOccRay;
-   
-    while ( bbFrom.get() )
+    YHashKey key = mPosRights.getHashKey();
+    if ( mWhoseMove.isBlack() )
+        key ^= CGen::mZobrist.mBlackToMove;
+    CBitBoard bbPieces = occupied();
+    while ( bbPieces.get() )
     {
-        fromSqix = bbFrom.popMsb(); 
-
-        //
-        //  Get the rays from the rook position to the edge of the board in
-        //  each of the four directions.  (The rook's square is not included
-        //  in these rays.
-        //
-        CBitBoard bbNorthRay = CGen::mbbRookRays[fromSqix.get()].mbbNorth;
-        CBitBoard bbEastRay = CGen::mbbRookRays[fromSqix.get()].mbbEast;
-        CBitBoard bbSouthRay = CGen::mbbRookRays[fromSqix.get()].mbbSouth;
-        CBitBoard bbWestRay = CGen::mbbRookRays[fromSqix.get()].mbbWest;
-
-        //
-        //  For each of thes rays, find the blocker (if any) and mask off
-        //  the squares beyond the blocker.
-        //
-        if ( ( bbOccRay = occupied( bbNorthRay ) ).get() )
-            bbNorthRay &= CGen::mbbRookRays[bbOccRay.lsb().get()].mbbSouth;
-        if ( ( bbOccRay = occupied( bbEastRay ) ).get() )
-            bbEastRay &= CGen::mbbRookRays[bbOccRay.lsb().get()].mbbWest;
-        if ( ( bbOccRay = occupied( bbSouthRay ) ).get() )
-            bbSouthRay &= CGen::mbbRookRays[bbOccRay.msb().get()].mbbNorth;
-        if ( ( bbOccRay = occupied( bbWestRay ) ).get() )
-            bbWestRay &= CGen::mbbRookRays[bbOccRay.msb().get()].mbbEast;
-        CBitBoard bbTo = bbNorthRay.get() 
-            | bbEastRay.get() | bbSouthRay.get() | bbWestRay.get();
-        while ( bbTo.get() )
-        {
-            toSqix = bbTo.popMsb(); 
-            rMoves.addMove( CMove( fromSqix, toSqix ) );
-        }
+        CSqix sqix = bbPieces.popLsb();
+        key ^= CGen::mZobrist.mPieceSquare[U8( mBoard[sqix.get()].get() )]
+            [sqix.get()];
     }
+    return key;
 }
 
 ///
-///	makes the specified move in this position, ignoring duplicate
-/// positions and the 50 move rule.
-///
-///	@param m
-///		is the move to make
-///
-///	@param undoContext
-///		is the context used to undo the move
+/// Remove the piece on a square from the board.
 ///
-void CPos::makeMoveForPerft( CMove m, CUndoContext undoContext )
+void CPos::removePiece( CSqix sqix )
 {
-	undoContext.setPieceMoved( mBoard[m.getFrom().get()] );
-	void setPieceCaptured(CPiece p) { mPieceCaptured = p; }
-	void setPosRights(CPosRights pr) { mPosRights = pr; }
-
-	mWhoseMove = mWhoseMove.getOpponent();
-	updatePosRights( m );
-	++mMoveNum;
-	mbbPieceType[mBoard[m.getFrom().get()].getPieceType()].resetSquare(m.getFrom());
-	mbbPieceType[mBoard[m.getTo().get()].getPieceType()].setSquare(m.getTo());
-	mbbColor[mBoard[m.getFrom().get()].getColor()].resetSquare( m.getFrom() );
-	mbbColor[mBoard[m.getTo().get()].getColor()].resetSquare( m.getTo() );
-	mBoard[m.getTo().get()] = mBoard[m.getFrom()];
-	mBoard[m.getFrom().get()] = CPiece(EPiece::kNone);
-	if (mWhoseMove.isWhite())
-		findWhiteCheckers();
-	else
-		findBlackCheckers();
+    CPiece p = mBoard[sqix.get()];
+    mBoard[sqix.get()] = CPiece( EPiece::kNone );
+    mbbPieceType[U8( p.getPieceType().get() )].resetSquare( sqix.get() );
+    mbbColor[U8( p.getColor().get() )].resetSquare( sqix.get() );
+    mbbOccupied.resetSquare( sqix.get() );
+    mAttacksValid = 0;
+    mbCheckInfoValid = false;
+    mHashKey ^= CGen::mZobrist.mPieceSquare[U8( p.get() )][sqix.get()];
 }
 
 ///
@@ -1792,6 +1921,31 @@ bool CPos::parseFen(
 		}
 	}
 
+	//
+	//  Drop the castling rights that the pieces don't back up, with the 
+	//  king off its home square or the rook off its corner, so that the
+	//  move generator can trust the rights.
+	//
+	for ( U8 c = 0; c < U8( EColor::kNum ); c++ )
+	{
+		CColor color = EColor( c );
+		CRank backRank = color.isWhite() ? ERank::kRank1 : ERank::kRank8;
+		CBitBoard bbKing = getPieces( color, EPieceType::kKing );
+		CBitBoard bbRooks = getPieces( color, EPieceType::kRook );
+		bool bKingHome = ( bbKing.get() 
+			& CSqix( backRank, EFile::kFileE ).asBitBoard() ) != 0;
+		if ( !bKingHome || !( bbRooks.get() 
+			& CSqix( backRank, EFile::kFileH ).asBitBoard() ) )
+		{
+			mPosRights.clearOO( color );
+		}
+		if ( !bKingHome || !( bbRooks.get() 
+			& CSqix( backRank, EFile::kFileA ).asBitBoard() ) )
+		{
+			mPosRights.clearOOO( color );
+		}
+	}
+
 	//
 	//  Set the en passant square
 	//
@@ -1805,7 +1959,17 @@ bool CPos::parseFen(
 			rsErrorText = "Invalid en passant: " + tok;
 			return false;
 		}
-		mPosRights.setEnPassantFile(epSqix.getFile());
+
+		//
+		//  As after a double push, the file is only kept when a pawn can
+		//  take, so the key is the same as the one the moves would give.
+		//
+		if ( CGen::mbbPawnAttacks[U8( mWhoseMove.getOpponent().get() )]
+				[epSqix.get()]
+			& getPieces( mWhoseMove, EPieceType::kPawn ).get() )
+		{
+			mPosRights.setEnPassantFile(epSqix.getFile());
+		}
 	}
 
 	//
@@ -1834,83 +1998,71 @@ bool CPos::parseFen(
 		return false;
 	}
 	mMoveNum = std::uint16_t(num);
+	mHashKey = computeHashKey();
 	return true;
 }
 
 ///
-///	Updates the position rights after the specified move is made
+/// updates the position rights before the specified move is made.  Only a
+/// double push leaves an en passant capture open, and only when an enemy
+/// pawn attacks the square passed over.  Otherwise the file would be in 
+/// the hash key of a position that is the same as one without it, and the
+/// two would miss each other in the table and as repetitions.
 ///
-///	@param m
-///		the move
-void CPos::updatePosRights(CMove m)
+/// @param m
+///     the move
+///
+void CPos::updatePosRights( CMove m )
 {
-	//
-	//	Figure out the castling rights
-	//
-	if (mBoard[m.getFrom().get()].getPieceType().get() == EPieceType::kKing)
-		mPosRights.onKMove(mBoard[m.getFrom().get()].getColor());
-	else if (mBoard[m.getFrom().get()].getPieceType().get()
-		== EPieceType::kRook)
-	{
-		if (mWhoseMove == EColor::kWhite)
-		{
-			if (m.getFrom().getRank().get() == ERank::kRank1)
-				mPosRights.onWqrMove();
-			else if (m.getFrom().getRank().get() == ERank::kRank8)
-				mPosRights.onWkrMove();
-		}
-		else
-		{
-			if (m.getFrom().getRank().get() == ERank::kRank1)
-				mPosRights.onBqrMove();
-			else if (m.getFrom().getRank().get() == ERank::kRank8)
-				mPosRights.onBkrMove();
-		}
-	}
+    mPosRights.onMove( m.getFrom(), m.getTo() );
+    CSqix passedSqix( YSqix( ( m.getFrom().get() + m.getTo().get() ) / 2 ) );
+    if ( m.isDoublePush() 
+        && ( CGen::mbbPawnAttacks[U8( mWhoseMove.get() )][passedSqix.get()]
+            & getPieces( mWhoseMove.getOpponent(), EPieceType::kPawn ).get() ) )
+    {
+        mPosRights.setEnPassantFile( m.getFrom().getFile() );
+    }
+    else
+        mPosRights.clearEnPassantFile( m.getFrom().getFile() );
+}
 
-	//
-	//	Figure out the en passant rights.
-	//
-	if (mWhoseMove == EColor::kWhite)
-	{
-		//
-		//	en passant is legal if the following is true
-		//		from square holds a pawn
-		//		from the second rank
-		//		to the fourth rank
-		//
-		if (m.getFrom().getRank().get() == ERank::kRank2
-			&& m.getFrom().getRank().get() == ERank::kRank4
-			&& mBoard[m.getFrom().get()].getPieceType().get()
-				== EPieceType::kPawn )
-		{
-			mPosRights.setEnPassantFile(m.getFrom().getFile());
-		}
-		else
-		{
-			mPosRights.clearEnPassantFile(m.getFrom().getFile());
-		}
-	}
-	else
-	{
-		//
-		//	en passant is legal if the following is true
-		//		from square holds a pawn
-		//		from the 7th rank
-		//		to the fifth rank
-		//
-		if (m.getFrom().getRank().get() == ERank::kRank7
-			&& m.getFrom().getRank().get() == ERank::kRank5
-			&& mBoard[m.getFrom().get()].getPieceType().get()
-				== EPieceType::kPawn)
-		{
-			mPosRights.setEnPassantFile(m.getFrom().getFile());
-		}
-		else
-		{
-			mPosRights.clearEnPassantFile(m.getFrom().getFile());
-		}
-	}
+///
+/// Generates the masks of the castling rights that survive a move from or 
+/// to each square: every right but those of the king's home square and 
+/// the rooks' corners.
+///
+constexpr SSquareTable<U8> CPosRights::genKeepMasks()
+{
+    SSquareTable<U8> table = {};
+    for ( YSqix sq = 0; sq < CSqix::kNumSquares; sq++ )
+        table[sq] = 0xFF;
+    table[0] = U8( ~kWhiteOOOMask );                        // a1
+    table[4] = U8( ~( kWhiteOOMask | kWhiteOOOMask ) );     // e1
+    table[7] = U8( ~kWhiteOOMask );                         // h1
+    table[56] = U8( ~kBlackOOOMask );                       // a8
+    table[60] = U8( ~( kBlackOOMask | kBlackOOOMask ) );    // e8
+    table[63] = U8( ~kBlackOOMask );                        // h8
+    return table;
+}
+
+constexpr SSquareTable<U8> CPosRights::mKeepMasks 
+    = CPosRights::genKeepMasks();
+
+///
+/// clears the castling rights that a move from one square to another takes
+/// away: the king leaving its home square, or a rook leaving its corner or
+/// being captured there.  Each square has a mask of the rights that 
+/// survive it, so the update doesn't depend on the pieces moved.
+///
+/// @param fromSqix
+///     is the square the move leaves
+///
+/// @param toSqix
+///     is the square the move lands on
+///
+void CPosRights::onMove( CSqix fromSqix, CSqix toSqix )
+{
+    mRights &= mKeepMasks[fromSqix.get()] & mKeepMasks[toSqix.get()];
 }
 
 ///
@@ -1946,19 +2098,3 @@ std::string CPosRights::asStr() const
         s.append( "-" );
     return s;
 }
-
-///
-/// convert an UndoContext into a string abbr
-///
-std::string CUndoContext::asAbbr() const
-{
-    std::string s = mPieceMoved.asAbbr(); 
-    if ( mPieceCaptured.get() != EPiece::kNone )
-    {
-        s.append( "x" );
-        s.append( mPieceCaptured.asAbbr() );
-    }
-    s.append( " " );
-    s.append( mPosRights.asAbbr() );
-    return s;
-}
\ No newline at end of file
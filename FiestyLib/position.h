@@ -8,10 +8,72 @@
 #ifndef Fiesty_position_h
 #define Fiesty_position_h
 
+#include <memory>
 #include "fiesty.h"
 #include "bitboard.h"
 #include "piece.h"
 #include "move.h"
+#include "gen.h"
+#include "magic.h"
+
+///
+/// The color dependent constants and operations of the move generators, 
+/// resolved at compile time so that one generator serves both colors.
+/// White pops its moves from the most significant bit down and black from
+/// the least significant bit up.
+///
+template <EColor C>
+struct SColorTraits
+{
+    static const bool   kbWhite = ( C == EColor::kWhite );
+    static const EColor kEnemy = kbWhite ? EColor::kBlack : EColor::kWhite;
+    static const ERank  kPromoRank = kbWhite ? ERank::kRank8 : ERank::kRank1;
+    static const ERank  kDoublePushRank 
+        = kbWhite ? ERank::kRank3 : ERank::kRank6;
+    static const ERank  kEnPassantRank 
+        = kbWhite ? ERank::kRank6 : ERank::kRank3;
+
+    //
+    //  Castling, from the king's home square on the back rank.  The empty 
+    //  masks are the squares between king and rook, and the safe masks the
+    //  squares the king starts on, crosses and lands on, none of which may 
+    //  be attacked.
+    //
+    static const ERank  kBackRank = kbWhite ? ERank::kRank1 : ERank::kRank8;
+    static const YBitBoard  kOOEmpty 
+        = kbWhite ? 0x60ULL : 0x60ULL << 56;                // f, g
+    static const YBitBoard  kOOSafe 
+        = kbWhite ? 0x70ULL : 0x70ULL << 56;                // e, f, g
+    static const YBitBoard  kOOOEmpty 
+        = kbWhite ? 0x0EULL : 0x0EULL << 56;                // b, c, d
+    static const YBitBoard  kOOOSafe 
+        = kbWhite ? 0x1CULL : 0x1CULL << 56;                // c, d, e
+
+    ///
+    /// @returns the bitboard moved one rank toward the enemy
+    ///
+    static CBitBoard forward( CBitBoard bb ) 
+    { 
+        return kbWhite ? bb.advanceRanks( 1 ) : bb.retreatRanks( 1 ); 
+    }
+
+    ///
+    /// @returns the square a number of ranks back toward our own side
+    ///
+    static CSqix behind( CSqix sqix, U8 numRanks ) 
+    { 
+        return kbWhite 
+            ? sqix.minusRanks( numRanks ) : sqix.plusRanks( numRanks ); 
+    }
+
+    ///
+    /// @returns the next square to generate from, and clears its bit
+    ///
+    static CSqix popNext( CBitBoard& rbb ) 
+    { 
+        return kbWhite ? rbb.popMsb() : rbb.popLsb(); 
+    }
+};
 
 ///
 /// Class that represents the casting and en passant rights, and the number of
@@ -34,6 +96,14 @@ public:
     U8 canWhiteOOO() const      { return mRights & kWhiteOOOMask; }
     U8 canBlackOO() const       { return mRights & kBlackOOMask; }
     U8 canBlackOOO() const      { return mRights & kBlackOOOMask; }
+    U8 canOO( CColor c ) const
+    {
+        return mRights & ( c.isWhite() ? kWhiteOOMask : kBlackOOMask );
+    }
+    U8 canOOO( CColor c ) const
+    {
+        return mRights & ( c.isWhite() ? kWhiteOOOMask : kBlackOOOMask );
+    }
 
     //
     //  Setters
@@ -44,10 +114,9 @@ public:
         mRights &= ~ kEnPassantFileMask;
         mRights |= U8( f.get() ) | kEnPassantLegalMask; 
     }
-    void clearEnPassantFile( CFile f ) 
+    void clearEnPassantFile( CFile ) 
     { 
         mRights &= ~ ( kEnPassantFileMask | kEnPassantLegalMask );
-        mRights |= U8( f.get() ) | kEnPassantLegalMask; 
     }
     void setWhiteOO()    { mRights |= kWhiteOOMask; }
     void clearWhiteOO()  { mRights &= ~kWhiteOOMask; }
@@ -58,22 +127,46 @@ public:
     void setBlackOOO()   { mRights |= kBlackOOOMask; }
     void clearBlackOOO() { mRights &= ~kBlackOOOMask; }
     void clearCastling() { mRights &= ~kAllCastle; }
+    void clearOO( CColor c ) 
+    { 
+        mRights &= ~( c.isWhite() ? kWhiteOOMask : kBlackOOMask ); 
+    }
+    void clearOOO( CColor c ) 
+    { 
+        mRights &= ~( c.isWhite() ? kWhiteOOOMask : kBlackOOOMask ); 
+    }
+
+    ///
+    /// @returns the part of the position's hash key that the rights add
+    ///
+    YHashKey getHashKey() const
+    {
+        YHashKey key = CGen::mZobrist.mCastling[( mRights & kAllCastle ) >> 4];
+        if ( isEnPassantLegal() )
+        {
+            key ^= CGen::mZobrist.mEnPassantFile[
+                mRights & kEnPassantFileMask];
+        }
+        return key;
+    }
+
+    ///
+    /// @returns the rights as their bits, and the rights from those bits, 
+    /// for saving them where a constructor would cost
+    ///
+    U8 asU8() const { return mRights; }
+    static CPosRights fromU8( U8 rights )
+    {
+        CPosRights pr;
+        pr.mRights = rights;
+        return pr;
+    }
 
     std::string asStr() const;
     std::string asAbbr() const { return asStr(); }
     std::string castlingAsStr() const;
 
-	void onWqrMove() { clearWhiteOOO(); }
-	void onWkrMove() { clearWhiteOO(); }
-	void onBqrMove() { clearBlackOOO(); }
-	void onBkrMove() { clearBlackOO(); }
-	void onKMove(CColor c)
-	{
-		if (c.isWhite())
-			mRights &= ~(kWhiteOOMask | kWhiteOOOMask);
-		else
-			mRights &= ~(kBlackOOMask | kBlackOOOMask);
-	};
+    void onMove( CSqix fromSqix, CSqix toSqix );
 
 private:
     static const U8 kEnPassantFileMask  = 0x07;
@@ -84,38 +177,21 @@ private:
     static const U8 kBlackOOOMask       = 0x80;
     static const U8 kAllCastle          = 0xF0;
 
-    U8          mRights;
+    //
+    //  For each square, the rights that survive a move from or to it
+    //
+    static const SSquareTable<U8>   mKeepMasks;
 
-};
+    static constexpr SSquareTable<U8> genKeepMasks();
 
-///
-/// Class that represents the information needed to undo a chess after it's 
-/// been made
-///
-class CUndoContext
-{
-public:
-    CPiece getPieceMoved() const { return mPieceMoved; }
-    CPiece getPieceCaptured() const { return mPieceCaptured; }
-    CPosRights getPosRights() const { return mPosRights; }
-
-    void setPieceMoved( CPiece p ) { mPieceMoved = p; }
-    void setPieceCaptured( CPiece p ) { mPieceCaptured = p; }
-    void setPosRights( CPosRights pr ) { mPosRights = pr; }
-    
-    std::string asStr() const { return asAbbr(); };
-    std::string asAbbr() const;
+    U8          mRights;
 
-private:
-    CPiece      mPieceMoved;
-    CPiece      mPieceCaptured;
-    CPosRights  mPosRights;
 };
 
 //
 //  Class the represents a chess position
 //
-class CPos
+class alignas( 64 ) CPos
 {
 public:
     //
@@ -124,7 +200,10 @@ public:
     static const char* kStartFen;
     enum ELegalMoveType { kLegal, kQuasiLegal };
 
-    CPos() { clearBoard(); }
+    CPos() : mpUndos( new SUndo[kMaxUndos] ) { clearBoard(); }
+    CPos( const CPos& other );
+    CPos( const CPos& parent, CMove m );
+    CPos& operator=( const CPos& other );
 
     void clearBoard();
     void addPiece( CPiece p, CSqix sq );
@@ -133,6 +212,8 @@ public:
         std::string&                rsErrorText );
     CBitBoard getCheckers() const { return mbbCheckers; }
     CColor getWhoseMove() const { return mWhoseMove; }
+    YHashKey getHashKey() const { return mHashKey; }
+    YHashKey computeHashKey() const;
     CPiece getPiece( YSqix sqix ) const { return mBoard[sqix]; }
     CBitBoard getPieces( CColor c, CPieceType pt ) const
     { 
@@ -145,61 +226,84 @@ public:
     std::string asFen() const;
     std::string asDiagram() const;
 
-    void genWhitePawnQuiets( CMoves& rMoves );
-    void genWhitePawnCaptures( CMoves& rMoves );
-    void genWhiteKnightQuiets( CMoves& rMoves );
-    void genWhiteKnightCaptures( CMoves& rMoves );
-    void genWhiteBishopQuiets( CMoves& rMoves );
-    void genWhiteBishopCaptures( CMoves& rMoves );
-    void genWhiteRookQuiets( CMoves& rMoves );
-    void genWhiteRookCaptures( CMoves& rMoves );
-    void genWhiteQueenQuiets( CMoves& rMoves );
-    void genWhiteQueenCaptures( CMoves& rMoves );
-    void genWhiteKingQuiets( CMoves& rMoves );
-    void genWhiteKingCaptures( CMoves& rMoves );
-
-    void genBlackPawnQuiets( CMoves& rMoves );
-    void genBlackPawnCaptures( CMoves& rMoves );
-    void genBlackKnightQuiets( CMoves& rMoves );
-    void genBlackKnightCaptures( CMoves& rMoves );
-    void genBlackBishopQuiets( CMoves& rMoves );
-    void genBlackBishopCaptures( CMoves& rMoves );
-    void genBlackRookQuiets( CMoves& rMoves );
-    void genBlackRookCaptures( CMoves& rMoves );
-    void genBlackQueenCaptures( CMoves& rMoves );
-    void genBlackQueenQuiets( CMoves& rMoves );
-    void genBlackKingQuiets( CMoves& rMoves );
-    void genBlackKingCaptures( CMoves& rMoves );
-
-    void findWhiteCheckers();
-    void findBlackCheckers();
-
-    void genWhiteMoves( CMoves& rMoves );
-    void genWhiteLegalMoves( CMoves& rMoves );
-    void genBlackMoves( CMoves& rMoves );
-    void genBlackLegalMoves( CMoves& rMoves );
+    //
+    //  Move generators, for the color C to move.  findCheckers<C> finds the
+    //  pieces of color C that check the other king.  genLegalMoves<C> 
+    //  generates only legal moves, and leaves the pieces checking C's king
+    //  in mbbCheckers.  genEvasions<C> generates the legal moves out of 
+    //  check, once mbbCheckers holds the pieces checking C's king.
+    //
+    template <EColor C> void genPawnQuiets( CMoves& rMoves );
+    template <EColor C> void genPawnCaptures( CMoves& rMoves );
+    template <EColor C> void genKnightQuiets( CMoves& rMoves );
+    template <EColor C> void genKnightCaptures( CMoves& rMoves );
+    template <EColor C> void genBishopQuiets( CMoves& rMoves );
+    template <EColor C> void genBishopCaptures( CMoves& rMoves );
+    template <EColor C> void genRookQuiets( CMoves& rMoves );
+    template <EColor C> void genRookCaptures( CMoves& rMoves );
+    template <EColor C> void genQueenQuiets( CMoves& rMoves );
+    template <EColor C> void genQueenCaptures( CMoves& rMoves );
+    template <EColor C> void genKingQuiets( CMoves& rMoves );
+    template <EColor C> void genKingCaptures( CMoves& rMoves );
+    template <EColor C> void genCastles( CMoves& rMoves ) const;
+
+    template <EColor C> void findCheckers();
+
+    template <EColor C> void genMoves( CMoves& rMoves );
+    template <EColor C> void genEvasions( CMoves& rMoves );
+    template <EColor C> void genLegalMoves( CMoves& rMoves );
     
-    void makeMoveForPerft( CMove m, CUndoContext undoContext );
-    void unmakeMoveForPerft( CMove m, CUndoContext undoContext);                //TODO: code me
+    bool isPseudoLegal( CMove m ) const;
+    bool givesCheck( CMove m ) const;
+    S32 see( CMove m ) const;
+    bool seeGE( CMove m, S32 threshold ) const;
+    CBitBoard attackersTo( CSqix sqix, CBitBoard bbOccupied ) const;
+    bool isKingAttacked( CColor c ) const;
+    bool isDraw() const;
+
+    void makeMove( CMove m );
+    void unmakeMove( CMove m );
+    void copyMake( const CPos& parent, CMove m );
+
+    ///
+    /// @returns the number of moves made that can still be unmade
+    ///
+    U16 getNumUndos() const { return mNumUndos; }
+
+    ///
+    /// @returns 
+    ///     the hash key of the position pliesBack moves ago, which must be
+    ///     from 1 to getNumUndos()
+    ///
+    YHashKey getPastHashKey( U16 pliesBack ) const
+    {
+        return mpUndos[mNumUndos - pliesBack].mHashKey;
+    }
+    U8 getHalfMoveClock() const { return mHalfMoveClock; }
 
     ///
     /// @returns the bitmask of unoccupied squares in the specified bitboard
     ///
     CBitBoard unoccupied( const CBitBoard& bb ) const 
     {
-        return ( bb.get() & ~( mbbColor[U8( EColor::kWhite )].get() 
-            | mbbColor[U8( EColor::kBlack )].get() ) );
+        return bb.get() & ~mbbOccupied.get();
     }
 
+    ///
+    /// @returns the bitmask of occupied squares
+    ///
+    CBitBoard occupied() const { return mbbOccupied; }
+
     ///
     /// @returns the bitmask of occupied squares in the specified bitboard
     ///
     CBitBoard occupied( const CBitBoard& bb ) const 
     {
-        return ( bb.get() & ( mbbColor[U8( EColor::kWhite )].get() 
-            | mbbColor[U8( EColor::kBlack )].get() ) );
+        return bb.get() & mbbOccupied.get();
     }
 
+    CBitBoard getAttacks( CColor c ) const;
+
     ///
     /// @returns a non-zero bitboard if the square is occupied by a white
     /// piece.
@@ -219,40 +323,138 @@ public:
     }
 
 private:
-    void genBlackBishopCapturesFrom( CMoves& rMoves, CBitBoard bbFrom );
-    void genBlackBishopQuietsFrom( CMoves& rMoves, CBitBoard bbFrom );
-    void genBlackRookCapturesFrom( CMoves& rMoves, CBitBoard bbFrom );
-    void genBlackRookQuietsFrom( CMoves& rMoves, CBitBoard bbFrom );
-    void genWhiteBishopCapturesFrom( CMoves& rMoves, CBitBoard bbFrom );
-    void genWhiteBishopQuietsFrom( CMoves& rMoves, CBitBoard bbFrom );
-    void genWhiteRookCapturesFrom( CMoves& rMoves, CBitBoard bbFrom );
-    void genWhiteRookQuietsFrom( CMoves& rMoves, CBitBoard bbFrom );
-
-    void findDiagonalCheckers( CSqix kingSqix, CBitBoard bbBishopsAndQueens );
-    void findRankAndFileCheckers( CSqix kingSqix, CBitBoard bbRooksAndQueens );
-
-    void findWhiteKnightCheckers( CSqix kingSqix );
-    void findWhiteRankAndFileCheckers( CSqix kingSqix );
-    void findWhiteDiagonalCheckers( CSqix kingSqix );
-    void findWhitePawnCheckers( CBitBoard bbKing );
-    void findWhiteKingCheckers( CSqix kingSqix );
-
-    void findBlackKnightCheckers( CSqix kingSqix );
-    void findBlackRankAndFileCheckers( CSqix kingSqix );
-    void findBlackDiagonalCheckers( CSqix kingSqix );
-    void findBlackPawnCheckers( CBitBoard bbKing ); 
-    void findBlackKingCheckers( CSqix kingSqix );
-	void updatePosRights( CMove m );
+    template <EColor C, EPieceType PT> 
+    void genPieceMovesFrom( 
+        CMoves& rMoves, CBitBoard bbFrom, CBitBoard bbTargets );
+    template <EColor C> 
+    void genPawnQuietsFrom( 
+        CMoves& rMoves, CBitBoard bbFrom, CBitBoard bbTargets );
+    template <EColor C> 
+    void genPawnCapturesFrom( 
+        CMoves& rMoves, CBitBoard bbFrom, CBitBoard bbTargets );
+    template <EColor C, EPieceType PT> 
+    void genPinnedAwareMoves( CMoves& rMoves, CBitBoard bbTargets, 
+        CBitBoard bbPinned, CSqix kingSqix );
+    template <EColor C> 
+    void genLegalEnPassant( CMoves& rMoves, CSqix kingSqix );
+    template <EColor C> 
+    void genCastles( CMoves& rMoves, CBitBoard bbDanger ) const;
+    template <EColor C> CBitBoard findPinned( CSqix kingSqix ) const;
+    void computeCheckInfo() const;
+    S32 seeFirstCapture( 
+        CMove m, S32& rOnTarget, CBitBoard& rbbOccupied ) const;
+    EPieceType popLeastValuable( CSqix toSqix, CBitBoard bbSideAttackers, 
+        CBitBoard& rbbOccupied, CBitBoard& rbbAttackers ) const;
+    template <EColor C> CBitBoard attackedBy( CBitBoard bbOccupied ) const;
+
+    ///
+    /// @returns 
+    ///     the squares attacked by a knight, bishop, rook, queen or king on
+    ///     a square, given the current occupancy.
+    ///
+    template <EPieceType PT>
+    CBitBoard attacksFrom( CSqix sqix ) const
+    {
+        switch ( PT )
+        {
+        case EPieceType::kKnight:
+            return CGen::mbbKnightAttacks[sqix.get()];
+        case EPieceType::kBishop:
+            return CMagic::bishopAttacks( sqix, occupied() );
+        case EPieceType::kRook:
+            return CMagic::rookAttacks( sqix, occupied() );
+        case EPieceType::kQueen:
+            return CMagic::queenAttacks( sqix, occupied() );
+        default:
+            return CGen::mbbKingAttacks[sqix.get()];
+        }
+    }
+
+    template <EColor C> 
+    static void addPawnMoves( 
+        CMoves& rMoves, CSqix fromSqix, CSqix toSqix, bool bCapture );
+
+    ///
+    /// adds a pawn capture, or the en passant capture onto the empty square
+    /// behind a pawn that just pushed two
+    ///
+    template <EColor C> 
+    static void addPawnCapture( 
+        CMoves& rMoves, CSqix fromSqix, CSqix toSqix, bool bEnPassant )
+    {
+        if ( bEnPassant )
+            rMoves.addMove( CMove( fromSqix, toSqix, CMove::kEnPassant ) );
+        else
+            addPawnMoves<C>( rMoves, fromSqix, toSqix, true );
+    }
 
+    static void getCastleRookSqixes( 
+        CSqix kingToSqix, CSqix& rFromSqix, CSqix& rToSqix );
+    void copyBoard( const CPos& other );
+    void copyUndos( const CPos& other );
+    void updatePosRights( CMove m );
+    void removePiece( CSqix sqix );
+    void applyMove( CMove m );
+
+    //
+    //  What makeMove saves for unmakeMove to put back.  The piece moved is
+    //  on the to square afterwards, so it is not saved.  The rights are 
+    //  kept as their bits, so that constructing a position does no work 
+    //  on the entries.
+    //
+    struct SUndo
+    {
+        YHashKey    mHashKey;
+        CBitBoard   mbbCheckers;
+        CPiece      mPieceCaptured;
+        U8          mRights;
+        U8          mHalfMoveClock;
+    };
+    static const U16 kMaxUndos = 2048;
+
+    //
+    //  The board state, which copy-make copies into the child.  It comes
+    //  ahead of the undo stack and is ordered from the widest member down,
+    //  so that it packs into the first three cache lines.
+    //
+    CBitBoard       mbbPieceType[U8( EPieceType::kNum )];
+    CBitBoard       mbbColor[U8( EColor::kNum )];
+    CBitBoard       mbbCheckers;
+    CBitBoard       mbbOccupied;                    // both colors
+    YHashKey        mHashKey;                       // Zobrist
+    CPiece          mBoard[U8( ERank::kNum ) * U8( EFile::kNum )];
+    std::uint16_t   mMoveNum;
     CColor          mWhoseMove;
     U8              mHalfMoveClock;                 // for 50 move rule
     U8              mDups;                          // for 3 time repetitions
     CPosRights      mPosRights;
-    std::uint16_t   mMoveNum;
-    CPiece          mBoard[U8( ERank::kNum ) * U8( EFile::kNum )];
-    CBitBoard       mbbPieceType[U8( EPieceType::kNum )];
-    CBitBoard       mbbColor[U8( EColor::kNum )];
-    CBitBoard       mbbCheckers;
+
+    //
+    //  The squares each color attacks, computed on demand and kept until
+    //  the next change to the board.  Bit c of mAttacksValid is set when
+    //  mbbAttacks[c] is current.  A copy-made child starts without them.
+    //
+    mutable U8          mAttacksValid;
+    mutable CBitBoard   mbbAttacks[U8( EColor::kNum )];
+
+    //
+    //  What givesCheck needs at this node, computed on its first call and
+    //  kept like the attack maps: for each piece type the squares it would
+    //  check the enemy king from, and the pieces of the side to move that 
+    //  uncover a check by leaving the line between a slider and that king.
+    //
+    mutable bool        mbCheckInfoValid;
+    mutable CBitBoard   mbbCheckSquares[U8( EPieceType::kNum )];
+    mutable CBitBoard   mbbDiscoverers;
+
+    //
+    //  The undo stack, one entry for each move made and not yet unmade.  It
+    //  is allocated with the position, so making a move never allocates.  
+    //  It is kept apart from the board, so that a copy-made child, which 
+    //  has none, is only the board.
+    //
+    U16                         mNumUndos;
+    std::unique_ptr<SUndo[]>    mpUndos;
 
     static std::string nextFenTok( 
         const std::string &sFen, size_t &rPos );
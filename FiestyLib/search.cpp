@@ -5,90 +5,1241 @@
 /// code having to do with searches
 ///
 ///
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include "eval.h"
 #include "search.h"
+#include "threadpool.h"
 
 ///
-/// Generates the perft node count for the current position with black to
+/// Generates the perft node count for the current position with color C 
 /// to move.
 ///
-U64 CSearcher::perftBlack( U16 depthLeft )
+template <EColor C>
+U64 CSearcher::perftFor( U16 depthLeft )
 {
     if ( depthLeft == 0 )
         return 1;
 
-    CMoves			moves;
-    U64				nodeCount = 0;
-	CUndoContext	undoContext;
+    CMoves          moves;
+    U64             nodeCount = 0;
 
-    mpPos->genBlackMoves( moves );
-    for ( U16 moveIx = 0; moveIx = moves.getNumMoves(); moveIx++ )
+    if ( depthLeft == 1 && mbPerftBulkCount )
     {
-        CMove move = moves.get( moveIx );
-        mpPos->makeMoveForPerft( move );
+        mpPos->genLegalMoves<C>( moves );
+        return moves.getNumMoves();
+    }
 
-        //
-        //  If the move leaves us in check, it's not legal.  The
-        //  can be removed when genBlackMoves implements check evasion.
-        //
-        mpPos->findWhiteCheckers();
-        if ( mpPos->getCheckers().get() )
+    //
+    //  A subtree of one ply is cheaper to count than to look up.
+    //
+    bool bUseTable = mpPerftTable && depthLeft > 1;
+    if ( bUseTable 
+        && mpPerftTable->probe( mpPos->getHashKey(), depthLeft, nodeCount ) )
+    {
+        return nodeCount;
+    }
+
+    mpPos->genLegalMoves<C>( moves );
+    if ( mbPerftCopyMake )
+    {
+        CPos* pParent = mpPos;
+        for ( U16 moveIx = 0; moveIx < moves.getNumMoves(); moveIx++ )
+        {
+            CPos child( *pParent, moves.get( moveIx ) );
+            if ( bUseTable )
+                mpPerftTable->prefetch( child.getHashKey() );
+            mpPos = &child;
+            nodeCount += perftFor<SColorTraits<C>::kEnemy>( depthLeft - 1 );
+        }
+        mpPos = pParent;
+    }
+    else
+    {
+        for ( U16 moveIx = 0; moveIx < moves.getNumMoves(); moveIx++ )
         {
-            if ( depthLeft == 1 ) 
-                nodeCount++;
-            else
-                nodeCount += perftBlack( depthLeft - 1 );
+            CMove move = moves.get( moveIx );
+            mpPos->makeMove( move );
+            if ( bUseTable )
+                mpPerftTable->prefetch( mpPos->getHashKey() );
+            nodeCount += perftFor<SColorTraits<C>::kEnemy>( depthLeft - 1 );
+            mpPos->unmakeMove( move );
         }
+    }
+
+    if ( bUseTable )
+        mpPerftTable->store( mpPos->getHashKey(), depthLeft, nodeCount );
+    return nodeCount;
+}
+
+///
+/// generates the perft node count for the current position.
+///
+U64 CSearcher::perft( U16 depthLeft )
+{
+    if ( mpPos->getWhoseMove() == EColor::kWhite )
+    {
+        return perftFor<EColor::kWhite>( depthLeft );
+    }
+    else 
+    {
+        return perftFor<EColor::kBlack>( depthLeft );
+    }
+}
+
+///
+/// collects the move sequences from the current position that are split 
+/// off as parallel perft tasks.  A line that ends in mate or stalemate 
+/// before pliesLeft has no nodes at the perft depth, and is left out.
+///
+/// @param rPath
+///     holds the moves made so far, and is restored on return
+///
+/// @param pliesLeft
+///     is the number of moves still to add to the path
+///
+/// @param rPaths
+///     receives the complete paths
+///
+template <EColor C>
+void CSearcher::collectSplitPaths( 
+    std::vector<CMove>&                 rPath, 
+    U16                                 pliesLeft,
+    std::vector< std::vector<CMove> >&  rPaths )
+{
+    if ( pliesLeft == 0 )
+    {
+        rPaths.push_back( rPath );
+        return;
+    }
+
+    CMoves          moves;
+
+    mpPos->genLegalMoves<C>( moves );
+    for ( U16 moveIx = 0; moveIx < moves.getNumMoves(); moveIx++ )
+    {
+        CMove move = moves.get( moveIx );
+        rPath.push_back( move );
+        mpPos->makeMove( move );
+        collectSplitPaths<SColorTraits<C>::kEnemy>( 
+            rPath, pliesLeft - 1, rPaths );
         mpPos->unmakeMove( move );
+        rPath.pop_back();
     }
+}
+
+///
+/// generates the perft node count for the current position on several 
+/// threads.  The tree is split into one task per line of splitPlies moves
+/// from the root, and the tasks run on a work-stealing pool.  Each worker
+/// has its own copy of the position, made before the pool starts, and a 
+/// task resets it to the root and replays its line there.  So the workers
+/// share nothing but their results and the perft table, if one is set, 
+/// the tasks don't allocate, and the count is the same as perft's.
+///
+/// @param numThreads
+///     is the number of worker threads
+///
+/// @param splitPlies
+///     is the depth of the split.  One ply gives a task per root move;
+///     more plies give more, smaller tasks, which balance better.
+///
+U64 CSearcher::perftParallel( U16 depthLeft, U32 numThreads, U16 splitPlies )
+{
+    typedef std::chrono::steady_clock YClock;
+
+    if ( numThreads == 0 )
+        numThreads = 1;
+    mPerftThreadStats.assign( numThreads, SPerftThreadStats() );
+    if ( splitPlies == 0 || depthLeft <= splitPlies )
+        return perft( depthLeft );
+
+    std::vector<CMove> path;
+    std::vector< std::vector<CMove> > paths;
+    if ( mpPos->getWhoseMove() == EColor::kWhite )
+        collectSplitPaths<EColor::kWhite>( path, splitPlies, paths );
+    else
+        collectSplitPaths<EColor::kBlack>( path, splitPlies, paths );
+
+    std::vector<U64> nodeCounts( paths.size(), 0 );
+    std::vector<CPos> workerPositions( numThreads, *mpPos );
+    {
+        CThreadPool pool( numThreads );
+        for ( size_t pathIx = 0; pathIx < paths.size(); pathIx++ )
+        {
+            pool.submit( [this, pathIx, depthLeft, splitPlies, &paths, 
+                &nodeCounts, &workerPositions]( U32 workerIx )
+            {
+                YClock::time_point startTime = YClock::now();
+                CPos& pos = workerPositions[workerIx];
+                pos = *mpPos;
+                for ( CMove move : paths[pathIx] )
+                    pos.makeMove( move );
+
+                CSearcher searcher( pos );
+                searcher.setPerftTable( mpPerftTable );
+                searcher.setPerftBulkCount( mbPerftBulkCount );
+                searcher.setPerftCopyMake( mbPerftCopyMake );
+                nodeCounts[pathIx] = searcher.perft( depthLeft - splitPlies );
+
+                SPerftThreadStats& rStats = mPerftThreadStats[workerIx];
+                rStats.mNodes += nodeCounts[pathIx];
+                rStats.mTasks++;
+                rStats.mSeconds += std::chrono::duration<double>( 
+                    YClock::now() - startTime ).count();
+            } );
+        }
+        pool.wait();
+    }
+
+    U64 nodeCount = 0;
+    for ( U64 count : nodeCounts )
+        nodeCount += count;
     return nodeCount;
 }
 
 ///
-/// Generates the perft node count for the current position with white to
-/// to move.
+/// generates the perft node count below each root move, to compare with
+/// another engine's when a count is wrong.
+///
+/// @param depthLeft
+///     is the perft depth, counting the root moves
+///
+/// @param rDivide
+///     receives a count for each legal root move
+///
+/// @returns
+///     the total node count, as from perft
 ///
-U64 CSearcher::perftWhite( U16 depthLeft )
+U64 CSearcher::perftDivide( U16 depthLeft, std::vector<SPerftDivide>& rDivide )
 {
+    CMoves          moves;
+    U64             nodeCount = 0;
+    bool            bWhite = mpPos->getWhoseMove().isWhite();
+
+    rDivide.clear();
     if ( depthLeft == 0 )
         return 1;
+    if ( bWhite )
+        mpPos->genLegalMoves<EColor::kWhite>( moves );
+    else
+        mpPos->genLegalMoves<EColor::kBlack>( moves );
+    for ( U16 moveIx = 0; moveIx < moves.getNumMoves(); moveIx++ )
+    {
+        SPerftDivide divide;
+        divide.mMove = moves.get( moveIx );
+        mpPos->makeMove( divide.mMove );
+        divide.mNodes = bWhite 
+            ? perftFor<EColor::kBlack>( depthLeft - 1 )
+            : perftFor<EColor::kWhite>( depthLeft - 1 );
+        mpPos->unmakeMove( divide.mMove );
+        rDivide.push_back( divide );
+        nodeCount += divide.mNodes;
+    }
+    return nodeCount;
+}
+
+///
+/// classifies a move made at the last ply of a perft with statistics
+///
+/// @param m
+///     is the move, a legal move for C that has not been made yet
+///
+/// @param rStats
+///     is updated with what kind of move m is
+///
+template <EColor C>
+void CSearcher::countLeafStats( CMove m, SPerftStats& rStats )
+{
+    const EColor kEnemy = SColorTraits<C>::kEnemy;
+    CSqix fromSqix = m.getFrom();
+    CSqix toSqix = m.getTo();
 
-    CMoves      moves;
-    U64         nodeCount = 0;
+    if ( m.isCapture() )
+        rStats.mCaptures++;
+    if ( m.isEnPassant() )
+        rStats.mEnPassants++;
+    if ( m.isPromo() )
+        rStats.mPromotions++;
 
-    mpPos->genWhiteMoves( moves );
-    for ( U16 moveIx = 0; moveIx = moves.getNumMoves(); moveIx++ )
+    //
+    //  The rook of a castling move lands on the square the king passes 
+    //  over.  A check by that rook is not a discovered one.
+    //
+    CBitBoard bbMoved = toSqix.asBitBoard();
+    if ( m.isCastle() )
+    {
+        rStats.mCastles++;
+        bbMoved |= CGen::mbbBetween[fromSqix.get()][toSqix.get()];
+    }
+
+    mpPos->makeMove( m );
+    mpPos->findCheckers<C>();
+    CBitBoard bbCheckers = mpPos->getCheckers();
+    if ( bbCheckers.get() )
+    {
+        rStats.mChecks++;
+        if ( bbCheckers.get() & ~bbMoved.get() )
+            rStats.mDiscoveredChecks++;
+        if ( bbCheckers.popcnt() > 1 )
+            rStats.mDoubleChecks++;
+
+        CMoves replies;
+        mpPos->genLegalMoves<kEnemy>( replies );
+        if ( replies.getNumMoves() == 0 )
+            rStats.mCheckmates++;
+    }
+    mpPos->unmakeMove( m );
+}
+
+///
+/// counts the perft statistics below the current position, with color C 
+/// to move.  This is kept apart from perftFor so that the plain perft 
+/// pays nothing for the statistics.  It never uses the perft table or 
+/// bulk counting, since both skip the leaves.
+///
+template <EColor C>
+void CSearcher::perftStatsFor( U16 depthLeft, SPerftStats& rStats )
+{
+    CMoves          moves;
+
+    mpPos->genLegalMoves<C>( moves );
+    for ( U16 moveIx = 0; moveIx < moves.getNumMoves(); moveIx++ )
     {
         CMove move = moves.get( moveIx );
-        mpPos->makeMove( move );
+        if ( depthLeft == 1 )
+        {
+            rStats.mNodes++;
+            countLeafStats<C>( move, rStats );
+        }
+        else
+        {
+            mpPos->makeMove( move );
+            perftStatsFor<SColorTraits<C>::kEnemy>( depthLeft - 1, rStats );
+            mpPos->unmakeMove( move );
+        }
+    }
+}
+
+///
+/// generates the perft node count for the current position, broken down 
+/// by the kind of move made at the last ply.
+///
+SPerftStats CSearcher::perftStats( U16 depthLeft )
+{
+    SPerftStats stats = {};
+
+    if ( depthLeft == 0 )
+        stats.mNodes = 1;
+    else if ( mpPos->getWhoseMove().isWhite() )
+        perftStatsFor<EColor::kWhite>( depthLeft, stats );
+    else
+        perftStatsFor<EColor::kBlack>( depthLeft, stats );
+    return stats;
+}
+
+///
+/// @returns the statistics as a single line
+///
+std::string SPerftStats::asStr() const
+{
+    return "nodes " + std::to_string( mNodes ) 
+        + " captures " + std::to_string( mCaptures )
+        + " ep " + std::to_string( mEnPassants )
+        + " castles " + std::to_string( mCastles )
+        + " promotions " + std::to_string( mPromotions )
+        + " checks " + std::to_string( mChecks )
+        + " discovered " + std::to_string( mDiscoveredChecks )
+        + " double " + std::to_string( mDoubleChecks )
+        + " checkmates " + std::to_string( mCheckmates );
+}
+
+//
+//  Mate scores count the plies to mate from the root, but the table is
+//  shared by every path to a position, so it stores them counted from the
+//  position itself.
+//
+static S16 scoreToTT( YVal score, U16 ply )
+{
+    if ( score >= CSearcher::kMateInMaxPly )
+        return S16( score + ply );
+    if ( score <= -CSearcher::kMateInMaxPly )
+        return S16( score - ply );
+    return score;
+}
+
+static YVal scoreFromTT( S16 score, U16 ply )
+{
+    if ( score >= CSearcher::kMateInMaxPly )
+        return YVal( score - ply );
+    if ( score <= -CSearcher::kMateInMaxPly )
+        return YVal( score + ply );
+    return score;
+}
+
+///
+/// searches the current position by iterative deepening, one ply deeper 
+/// each iteration until a limit is reached.  An iteration that is stopped
+/// part way is thrown away.  Each completed one is reported.
+///
+/// @param rBestMove
+///     receives the first move of the principal variation, or a legal 
+///     move if not even the first iteration completed, or the null move if
+///     there are no legal moves
+///
+/// @returns
+///     the score of the last completed iteration
+///
+YVal CSearcher::determineBestMove( CMove& rBestMove )
+{
+    if ( mpTransTable )
+        mpTransTable->newSearch();
+    return iterate( rBestMove );
+}
+
+///
+/// searches the current position with Lazy SMP: helper threads, each with
+/// its own copy of the position, stack and history, search the same root
+/// alongside this one and share only the transposition table.  What they
+/// store there steers this thread's search and cuts it short.  Half of the
+/// helpers start a ply deeper than this thread, so that the threads don't
+/// all search the same tree in step.
+///
+/// This thread reports its iterations as determineBestMove does, with the
+/// nodes of every thread, and the search ends when it does.  The limits 
+/// on nodes and time apply to this thread only.
+///
+/// In deterministic mode the search is determineBestMoveSplit's instead.
+///
+/// @param rBestMove
+///     receives the move of whichever thread completed the deepest 
+///     iteration, this one if it is among them
+///
+/// @param numThreads
+///     is the number of threads to search with, this one included
+///
+/// @returns
+///     the score that goes with the move
+///
+YVal CSearcher::determineBestMoveParallel( CMove& rBestMove, U32 numThreads )
+{
+    if ( mbDeterministic )
+        return determineBestMoveSplit( rBestMove, numThreads );
+    if ( numThreads <= 1 )
+        return determineBestMove( rBestMove );
+    if ( mpTransTable )
+        mpTransTable->newSearch();
+
+    //
+    //  What a helper leaves behind.  Each helper writes only its own.
+    //
+    struct SHelperResult
+    {
+        CMove       mMove;
+        YVal        mScore;
+        U16         mDepth;
+        U64         mNodes;
+    };
+
+    //
+    //  The positions are copied before this thread starts making moves in
+    //  its own.
+    //
+    U32 numHelpers = numThreads - 1;
+    std::vector<CPos> positions( numHelpers, *mpPos );
+    std::vector<SHelperResult> results( numHelpers, SHelperResult() );
+    std::atomic<bool> bStopSignal( false );
+    std::atomic<U64> sharedNodes( 0 );
+    YVal score;
+    {
+        CThreadPool pool( numHelpers );
+        for ( U32 helperIx = 0; helperIx < numHelpers; helperIx++ )
+        {
+            pool.submit( [this, helperIx, &positions, &results, 
+                &bStopSignal, &sharedNodes]( U32 )
+            {
+                CSearcher helper( positions[helperIx] );
+                SSearchLimits limits = mLimits;
+                limits.mMaxNodes = 0;
+                limits.mMaxSeconds = 0;
+                helper.setLimits( limits );
+                helper.setTransTable( mpTransTable );
+                helper.setSearchCopyMake( mbSearchCopyMake );
+                helper.mpStopSignal = &bStopSignal;
+                helper.mpSharedNodes = &sharedNodes;
+                helper.mStartDepth = 1 + ( helperIx + 1 ) % 2;
+
+                SHelperResult& rResult = results[helperIx];
+                rResult.mScore = helper.iterate( rResult.mMove );
+                rResult.mDepth = helper.getReports().empty() 
+                    ? 0 : helper.getReports().back().mDepth;
+                rResult.mNodes = helper.getNodes();
+            } );
+        }
+
+        mpSharedNodes = &sharedNodes;
+        score = iterate( rBestMove );
+        mpSharedNodes = nullptr;
+        bStopSignal = true;
+        pool.wait();
+    }
+
+    U16 bestDepth = mReports.empty() ? 0 : mReports.back().mDepth;
+    for ( const SHelperResult& rResult : results )
+    {
+        mNodes += rResult.mNodes;
+        if ( rResult.mDepth > bestDepth )
+        {
+            bestDepth = rResult.mDepth;
+            rBestMove = rResult.mMove;
+            score = rResult.mScore;
+        }
+    }
+    return score;
+}
+
+///
+/// searches the current position with several threads so that the result
+/// depends only on the position, the thread count and the limits, never
+/// on how the threads happen to be scheduled.
+///
+/// Each iteration is a young brothers wait split of the root.  This 
+/// thread first searches the first root move, the best of the last 
+/// iteration, with the full window.  The other root moves are then dealt 
+/// out to the threads in a fixed rotation, and each thread searches its 
+/// share with a null window at that score.  Once every thread is done, 
+/// the moves that failed high are searched again with the full window by 
+/// this thread, in root move order.
+///
+/// No thread can see another's work while it searches: each helper has 
+/// its own position, history and transposition table, kept from one 
+/// iteration to the next.  A helper's table gets an equal share of the 
+/// memory of this thread's table, but at least kMinHelperTableMegaBytes.
+/// This thread's table is cleared first, so that earlier searches don't 
+/// count either.
+///
+/// So that stopping is as repeatable as the rest, the time limit is not
+/// used, and each thread may search its share of the node limit.  When a
+/// thread runs out, the iteration is thrown away.
+///
+/// @param rBestMove
+///     receives the best move of the last completed iteration, or the 
+///     first legal move if none completed, or the null move if there are
+///     no legal moves
+///
+/// @param numThreads
+///     is the number of threads to search with, this one included
+///
+/// @returns
+///     the score of the last completed iteration
+///
+YVal CSearcher::determineBestMoveSplit( CMove& rBestMove, U32 numThreads )
+{
+    //
+    //  A helper thread's searcher and the position and table it owns
+    //
+    struct SHelper
+    {
+        CPos                            mPos;
+        std::unique_ptr<CTransTable>    mpTable;
+        CSearcher                       mSearcher;
+
+        SHelper( const CPos& rRoot ) : mPos( rRoot ), mSearcher( mPos ) {}
+    };
+
+    if ( numThreads == 0 )
+        numThreads = 1;
+    U16 maxDepth = mLimits.mMaxDepth > 0 && mLimits.mMaxDepth < kMaxPly
+        ? mLimits.mMaxDepth : kMaxPly - 1;
+    YVal bestScore = 0;
+
+    CMoves legalMoves;
+    if ( mpPos->getWhoseMove().isWhite() )
+        mpPos->genLegalMoves<EColor::kWhite>( legalMoves );
+    else
+        mpPos->genLegalMoves<EColor::kBlack>( legalMoves );
+    std::vector<CMove> rootMoves;
+    for ( U16 moveIx = 0; moveIx < legalMoves.getNumMoves(); moveIx++ )
+        rootMoves.push_back( legalMoves.get( moveIx ) );
+
+    mStartTime = YClock::now();
+    mNodes = 0;
+    mbStopped = false;
+    mReports.clear();
+    mHistory.clear();
+    mPvLength[0] = 0;
+    rBestMove = CMove::null();
+    if ( rootMoves.empty() )
+    {
+        return mpPos->isKingAttacked( mpPos->getWhoseMove() ) 
+            ? YVal( -kMate ) : YVal( 0 );
+    }
+    rBestMove = rootMoves[0];
+
+    SSearchLimits savedLimits = mLimits;
+    mLimits.mMaxSeconds = 0;
+    if ( mLimits.mMaxNodes > 0 )
+    {
+        mLimits.mMaxNodes 
+            = std::max( mLimits.mMaxNodes / numThreads, U64( 1 ) );
+    }
+    if ( mpTransTable )
+    {
+        mpTransTable->clear();
+        mpTransTable->newSearch();
+    }
+
+    //  The helpers share out the memory of this thread's table, so that
+    //  more threads don't need more memory.
+    U32 helperMegaBytes = 0;
+    if ( mpTransTable )
+    {
+        U64 shareBytes = mpTransTable->getNumBuckets() 
+            * sizeof( CHashBuckets::SBucket ) / numThreads;
+        helperMegaBytes = U32( std::max( 
+            ( shareBytes + ( U64( 1 ) << 20 ) - 1 ) >> 20, 
+            U64( kMinHelperTableMegaBytes ) ) );
+    }
+
+    std::vector< std::unique_ptr<SHelper> > helpers;
+    std::vector<CSearcher*> searchers( 1, this );
+    for ( U32 helperIx = 1; helperIx < numThreads; helperIx++ )
+    {
+        helpers.emplace_back( new SHelper( *mpPos ) );
+        SHelper& rHelper = *helpers.back();
+        if ( mpTransTable )
+        {
+            rHelper.mpTable.reset( new CTransTable( helperMegaBytes ) );
+            rHelper.mSearcher.setTransTable( rHelper.mpTable.get() );
+        }
+        rHelper.mSearcher.setLimits( mLimits );
+        rHelper.mSearcher.setSearchCopyMake( mbSearchCopyMake );
+        searchers.push_back( &rHelper.mSearcher );
+    }
+    std::unique_ptr<CThreadPool> pPool( 
+        helpers.empty() ? nullptr : new CThreadPool( U32( helpers.size() ) ) );
+    std::vector<YVal> scores( rootMoves.size(), 0 );
+
+    for ( U16 depth = 1; depth <= maxDepth; depth++ )
+    {
+        for ( CSearcher* pSearcher : searchers )
+            pSearcher->mSelDepth = 0;
+
+        YVal score = searchRootMove( 
+            rootMoves[0], -kInfinite, kInfinite, depth );
+        if ( mbStopped )
+            break;
+        updatePv( 0, rootMoves[0] );
+        size_t bestIx = 0;
 
         //
-        //  If the move leaves us in check, it's not legal.  The
-        //  can be removed when genWhiteMoves implements check evasion.
+        //  Root move i goes to thread i mod numThreads, whatever the other
+        //  threads are doing.
         //
-        mpPos->findBlackCheckers();
-        if ( mpPos->getCheckers().get() )
+        YVal lowerBound = score;
+        auto searchShare = [&rootMoves, &scores, &searchers, numThreads, 
+            lowerBound, depth]( U32 threadIx )
         {
-            if ( depthLeft == 1 ) 
-                nodeCount++;
-            else
-                nodeCount += perftBlack( depthLeft - 1 );
+            CSearcher& rSearcher = *searchers[threadIx];
+            for ( size_t moveIx = 1; moveIx < rootMoves.size(); moveIx++ )
+            {
+                if ( moveIx % numThreads != threadIx || rSearcher.mbStopped )
+                    continue;
+                scores[moveIx] = rSearcher.searchRootMove( rootMoves[moveIx],
+                    lowerBound, lowerBound + 1, depth );
+            }
+        };
+        for ( U32 threadIx = 1; threadIx < numThreads; threadIx++ )
+        {
+            pPool->submit( [&searchShare, threadIx]( U32 ) 
+            { 
+                searchShare( threadIx ); 
+            } );
+        }
+        searchShare( 0 );
+        if ( pPool )
+            pPool->wait();
+
+        bool bStopped = false;
+        for ( CSearcher* pSearcher : searchers )
+            bStopped = bStopped || pSearcher->mbStopped;
+
+        //
+        //  A move that failed high only has a lower bound, which says 
+        //  nothing about how it compares with a move re-searched before 
+        //  it, so every one is searched again.
+        //
+        for ( size_t moveIx = 1; moveIx < rootMoves.size() && !bStopped; 
+            moveIx++ )
+        {
+            if ( scores[moveIx] <= lowerBound )
+                continue;
+            YVal moveScore = searchRootMove( 
+                rootMoves[moveIx], score, kInfinite, depth );
+            bStopped = mbStopped;
+            if ( !bStopped && moveScore > score )
+            {
+                score = moveScore;
+                bestIx = moveIx;
+                updatePv( 0, rootMoves[moveIx] );
+            }
+        }
+        if ( bStopped )
+            break;
+
+        //
+        //  The next iteration searches the best move first, and the rest 
+        //  in the same order as this one.
+        //
+        std::rotate( rootMoves.begin(), rootMoves.begin() + bestIx, 
+            rootMoves.begin() + bestIx + 1 );
+        rBestMove = rootMoves[0];
+        bestScore = score;
+
+        SSearchReport report;
+        report.mDepth = depth;
+        report.mSelDepth = 0;
+        report.mNodes = 0;
+        for ( CSearcher* pSearcher : searchers )
+        {
+            report.mSelDepth = std::max( report.mSelDepth, 
+                pSearcher->mSelDepth );
+            report.mNodes += pSearcher->mNodes;
+        }
+        report.mScore = score;
+        report.mSeconds = getSeconds();
+        report.mPv.assign( &mPv[0][0], &mPv[0][mPvLength[0]] );
+        mReports.push_back( report );
+        if ( mReportFn )
+            mReportFn( report );
+
+        if ( ( score >= kMateInMaxPly || score <= -kMateInMaxPly )
+            && kMate - std::abs( score ) <= depth )
+        {
+            break;
         }
-        mpPos->unmakeMove( move );
     }
-    return nodeCount;
+
+    for ( const std::unique_ptr<SHelper>& rpHelper : helpers )
+        mNodes += rpHelper->mSearcher.mNodes;
+    mLimits = savedLimits;
+    return bestScore;
 }
 
 ///
-/// generates the perft node count for the current position.
+/// searches one root move
 ///
-U64 CSearcher::perft( U16 depthLeft )
+/// @param depth
+///     is the depth of the search, counting the root move
+///
+/// @returns
+///     the score of the move, from the point of view of the side making it
+///
+YVal CSearcher::searchRootMove( 
+    CMove m, YVal lowerBound, YVal upperBound, U16 depth )
 {
-    if ( mpPos->getWhoseMove() == EColor::kWhite )
+    mStack[0].mHashKey = mpPos->getHashKey();
+    makeSearchMove( m, 0 );
+    if ( mpTransTable )
+        mpTransTable->prefetch( mpPos->getHashKey() );
+    mStack[0].mMove = m;
+    YVal score = -alphaBeta( -upperBound, -lowerBound, depth - 1, 1 );
+    unmakeSearchMove( m, 0 );
+    return score;
+}
+
+///
+/// does the iterative deepening for determineBestMove, and for each 
+/// thread of determineBestMoveParallel
+///
+YVal CSearcher::iterate( CMove& rBestMove )
+{
+    U16 maxDepth = mLimits.mMaxDepth > 0 && mLimits.mMaxDepth < kMaxPly
+        ? mLimits.mMaxDepth : kMaxPly - 1;
+    YVal bestScore = 0;
+
+    mStartTime = YClock::now();
+    mNodes = 0;
+    mbStopped = false;
+    mReports.clear();
+    mHistory.clear();
+    mPvLength[0] = 0;
+    rBestMove = CMove::null();
+
+    for ( U16 depth = mStartDepth; depth <= maxDepth; depth++ )
     {
-        return perftWhite( depthLeft );
+        mSelDepth = 0;
+        YVal score = alphaBeta( -kInfinite, kInfinite, depth, 0 );
+        if ( mbStopped )
+            break;
+
+        SSearchReport report;
+        report.mDepth = depth;
+        report.mSelDepth = mSelDepth;
+        report.mScore = score;
+        report.mNodes = getSearchedNodes();
+        report.mSeconds = getSeconds();
+        report.mPv.assign( &mPv[0][0], &mPv[0][mPvLength[0]] );
+        mReports.push_back( report );
+        if ( mReportFn )
+            mReportFn( report );
+
+        bestScore = score;
+        if ( mPvLength[0] > 0 )
+            rBestMove = mPv[0][0];
+
+        //
+        //  A mate found within the depth can't be bettered by going deeper.
+        //
+        if ( ( score >= kMateInMaxPly || score <= -kMateInMaxPly )
+            && kMate - std::abs( score ) <= depth )
+        {
+            break;
+        }
     }
-    else 
+
+    if ( rBestMove.isNull() )
+    {
+        CMoves moves;
+        if ( mpPos->getWhoseMove().isWhite() )
+            mpPos->genLegalMoves<EColor::kWhite>( moves );
+        else
+            mpPos->genLegalMoves<EColor::kBlack>( moves );
+        if ( moves.getNumMoves() > 0 )
+            rBestMove = moves.get( 0 );
+    }
+    return bestScore;
+}
+
+///
+/// searches the current position with a principal variation search: the 
+/// first move with the full window, and the rest with a null window that 
+/// only proves them worse, searching one again if it is not.
+///
+/// @param lowerBound
+///     is the score the side to move is already sure of (alpha)
+///
+/// @param upperBound
+///     is the score the opponent is already sure of holding it to (beta)
+///
+/// @param ply
+///     is the distance from the root
+///
+/// @returns
+///     the score, which is only an upper bound if it is at most lowerBound,
+///     and only a lower bound if it is at least upperBound
+///
+YVal CSearcher::alphaBeta( 
+    YVal lowerBound, YVal upperBound, U16 depthLeft, U16 ply )
+{
+    if ( depthLeft == 0 )
+        return qsearch( lowerBound, upperBound, ply );
+
+    //
+    //  The root tries the best move of the last iteration first.  It is 
+    //  read before this node's variation is emptied.
+    //
+    CMove hashMove = ply == 0 && mPvLength[0] > 0 ? mPv[0][0] : CMove::null();
+    mPvLength[ply] = ply;
+    mStack[ply].mHashKey = mpPos->getHashKey();
+    countNode( ply );
+    if ( mbStopped )
+        return 0;
+    if ( ply > 0 && isDraw( ply ) )
+        return 0;
+    if ( ply >= kMaxPly )
+        return CEval::evaluate( *mpPos );
+
+    bool bPvNode = upperBound - lowerBound > 1;
+    YVal originalLower = lowerBound;
+    STransHit hit;
+    if ( mpTransTable && mpTransTable->probe( mpPos->getHashKey(), hit ) )
+    {
+        if ( hashMove.isNull() )
+            hashMove = hit.mMove;
+
+        //
+        //  Principal variation nodes always search, so the variation 
+        //  reported is one the search actually played out.
+        //
+        YVal ttScore = scoreFromTT( hit.mScore, ply );
+        if ( !bPvNode && hit.mDepth >= depthLeft
+            && ( hit.mBound == CTransTable::kExactBound
+                || ( hit.mBound == CTransTable::kLowerBound 
+                    && ttScore >= upperBound )
+                || ( hit.mBound == CTransTable::kUpperBound 
+                    && ttScore <= lowerBound ) ) )
+        {
+            return ttScore;
+        }
+    }
+
+    CColor us = mpPos->getWhoseMove();
+    bool bInCheck = mpPos->isKingAttacked( us );
+    CMove prevMove = ply > 0 ? mStack[ply - 1].mMove : CMove::null();
+    CMovePicker picker( *mpPos, mHistory, hashMove, ply, prevMove );
+    YVal bestScore = -kInfinite;
+    CMove bestMove = CMove::null();
+    U16 numLegal = 0;
+    CMove m;
+
+    while ( picker.next( m ) )
+    {
+        if ( !makeSearchMove( m, ply ) )
+            continue;
+        if ( mpTransTable )
+            mpTransTable->prefetch( mpPos->getHashKey() );
+        mStack[ply].mMove = m;
+        numLegal++;
+
+        YVal score;
+        if ( numLegal == 1 )
+        {
+            score = -alphaBeta( 
+                -upperBound, -lowerBound, depthLeft - 1, ply + 1 );
+        }
+        else
+        {
+            score = -alphaBeta( 
+                -lowerBound - 1, -lowerBound, depthLeft - 1, ply + 1 );
+            if ( score > lowerBound && score < upperBound && !mbStopped )
+            {
+                score = -alphaBeta( 
+                    -upperBound, -lowerBound, depthLeft - 1, ply + 1 );
+            }
+        }
+        unmakeSearchMove( m, ply );
+        if ( mbStopped )
+            return 0;
+
+        if ( score > bestScore )
+        {
+            bestScore = score;
+            bestMove = m;
+            if ( score > lowerBound )
+            {
+                lowerBound = score;
+                updatePv( ply, m );
+                if ( score >= upperBound )
+                {
+                    mHistory.onCutoff( *mpPos, m, prevMove, ply, depthLeft );
+                    break;
+                }
+            }
+        }
+    }
+
+    if ( numLegal == 0 )
+        return bInCheck ? YVal( -kMate + ply ) : YVal( 0 );
+
+    if ( mpTransTable )
+    {
+        CTransTable::EBound bound = bestScore >= upperBound 
+            ? CTransTable::kLowerBound
+            : bestScore > originalLower 
+                ? CTransTable::kExactBound : CTransTable::kUpperBound;
+        mpTransTable->store( mpPos->getHashKey(), 
+            bound == CTransTable::kUpperBound ? CMove::null() : bestMove,
+            scoreToTT( bestScore, ply ), U8( depthLeft ), bound );
+    }
+    return bestScore;
+}
+
+///
+/// searches only the captures, so that the score of a position is not 
+/// taken in the middle of an exchange.  The side to move may stand pat on
+/// the static evaluation instead, unless it is in check, when every 
+/// evasion is searched.  To keep the tree small, captures that lose 
+/// material by static exchange are not searched, nor are captures that 
+/// could not bring the score up to lowerBound even if nothing were 
+/// recaptured (delta pruning).
+///
+YVal CSearcher::qsearch( YVal lowerBound, YVal upperBound, U16 ply )
+{
+    mPvLength[ply] = ply;
+    countNode( ply );
+    if ( mbStopped )
+        return 0;
+    if ( ply >= kMaxPly )
+        return CEval::evaluate( *mpPos );
+
+    //
+    //  Every entry is at least as deep as the quiescence search, so any 
+    //  bound that settles the window will do.
+    //
+    YVal originalLower = lowerBound;
+    CMove hashMove = CMove::null();
+    STransHit hit;
+    if ( mpTransTable && mpTransTable->probe( mpPos->getHashKey(), hit ) )
+    {
+        hashMove = hit.mMove;
+        YVal ttScore = scoreFromTT( hit.mScore, ply );
+        if ( hit.mBound == CTransTable::kExactBound
+            || ( hit.mBound == CTransTable::kLowerBound 
+                && ttScore >= upperBound )
+            || ( hit.mBound == CTransTable::kUpperBound 
+                && ttScore <= lowerBound ) )
+        {
+            return ttScore;
+        }
+    }
+
+    CColor us = mpPos->getWhoseMove();
+    bool bInCheck = mpPos->isKingAttacked( us );
+    YVal standPat = -kInfinite;
+    YVal bestScore = -kInfinite;
+    if ( !bInCheck )
+    {
+        standPat = CEval::evaluate( *mpPos );
+        bestScore = standPat;
+        if ( bestScore >= upperBound )
+            return bestScore;
+        if ( bestScore > lowerBound )
+            lowerBound = bestScore;
+    }
+
+    CMovePicker picker( *mpPos, mHistory, hashMove );
+    CMove bestMove = CMove::null();
+    U16 numLegal = 0;
+    CMove m;
+
+    while ( picker.next( m ) )
     {
-        return perftBlack( depthLeft );
+        if ( !bInCheck )
+        {
+            //
+            //  The picker leaves out the losing captures, except the hash 
+            //  move, which it hands out before it has scored anything.
+            //
+            if ( m == hashMove && !mpPos->seeGE( m, 0 ) )
+                continue;
+
+            //
+            //  The best score the capture could leave us with is still a 
+            //  bound on what it is worth, so it can stand in for it.
+            //
+            S32 gain = CEval::kPieceValues[U8( m.isEnPassant() 
+                ? EPieceType::kPawn 
+                : mpPos->getPiece( m.getTo().get() ).getPieceType().get() )];
+            if ( m.isPromo() )
+            {
+                gain += CEval::kPieceValues[U8( m.getPromo().get() )]
+                    - CEval::kPieceValues[U8( EPieceType::kPawn )];
+            }
+            if ( standPat + gain + kDeltaMargin <= lowerBound )
+            {
+                bestScore = std::max( bestScore, 
+                    YVal( standPat + gain + kDeltaMargin ) );
+                continue;
+            }
+        }
+
+        if ( !makeSearchMove( m, ply ) )
+            continue;
+        if ( mpTransTable )
+            mpTransTable->prefetch( mpPos->getHashKey() );
+        mStack[ply].mMove = m;
+        numLegal++;
+        YVal score = -qsearch( -upperBound, -lowerBound, ply + 1 );
+        unmakeSearchMove( m, ply );
+        if ( mbStopped )
+            return 0;
+
+        if ( score > bestScore )
+        {
+            bestScore = score;
+            if ( score > lowerBound )
+            {
+                lowerBound = score;
+                bestMove = m;
+                if ( score >= upperBound )
+                    break;
+            }
+        }
     }
+
+    if ( bInCheck && numLegal == 0 )
+        return YVal( -kMate + ply );
+
+    if ( mpTransTable )
+    {
+        CTransTable::EBound bound = bestScore >= upperBound 
+            ? CTransTable::kLowerBound
+            : bestScore > originalLower 
+                ? CTransTable::kExactBound : CTransTable::kUpperBound;
+        mpTransTable->store( mpPos->getHashKey(), bestMove,
+            scoreToTT( bestScore, ply ), 0, bound );
+    }
+    return bestScore;
+}
+
+///
+/// switches the search between make/unmake and copy-make
+///
+void CSearcher::setSearchCopyMake( bool bCopyMake )
+{
+    mbSearchCopyMake = bCopyMake;
+    if ( bCopyMake )
+        mChildren.reserve( kMaxPly + 1 );
+}
+
+///
+/// makes a move of the search, either in the one position or by copy-making
+/// the child for the next ply and moving mpPos to it.  A move that leaves 
+/// the mover's king attacked is taken back again.
+///
+/// @param ply
+///     is the ply the move is made from
+///
+/// @returns
+///     true if the move was legal, and is made
+///
+bool CSearcher::makeSearchMove( CMove m, U16 ply )
+{
+    CColor us = mpPos->getWhoseMove();
+    if ( mbSearchCopyMake )
+    {
+        if ( ply < mChildren.size() )
+            mChildren[ply].copyMake( *mpPos, m );
+        else
+            mChildren.emplace_back( *mpPos, m );
+        mpPos = &mChildren[ply];
+    }
+    else
+        mpPos->makeMove( m );
+    if ( mpPos->isKingAttacked( us ) )
+    {
+        unmakeSearchMove( m, ply );
+        return false;
+    }
+    return true;
+}
+
+///
+/// takes back a move made by makeSearchMove from ply
+///
+void CSearcher::unmakeSearchMove( CMove m, U16 ply )
+{
+    if ( mbSearchCopyMake )
+        mpPos = ply == 0 ? mpRootPos : &mChildren[ply - 1];
+    else
+        mpPos->unmakeMove( m );
+}
+
+///
+/// @returns 
+///     true if the position at ply is drawn by the fifty move rule or by 
+///     repetition.  The children of a copy-make search have no undo stack,
+///     so their history is the search stack back to the root, and the 
+///     root's undo stack before that.
+///
+bool CSearcher::isDraw( U16 ply ) const
+{
+    if ( !mbSearchCopyMake )
+        return mpPos->isDraw();
+    if ( mpPos->getHalfMoveClock() >= 100 )
+        return true;
+
+    U16 numBack = std::min( U16( mpPos->getHalfMoveClock() ), 
+        U16( ply + mpRootPos->getNumUndos() ) );
+    for ( U16 back = 4; back <= numBack; back += 2 )
+    {
+        YHashKey key = back <= ply 
+            ? mStack[ply - back].mHashKey 
+            : mpRootPos->getPastHashKey( back - ply );
+        if ( key == mpPos->getHashKey() )
+            return true;
+    }
+    return false;
+}
+
+///
+/// counts a node, and stops the search once it reaches its node or time 
+/// limit, or once another thread signals it to.  The clock and the signal
+/// are only read every kNodesPerCheck nodes, which is also when the count
+/// is added to the one shared by the threads.
+///
+void CSearcher::countNode( U16 ply )
+{
+    mNodes++;
+    if ( ply > mSelDepth )
+        mSelDepth = ply;
+    if ( mLimits.mMaxNodes > 0 && mNodes >= mLimits.mMaxNodes )
+        mbStopped = true;
+    if ( ( mNodes & ( kNodesPerCheck - 1 ) ) != 0 )
+        return;
+
+    if ( mpSharedNodes )
+        mpSharedNodes->fetch_add( kNodesPerCheck, std::memory_order_relaxed );
+    if ( mpStopSignal && mpStopSignal->load( std::memory_order_relaxed ) )
+        mbStopped = true;
+    if ( mLimits.mMaxSeconds > 0 && getSeconds() >= mLimits.mMaxSeconds )
+        mbStopped = true;
+}
+
+///
+/// @returns
+///     the nodes searched so far by this thread, and by the threads 
+///     searching alongside it as of their last check in
+///
+U64 CSearcher::getSearchedNodes() const
+{
+    if ( !mpSharedNodes )
+        return mNodes;
+    return mpSharedNodes->load( std::memory_order_relaxed ) 
+        + ( mNodes & ( kNodesPerCheck - 1 ) );
+}
+
+///
+/// makes m followed by the variation of the next ply the variation of ply
+///
+void CSearcher::updatePv( U16 ply, CMove m )
+{
+    mPv[ply][ply] = m;
+    for ( U16 pvIx = ply + 1; pvIx < mPvLength[ply + 1]; pvIx++ )
+        mPv[ply][pvIx] = mPv[ply + 1][pvIx];
+    mPvLength[ply] = std::max( mPvLength[ply + 1], U16( ply + 1 ) );
+}
+
+///
+/// @returns the seconds since the search started
+///
+double CSearcher::getSeconds() const
+{
+    return std::chrono::duration<double>( YClock::now() - mStartTime ).count();
+}
+
+///
+/// @returns the report as a UCI info line, without the "info"
+///
+std::string SSearchReport::asStr() const
+{
+    std::string s = "depth " + std::to_string( mDepth )
+        + " seldepth " + std::to_string( mSelDepth );
+
+    //
+    //  UCI gives mates in moves rather than plies.
+    //
+    if ( mScore >= CSearcher::kMateInMaxPly )
+    {
+        s += " score mate " 
+            + std::to_string( ( CSearcher::kMate - mScore + 1 ) / 2 );
+    }
+    else if ( mScore <= -CSearcher::kMateInMaxPly )
+    {
+        s += " score mate -" 
+            + std::to_string( ( CSearcher::kMate + mScore ) / 2 );
+    }
+    else
+        s += " score cp " + std::to_string( mScore );
+
+    s += " nodes " + std::to_string( mNodes )
+        + " nps " + std::to_string( getNps() )
+        + " time " + std::to_string( U64( mSeconds * 1000 ) )
+        + " pv";
+    for ( CMove m : mPv )
+        s += " " + m.asStr();
+    return s;
 }
@@ -8,7 +8,14 @@
 #ifndef Fiesty_search_h
 #define Fiesty_search_h
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
 #include "position.h"
+#include "movepicker.h"
+#include "transtable.h"
 
 class CVal
 {
@@ -20,23 +27,277 @@ private:
 
 };
 
+///
+/// What one worker of a parallel perft did
+///
+struct SPerftThreadStats
+{
+    U64         mNodes;
+    U64         mTasks;
+    double      mSeconds;           // time spent running tasks
+
+    double getNps() const { return mSeconds > 0 ? mNodes / mSeconds : 0; }
+};
+
+///
+/// The standard perft breakdown of the moves made at the last ply
+///
+struct SPerftStats
+{
+    U64         mNodes;
+    U64         mCaptures;          // including en passant
+    U64         mEnPassants;
+    U64         mCastles;
+    U64         mPromotions;
+    U64         mChecks;
+    U64         mDiscoveredChecks;  // by a piece other than the one moved
+    U64         mDoubleChecks;
+    U64         mCheckmates;
+
+    std::string asStr() const;
+};
+
+///
+/// The node count below one root move, from a perft divide
+///
+struct SPerftDivide
+{
+    CMove       mMove;
+    U64         mNodes;
+};
+
+///
+/// What one iteration of the search found
+///
+struct SSearchReport
+{
+    U16                 mDepth;
+    U16                 mSelDepth;      // with the quiescence search
+    YVal                mScore;
+    U64                 mNodes;
+    double              mSeconds;
+    std::vector<CMove>  mPv;
+
+    U64 getNps() const { return mSeconds > 0 ? U64( mNodes / mSeconds ) : 0; }
+    std::string asStr() const;
+};
+
+///
+/// When a search stops: after a depth, a number of nodes or a time, 
+/// whichever comes first.  Zero means no limit.
+///
+struct SSearchLimits
+{
+    U16         mMaxDepth;
+    U64         mMaxNodes;
+    double      mMaxSeconds;
+};
+
 ///
 /// Class that does the searching
 ///
 class CSearcher
 {
 public:
-    CSearcher( CPos& rPos ) { mpPos = &rPos; }
-    void determineBestMove( CMove& rBestMoves ); // Todo ...
+    typedef std::function<void( const SSearchReport& )> YReportFn;
+
+    static const U16    kMaxPly = CMoveHistory::kMaxPly;
+    static const YVal   kInfinite = 32000;
+    static const YVal   kMate = 31000;          // less the plies to mate
+    static const YVal   kMateInMaxPly = kMate - kMaxPly;
+
+    //
+    //  What the quiescence search allows for positional gains on top of 
+    //  the material a capture wins, before pruning it as hopeless.
+    //
+    static const YVal   kDeltaMargin = 200;
+
+    static const U64    kNodesPerCheck = 1024;
+
+    //
+    //  The fewest megabytes a deterministic search helper's table gets.
+    //
+    static const U32    kMinHelperTableMegaBytes = 1;
+
+    CSearcher( CPos& rPos ) 
+    { 
+        mpPos = &rPos; 
+        mpRootPos = &rPos;
+        mpPerftTable = nullptr; 
+        mbPerftBulkCount = false;
+        mbPerftCopyMake = false;
+        mpTransTable = nullptr;
+        mLimits = SSearchLimits();
+        mNodes = 0;
+        mSelDepth = 0;
+        mbStopped = false;
+        mpStopSignal = nullptr;
+        mpSharedNodes = nullptr;
+        mStartDepth = 1;
+        mbDeterministic = false;
+        mbSearchCopyMake = false;
+    }
+    YVal determineBestMove( CMove& rBestMove );
+    YVal determineBestMoveParallel( CMove& rBestMove, U32 numThreads );
     U64 perft( U16 depthLeft ); // Todo...
+    U64 perftParallel( U16 depthLeft, U32 numThreads, U16 splitPlies = 1 );
+    U64 perftDivide( U16 depthLeft, std::vector<SPerftDivide>& rDivide );
+    SPerftStats perftStats( U16 depthLeft );
+
+    ///
+    /// makes perft look up and save subtree counts in a table, which may
+    /// be shared with other searchers.  Pass nullptr to count every node.
+    ///
+    void setPerftTable( CPerftTable* pTable ) { mpPerftTable = pTable; }
+
+    ///
+    /// switches perft between making every move down to the leaves, and 
+    /// counting the legal moves one ply above them without making them.  
+    /// The first times make and unmake as well as the generator, the 
+    /// second mostly the generator.
+    ///
+    void setPerftBulkCount( bool bBulkCount ) 
+    { 
+        mbPerftBulkCount = bBulkCount; 
+    }
+
+    ///
+    /// switches perft between making and unmaking each move in the one
+    /// position, and copy-making a child position for each move.
+    ///
+    void setPerftCopyMake( bool bCopyMake ) { mbPerftCopyMake = bCopyMake; }
+
+    ///
+    /// makes the search look up and save positions in a table, which may 
+    /// be shared with other searchers.  Pass nullptr to search without one.
+    ///
+    void setTransTable( CTransTable* pTable ) { mpTransTable = pTable; }
+
+    ///
+    /// switches the search between making and unmaking each move in the 
+    /// one position, and copy-making a child position for each move.  The
+    /// two search the same tree, so only the time they take differs.
+    ///
+    void setSearchCopyMake( bool bCopyMake );
+    void setLimits( const SSearchLimits& limits ) { mLimits = limits; }
+
+    ///
+    /// switches determineBestMoveParallel between Lazy SMP, which is fast
+    /// but gives a different answer on every run, and splitting the root 
+    /// moves between the threads in a fixed way, which gives the same 
+    /// answer every time for the same thread count and limits.
+    ///
+    void setDeterministic( bool bDeterministic ) 
+    { 
+        mbDeterministic = bDeterministic; 
+    }
+
+    ///
+    /// sets a function to call with the report of each iteration as it 
+    /// completes
+    ///
+    void setReportFn( YReportFn reportFn ) { mReportFn = reportFn; }
+
+    ///
+    /// @returns the reports of the iterations of the last search
+    ///
+    const std::vector<SSearchReport>& getReports() const 
+    { 
+        return mReports; 
+    }
+
+    ///
+    /// @returns the nodes searched by the last search, in every thread
+    ///
+    U64 getNodes() const { return mNodes; }
+
+    ///
+    /// @returns the per-worker counts of the last parallel perft
+    ///
+    const std::vector<SPerftThreadStats>& getPerftThreadStats() const 
+    { 
+        return mPerftThreadStats; 
+    }
 
 private:
     CPos*           mpPos;
+    CPos*           mpRootPos;
     CMoves          mBestMoves;
+    CPerftTable*    mpPerftTable;
+    bool            mbPerftBulkCount;
+    bool            mbPerftCopyMake;
+
+    std::vector<SPerftThreadStats>  mPerftThreadStats;
+
+    //
+    //  The search state.  Everything a node needs is preallocated here, 
+    //  indexed by ply, so the search itself never allocates.  mPv is the 
+    //  triangular table of principal variations: row ply holds the best 
+    //  line found from that ply, in columns ply to mPvLength[ply] - 1.
+    //
+    struct SStackEntry
+    {
+        CMove       mMove;              // the move made from this ply
+        YHashKey    mHashKey;           // of the position at this ply
+    };
+
+    typedef std::chrono::steady_clock YClock;
+
+    CTransTable*                mpTransTable;
+    SSearchLimits               mLimits;
+    YReportFn                   mReportFn;
+    std::vector<SSearchReport>  mReports;
+    CMoveHistory                mHistory;
+    SStackEntry                 mStack[kMaxPly + 1];
+    CMove                       mPv[kMaxPly + 1][kMaxPly + 1];
+    U16                         mPvLength[kMaxPly + 1];
+    U64                         mNodes;
+    U16                         mSelDepth;
+    bool                        mbStopped;
+    YClock::time_point          mStartTime;
+
+    //
+    //  What a thread of a parallel search shares with the others: the 
+    //  signal to stop, set by the main thread, and the count of the nodes
+    //  they have all searched.  Both are null for a search on one thread.
+    //  mStartDepth is the depth of the first iteration.
+    //
+    const std::atomic<bool>*    mpStopSignal;
+    std::atomic<U64>*           mpSharedNodes;
+    U16                         mStartDepth;
+    bool                        mbDeterministic;
+
+    //
+    //  For a copy-make search, the position at each ply after the root, 
+    //  which is mpRootPos.  Each is copy-made the first time its ply is 
+    //  reached, into room reserved when copy-make is switched on, so the 
+    //  positions never move.
+    //
+    bool                        mbSearchCopyMake;
+    std::vector<CPos>           mChildren;
 
-    U64 perftWhite( U16 depthLeft );
-    U64 perftBlack( U16 depthLeft );
-    YVal alphaBeta( YVal lowerBound, YVal upperBound, U16 depthLeft ); // Todo ...
-    YVal qsearch( YVal lowerBound, YVal upperBound );   // Todo ...
+    template <EColor C> U64 perftFor( U16 depthLeft );
+    template <EColor C> void perftStatsFor( 
+        U16 depthLeft, SPerftStats& rStats );
+    template <EColor C> void countLeafStats( 
+        CMove m, SPerftStats& rStats );
+    template <EColor C> void collectSplitPaths( 
+        std::vector<CMove>&                 rPath, 
+        U16                                 pliesLeft,
+        std::vector< std::vector<CMove> >&  rPaths );
+    YVal alphaBeta( 
+        YVal lowerBound, YVal upperBound, U16 depthLeft, U16 ply );
+    YVal qsearch( YVal lowerBound, YVal upperBound, U16 ply );
+    YVal iterate( CMove& rBestMove );
+    YVal determineBestMoveSplit( CMove& rBestMove, U32 numThreads );
+    YVal searchRootMove( 
+        CMove m, YVal lowerBound, YVal upperBound, U16 depth );
+    bool makeSearchMove( CMove m, U16 ply );
+    void unmakeSearchMove( CMove m, U16 ply );
+    bool isDraw( U16 ply ) const;
+    void countNode( U16 ply );
+    U64 getSearchedNodes() const;
+    void updatePv( U16 ply, CMove m );
+    double getSeconds() const;
 };
 #endif 
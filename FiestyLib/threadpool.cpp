@@ -0,0 +1,144 @@
+/// file threadpool.cpp
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// code having to do with running tasks on a pool of threads
+///
+///
+#include "fiesty.h"
+#include "threadpool.h"
+
+///
+/// starts the worker threads, which wait for tasks
+///
+/// @param numThreads
+///     is the number of workers, at least one
+///
+CThreadPool::CThreadPool( U32 numThreads )
+{
+    if ( numThreads == 0 )
+        numThreads = 1;
+    mpQueues.reset( new SQueue[numThreads] );
+    mNumQueued = 0;
+    mNumUnfinished = 0;
+    mNextQueueIx = 0;
+    mbStopping = false;
+    for ( U32 workerIx = 0; workerIx < numThreads; workerIx++ )
+        mThreads.emplace_back( &CThreadPool::workerLoop, this, workerIx );
+}
+
+///
+/// finishes the queued tasks and stops the workers
+///
+CThreadPool::~CThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mbStopping = true;
+    }
+    mWorkCv.notify_all();
+    for ( std::thread& rThread : mThreads )
+        rThread.join();
+}
+
+///
+/// queues a task.  Tasks are dealt out to the workers' queues in turn, and
+/// may themselves submit more tasks.
+///
+void CThreadPool::submit( YTask task )
+{
+    U32 queueIx;
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        queueIx = mNextQueueIx;
+        mNextQueueIx = ( mNextQueueIx + 1 ) % getNumThreads();
+        mNumUnfinished++;
+        mNumQueued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock( mpQueues[queueIx].mMutex );
+        mpQueues[queueIx].mTasks.push_back( std::move( task ) );
+    }
+    mWorkCv.notify_one();
+}
+
+///
+/// blocks until every task submitted so far has finished
+///
+void CThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock( mMutex );
+    mDoneCv.wait( lock, [this] { return mNumUnfinished == 0; } );
+}
+
+///
+/// takes the next task for a worker: the newest of its own, or else the
+/// oldest of another worker's.
+///
+/// @returns
+///     false if every queue was empty
+///
+bool CThreadPool::popTask( U32 workerIx, YTask& rTask )
+{
+    SQueue& rOwn = mpQueues[workerIx];
+    {
+        std::lock_guard<std::mutex> lock( rOwn.mMutex );
+        if ( !rOwn.mTasks.empty() )
+        {
+            rTask = std::move( rOwn.mTasks.back() );
+            rOwn.mTasks.pop_back();
+            return true;
+        }
+    }
+
+    for ( U32 offset = 1; offset < getNumThreads(); offset++ )
+    {
+        SQueue& rVictim = mpQueues[( workerIx + offset ) % getNumThreads()];
+        std::lock_guard<std::mutex> lock( rVictim.mMutex );
+        if ( !rVictim.mTasks.empty() )
+        {
+            rTask = std::move( rVictim.mTasks.front() );
+            rVictim.mTasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+///
+/// runs tasks until the pool is destroyed, sleeping while there are none
+///
+void CThreadPool::workerLoop( U32 workerIx )
+{
+    YTask task;
+
+    for ( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> lock( mMutex );
+            mWorkCv.wait( lock,
+                [this] { return mbStopping || mNumQueued > 0; } );
+            if ( mNumQueued == 0 )
+                return;
+        }
+
+        //
+        //  Another worker may have taken the task we were woken for, or it
+        //  may not have reached its queue yet.
+        //
+        if ( !popTask( workerIx, task ) )
+            continue;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mNumQueued--;
+        }
+
+        task( workerIx );
+        task = nullptr;
+
+        std::lock_guard<std::mutex> lock( mMutex );
+        if ( --mNumUnfinished == 0 )
+            mDoneCv.notify_all();
+    }
+}
@@ -0,0 +1,70 @@
+/// file threadpool.h
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// headers having to do with running tasks on a pool of threads
+///
+///
+#ifndef Fiesty_threadpool_h
+#define Fiesty_threadpool_h
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "fiesty.h"
+
+///
+/// A fixed set of worker threads that run submitted tasks.  Each worker
+/// has its own queue and runs its newest task first, which keeps the data
+/// it just touched in its cache.  A worker whose queue is empty steals the
+/// oldest task of another worker, which is usually the biggest one left.
+///
+class CThreadPool
+{
+public:
+    ///
+    /// a task is passed the index of the worker running it, from 0 to
+    /// getNumThreads() - 1, so it can keep per-worker results without
+    /// locking.
+    ///
+    typedef std::function<void( U32 workerIx )> YTask;
+
+    CThreadPool( U32 numThreads );
+    ~CThreadPool();
+
+    U32 getNumThreads() const { return U32( mThreads.size() ); }
+    void submit( YTask task );
+    void wait();
+
+private:
+    struct SQueue
+    {
+        std::mutex              mMutex;
+        std::deque<YTask>       mTasks;
+    };
+
+    void workerLoop( U32 workerIx );
+    bool popTask( U32 workerIx, YTask& rTask );
+
+    std::vector<std::thread>    mThreads;
+    std::unique_ptr<SQueue[]>   mpQueues;
+
+    //
+    //  mMutex guards the counts and the stop flag.  mWorkCv wakes idle
+    //  workers when a task is queued, and mDoneCv wakes wait() when the
+    //  last task finishes.
+    //
+    std::mutex                  mMutex;
+    std::condition_variable     mWorkCv;
+    std::condition_variable     mDoneCv;
+    U64                         mNumQueued;
+    U64                         mNumUnfinished;
+    U32                         mNextQueueIx;
+    bool                        mbStopping;
+};
+
+#endif      // threadpool.h
@@ -0,0 +1,249 @@
+/// file transtable.cpp
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// code having to do with the transposition and perft tables
+///
+///
+#include "fiesty.h"
+#include "transtable.h"
+
+///
+/// constructs an empty table
+///
+/// @param megaBytes
+///     is the most memory the table may use
+///
+CHashBuckets::CHashBuckets( U32 megaBytes )
+{
+    mpBuckets = nullptr;
+    resize( megaBytes );
+}
+
+///
+/// reallocates the table and empties it.  The number of buckets is the
+/// largest power of two that fits, so a key is mapped to its bucket with a
+/// mask.
+///
+/// @param megaBytes
+///     is the most memory the table may use
+///
+void CHashBuckets::resize( U32 megaBytes )
+{
+    U64 numBuckets = 1;
+    while ( numBuckets * 2 * sizeof( SBucket ) <= U64( megaBytes ) << 20 )
+        numBuckets *= 2;
+
+    delete[] mpBuckets;
+    mpBuckets = new SBucket[numBuckets];
+    mBucketMask = numBuckets - 1;
+    clear();
+}
+
+///
+/// empties the table.  An empty entry has all bits zero, which the tables
+/// built on it must not take for real data.
+///
+void CHashBuckets::clear()
+{
+    for ( U64 bucketIx = 0; bucketIx <= mBucketMask; bucketIx++ )
+    {
+        for ( SEntry& rEntry : mpBuckets[bucketIx].mEntries )
+            rEntry.store( 0, 0 );
+    }
+}
+
+///
+/// looks up a position
+///
+/// @param key
+///     is the hash key of the position
+///
+/// @param rHit
+///     receives the entry, if one is found
+///
+/// @returns
+///     true if the table has an intact entry for the key
+///
+bool CTransTable::probe( YHashKey key, STransHit& rHit ) const
+{
+    U64 data;
+    for ( const CHashBuckets::SEntry& rEntry 
+        : mBuckets.getBucket( key ).mEntries )
+    {
+        if ( rEntry.load( key, data ) && dataBound( data ) != kNoBound )
+        {
+            rHit.mMove = dataMove( data );
+            rHit.mScore = dataScore( data );
+            rHit.mDepth = dataDepth( data );
+            rHit.mBound = dataBound( data );
+            return true;
+        }
+    }
+    return false;
+}
+
+///
+/// saves what the search found out about a position.  An entry for the
+/// same key is overwritten, but keeps its move if the new one has none.
+/// It is kept instead if it is from this search and deeper, unless the 
+/// new score is exact, so that a quiescence search reaching the position
+/// doesn't wipe out what a deep search found.  Otherwise the entry 
+/// replaced is the one that is the shallowest once entries from earlier
+/// searches are counted as 8 plies shallower for each search since they 
+/// were stored.
+///
+/// @param key
+///     is the hash key of the position
+///
+/// @param m
+///     is the best move found, or the null move
+///
+/// @param score
+///     is the score, an upper or lower bound or exact according to bound
+///
+/// @param depth
+///     is the depth that was searched
+///
+void CTransTable::store(
+    YHashKey    key,
+    CMove       m,
+    S16         score,
+    U8          depth,
+    EBound      bound )
+{
+    CHashBuckets::SBucket& rBucket = mBuckets.getBucket( key );
+    CHashBuckets::SEntry* pVictim = &rBucket.mEntries[0];
+    S32 victimWorth = S32( 0x7FFFFFFF );
+    U64 data;
+
+    for ( CHashBuckets::SEntry& rEntry : rBucket.mEntries )
+    {
+        if ( rEntry.load( key, data ) )
+        {
+            if ( bound != kExactBound && depth < dataDepth( data )
+                && dataGeneration( data ) == mGeneration )
+            {
+                //
+                //  The deeper entry stays, but can still take the move.
+                //
+                if ( dataMove( data ).isNull() && !m.isNull() )
+                {
+                    rEntry.store( key, packData( m, dataScore( data ), 
+                        dataDepth( data ), dataBound( data ), mGeneration ) );
+                }
+                return;
+            }
+            if ( m.isNull() )
+                m = dataMove( data );
+            pVictim = &rEntry;
+            break;
+        }
+
+        U8 age = ( mGeneration - dataGeneration( data ) ) & kGenerationMask;
+        S32 worth = dataBound( data ) == kNoBound
+            ? -1000 : S32( dataDepth( data ) ) - 8 * age;
+        if ( worth < victimWorth )
+        {
+            victimWorth = worth;
+            pVictim = &rEntry;
+        }
+    }
+    pVictim->store( key, packData( m, score, depth, bound, mGeneration ) );
+}
+
+///
+/// @returns
+///     the number of entries per thousand used by the current search,
+///     estimated from the first thousand buckets
+///
+U16 CTransTable::getPermilleFull() const
+{
+    U64 numSampled = getNumBuckets() < 1000 ? getNumBuckets() : 1000;
+    U64 numUsed = 0;
+
+    for ( U64 bucketIx = 0; bucketIx < numSampled; bucketIx++ )
+    {
+        for ( const CHashBuckets::SEntry& rEntry 
+            : mBuckets.getBucket( bucketIx ).mEntries )
+        {
+            U64 data = rEntry.mData.load( std::memory_order_relaxed );
+            if ( dataBound( data ) != kNoBound
+                && dataGeneration( data ) == mGeneration )
+            {
+                numUsed++;
+            }
+        }
+    }
+    return U16( numUsed * 1000 
+        / ( numSampled * CHashBuckets::kEntriesPerBucket ) );
+}
+
+///
+/// looks up the node count of a subtree
+///
+/// @param key
+///     is the hash key of the subtree's root
+///
+/// @param depthLeft
+///     is the depth of the subtree
+///
+/// @param rNodes
+///     receives the node count, if one is found
+///
+/// @returns
+///     true if the table has an intact count for the key and depth
+///
+bool CPerftTable::probe( YHashKey key, U16 depthLeft, U64& rNodes ) const
+{
+    U64 data;
+    for ( const CHashBuckets::SEntry& rEntry 
+        : mBuckets.getBucket( key ).mEntries )
+    {
+        if ( rEntry.load( key, data ) && ( data >> 56 ) == depthLeft 
+            && data != 0 )
+        {
+            rNodes = data & kNodesMask;
+            return true;
+        }
+    }
+    return false;
+}
+
+///
+/// saves the node count of a subtree.  It replaces the entry for the same
+/// key and depth if there is one, and otherwise the shallowest entry, 
+/// since deeper subtrees cost more to count again.
+///
+/// @param key
+///     is the hash key of the subtree's root
+///
+/// @param depthLeft
+///     is the depth of the subtree, below 256
+///
+/// @param nodes
+///     is the node count
+///
+void CPerftTable::store( YHashKey key, U16 depthLeft, U64 nodes )
+{
+    CHashBuckets::SBucket& rBucket = mBuckets.getBucket( key );
+    CHashBuckets::SEntry* pVictim = &rBucket.mEntries[0];
+    U64 victimDepth = ~0ULL;
+    U64 data;
+
+    for ( CHashBuckets::SEntry& rEntry : rBucket.mEntries )
+    {
+        if ( rEntry.load( key, data ) && ( data >> 56 ) == depthLeft )
+        {
+            pVictim = &rEntry;
+            break;
+        }
+        if ( ( data >> 56 ) < victimDepth )
+        {
+            victimDepth = data >> 56;
+            pVictim = &rEntry;
+        }
+    }
+    pVictim->store( 
+        key, ( U64( depthLeft ) << 56 ) | ( nodes & kNodesMask ) );
+}
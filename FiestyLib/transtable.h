@@ -0,0 +1,180 @@
+/// file transtable.h
+///
+/// Fiesty (C) 2014 by Jeffery A Esposito
+///
+/// headers having to do with the transposition and perft tables
+///
+///
+#ifndef Fiesty_transtable_h
+#define Fiesty_transtable_h
+
+#include <atomic>
+#include "fiesty.h"
+#include "move.h"
+
+///
+/// An array of 64 byte buckets, one cache line each, of four entries, 
+/// shared by many threads without locks.  The transposition table and the
+/// perft table are built on it.
+///
+/// An entry is two 64 bit words: the data, and the hash key XORed with the
+/// data.  The words are written separately, so two threads storing at once
+/// can leave an entry with one word from each.  A probe XORs the words back
+/// together and only trusts the entry if that gives its own key.
+///
+class CHashBuckets
+{
+public:
+    static const U8     kEntriesPerBucket = 4;
+
+    struct SEntry
+    {
+        std::atomic<U64>    mKeyXorData;
+        std::atomic<U64>    mData;
+
+        ///
+        /// @returns true if the entry holds intact data for the key, which
+        /// is then put in rData
+        ///
+        bool load( YHashKey key, U64& rData ) const
+        {
+            rData = mData.load( std::memory_order_relaxed );
+            return ( mKeyXorData.load( std::memory_order_relaxed ) ^ rData )
+                == key;
+        }
+
+        void store( YHashKey key, U64 data )
+        {
+            mKeyXorData.store( key ^ data, std::memory_order_relaxed );
+            mData.store( data, std::memory_order_relaxed );
+        }
+    };
+
+    struct alignas( 64 ) SBucket
+    {
+        SEntry              mEntries[kEntriesPerBucket];
+    };
+
+    CHashBuckets( U32 megaBytes );
+    ~CHashBuckets() { delete[] mpBuckets; }
+
+    void resize( U32 megaBytes );
+    void clear();
+    U64 getNumBuckets() const { return mBucketMask + 1; }
+    SBucket& getBucket( YHashKey key ) 
+    { 
+        return mpBuckets[key & mBucketMask]; 
+    }
+    const SBucket& getBucket( YHashKey key ) const 
+    { 
+        return mpBuckets[key & mBucketMask]; 
+    }
+
+    ///
+    /// starts loading the bucket for a key into the cache.  Call it right
+    /// after making a move, so the load overlaps with the work done before
+    /// the probe.
+    ///
+    void prefetch( YHashKey key ) const
+    {
+        _mm_prefetch( 
+            ( const char* )&mpBuckets[key & mBucketMask], _MM_HINT_T0 );
+    }
+
+private:
+    SBucket*        mpBuckets;
+    U64             mBucketMask;
+};
+
+///
+/// What a transposition table entry says about a position
+///
+struct STransHit
+{
+    CMove       mMove;
+    S16         mScore;
+    U8          mDepth;
+    U8          mBound;
+};
+
+///
+/// The transposition table, shared by all the search threads without
+/// locks.
+///
+class CTransTable
+{
+public:
+    enum EBound : U8 { kNoBound, kUpperBound, kLowerBound, kExactBound };
+
+    static const U32    kDefaultMegaBytes = 16;
+
+    CTransTable( U32 megaBytes = kDefaultMegaBytes ) 
+        : mBuckets( megaBytes ) { mGeneration = 0; }
+
+    void resize( U32 megaBytes ) { mBuckets.resize( megaBytes ); }
+    void clear() { mBuckets.clear(); }
+
+    ///
+    /// starts a new search, so that the entries of the earlier searches
+    /// are replaced first
+    ///
+    void newSearch() { mGeneration = ( mGeneration + 1 ) & kGenerationMask; }
+
+    bool probe( YHashKey key, STransHit& rHit ) const;
+    void store( YHashKey key, CMove m, S16 score, U8 depth, EBound bound );
+    U16 getPermilleFull() const;
+    U64 getNumBuckets() const { return mBuckets.getNumBuckets(); }
+    void prefetch( YHashKey key ) const { mBuckets.prefetch( key ); }
+
+private:
+    static const U8     kGenerationMask = 0x3F;
+
+    //
+    //  The data word, from the least significant bit: move (16 bits),
+    //  score (16), depth (8), bound (2) and generation (6).
+    //
+    static U64 packData( CMove m, S16 score, U8 depth, EBound bound, U8 gen )
+    {
+        return U64( m.asU16() ) | ( U64( U16( score ) ) << 16 )
+            | ( U64( depth ) << 32 ) | ( U64( bound ) << 40 )
+            | ( U64( gen ) << 42 );
+    }
+    static CMove dataMove( U64 data ) { return CMove::fromU16( U16( data ) ); }
+    static S16 dataScore( U64 data ) { return S16( U16( data >> 16 ) ); }
+    static U8 dataDepth( U64 data ) { return U8( data >> 32 ); }
+    static EBound dataBound( U64 data ) { return EBound( ( data >> 40 ) & 3 ); }
+    static U8 dataGeneration( U64 data )
+    {
+        return U8( data >> 42 ) & kGenerationMask;
+    }
+
+    CHashBuckets    mBuckets;
+    U8              mGeneration;
+};
+
+///
+/// A cache of perft subtree node counts, keyed by the hash key and the 
+/// depth left, that the parallel perft workers share without locks.
+///
+class CPerftTable
+{
+public:
+    CPerftTable( U32 megaBytes ) : mBuckets( megaBytes ) {}
+
+    void resize( U32 megaBytes ) { mBuckets.resize( megaBytes ); }
+    void clear() { mBuckets.clear(); }
+    bool probe( YHashKey key, U16 depthLeft, U64& rNodes ) const;
+    void store( YHashKey key, U16 depthLeft, U64 nodes );
+    void prefetch( YHashKey key ) const { mBuckets.prefetch( key ); }
+
+private:
+    //
+    //  The data word is the node count in the low 56 bits, and the depth 
+    //  left in the high 8.
+    //
+    static const U64 kNodesMask = ( 1ULL << 56 ) - 1;
+
+    CHashBuckets    mBuckets;
+};
+
+#endif      // transtable.h
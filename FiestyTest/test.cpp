@@ -8,6 +8,11 @@
 #include "piece.h"
 #include "position.h"
 #include "search.h"
+#include "eval.h"
+#include "movepicker.h"
+#include "transtable.h"
+#include "gen.h"
+#include "magic.h"
 
 int          CTester::mgOkCount          = 0;
 char*        CTester::mgCurSuiteName     = nullptr;
@@ -123,7 +128,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( CPos::kStartFen, errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteStart", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -139,7 +144,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "8/8/8/8/4k3/3P4/4P3/4K3 b - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhitePawnLeft", pos.getCheckers().asStrSquares(), "d3" );
 
     //
@@ -149,7 +154,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "8/8/8/8/2k5/3P4/4P3/4K3 b - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhitePawnRight", pos.getCheckers().asStrSquares(), "d3" );
 
     //
@@ -160,7 +165,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "8/8/8/8/8/3P4/4P3/2k1K3 b - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhitePawn1stRank", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -170,7 +175,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "8/8/8/8/7k/P7/4P3/4K3 b - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhitePawnWrapLeft", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -180,7 +185,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "k7/7P/K7/8/8/8/6P1/8 b - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhitePawnWrapRight", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -196,7 +201,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k5/8/4p3/3p4/2K5/8/8/8 w - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackPawnLeft", pos.getCheckers().asStrSquares(), "d5" );
 
     //
@@ -206,7 +211,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k5/8/4p3/3p1K2/8/8/8/8 w - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackPawnRight", pos.getCheckers().asStrSquares(), "e6" );
 
     //
@@ -217,7 +222,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k1K3/8/4p3/3p4/8/8/8/8 w - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackPawn8thRank", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -227,7 +232,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k5/8/4p3/8/p7/7K/8/8 w - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackPawnWrapLeft", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -237,7 +242,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k5/8/4p3/8/8/8/7p/K7 w - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackPawnWrapRightFen", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -253,7 +258,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k5/8/1N2p3/8/8/8/7p/K7 b - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteKnight", pos.getCheckers().asStrSquares(), "b6" );
 
     //
@@ -263,7 +268,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k5/8/1n2p3/8/3K4/8/2n4p/8 w - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackKnight", pos.getCheckers().asStrSquares(), "c2" );
 
     //
@@ -274,7 +279,7 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2k5/8/1n2p3/8/3K4/8/2n4p/8 b - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteKnightNonCheck", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -290,13 +295,13 @@ void CTester::testCheck()
         bOk = pos.parseFen( "2kK4/8/1n2p3/8/8/8/2n4p/8 w - - 0 1", errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteKing", pos.getCheckers().asStrSquares(), "d8" );
 
     //
     //  Test black king check
     //
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackKing", pos.getCheckers().asStrSquares(), "c8" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -312,7 +317,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopNEFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopNE", pos.getCheckers().asStrSquares(), "a6" );
 
     //
@@ -322,7 +327,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopSEFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopSE", pos.getCheckers().asStrSquares(), "e8" );
 
     //
@@ -332,7 +337,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopSWFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopSW", pos.getCheckers().asStrSquares(), "e8" );
 
     //
@@ -342,7 +347,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopNWFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopNW", pos.getCheckers().asStrSquares(), "d7" );
 
     //
@@ -352,7 +357,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopWhiteBlockerFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishpWhiteBlocker", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -362,7 +367,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopBlackBlockerFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishpBlackBlocker", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -378,7 +383,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopNEFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopNE", pos.getCheckers().asStrSquares(), "a6" );
 
     //
@@ -388,7 +393,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopSEFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopSE", pos.getCheckers().asStrSquares(), "e8" );
 
     //
@@ -398,7 +403,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopSWFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopSW", pos.getCheckers().asStrSquares(), "e8" );
 
     //
@@ -408,7 +413,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopNWFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishopNW", pos.getCheckers().asStrSquares(), "d7" );
 
     //
@@ -418,7 +423,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopWhiteBlockerFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishpWhiteBlocker", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -428,7 +433,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteBishopBlackBlockerFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteBishpBlackBlocker", pos.getCheckers().asStrSquares(), "" );
     
 
@@ -445,7 +450,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackBishopNEFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackBishopNE", pos.getCheckers().asStrSquares(), "c2" );
 
     //
@@ -455,7 +460,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackBishopSEFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackBishopSE", pos.getCheckers().asStrSquares(), "c4" );
 
     //
@@ -465,7 +470,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackBishopSWFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackBishopSW", pos.getCheckers().asStrSquares(), "g6" );
 
     //
@@ -475,7 +480,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackBishopNWFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackBishopNW", pos.getCheckers().asStrSquares(), "h1" );
 
     //
@@ -485,7 +490,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackBishopBBFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackBishopBB", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -495,7 +500,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackBishopBBFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackBishopBB", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -512,7 +517,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteRookRank", pos.getCheckers().asStrSquares(), "a8" );
 
     //
@@ -523,7 +528,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteRookRightRank", pos.getCheckers().asStrSquares(), "g8" );
 
     //
@@ -534,7 +539,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteRookForwardFile", pos.getCheckers().asStrSquares(), "c3" );
 
     //
@@ -545,7 +550,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteRookReverseFile", pos.getCheckers().asStrSquares(), "f1" );
 
 
@@ -557,7 +562,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteRookWhiteBlocker", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -568,7 +573,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteRookBlackBlocker", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -585,7 +590,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackRookLeftRank", pos.getCheckers().asStrSquares(), "c3" );
 
     //
@@ -596,7 +601,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackRookRightRank", pos.getCheckers().asStrSquares(), "g1" );
 
     //
@@ -607,7 +612,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackRookForwardFile", pos.getCheckers().asStrSquares(), "g3" );
 
     //
@@ -618,7 +623,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackRookReverseFile", pos.getCheckers().asStrSquares(), "h8" );
 
     //
@@ -629,7 +634,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackRookWhiteBlocker", pos.getCheckers().asStrSquares(), "" );
 
     //
@@ -640,7 +645,7 @@ void CTester::testCheck()
             errorText ), true );
     if ( !bOk ) 
         std::cout << errorText << std::endl;
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackRookBlackBlocker", pos.getCheckers().asStrSquares(), "" );
 
     //////////////////////////////////////////////////////////////////////////
@@ -660,7 +665,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
      TESTEQ( "checkWhiteQueenFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteQueen", pos.getCheckers().asStrSquares(), "b4" );
 
     //
@@ -671,7 +676,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackQueenFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackQueen", pos.getCheckers().asStrSquares(), "e3" );
     
     //////////////////////////////////////////////////////////////////////////
@@ -688,7 +693,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteQueenBishopDoubleFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteQueenBishopDouble", 
         pos.getCheckers().asStrSquares(), "a2c3" );
 
@@ -700,7 +705,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkWhiteRookKnightDoubleFen", bOk, true );
-    pos.findWhiteCheckers();
+    pos.findCheckers<EColor::kWhite>();
     TESTEQ( "checkWhiteRookKnightDouble",
         pos.getCheckers().asStrSquares(), "c4d8" );
 
@@ -712,7 +717,7 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackRookBishopDoubleFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackRookBishopDouble", 
         pos.getCheckers().asStrSquares(), "a4d6" );
 
@@ -724,10 +729,62 @@ void CTester::testCheck()
     if ( !bOk ) 
         std::cout << errorText << std::endl;
     TESTEQ( "checkBlackQueenKnightDoubleFen", bOk, true );
-    pos.findBlackCheckers();
+    pos.findCheckers<EColor::kBlack>();
     TESTEQ( "checkBlackQueenKnight", 
         pos.getCheckers().asStrSquares(), "f2h4" );
 
+    //
+    //  givesCheck, direct and discovered
+    //
+    TESTEQ( "givesCheckKnightFen", pos.parseFen( 
+        "4k3/8/8/8/4N3/8/8/4R1K1 w - - 0 1", errorText ), true );
+    TESTEQ( "givesCheckDouble", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank4, EFile::kFileE ), 
+        CSqix( ERank::kRank6, EFile::kFileD ) ) ), true );
+    TESTEQ( "givesCheckDiscovered", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank4, EFile::kFileE ), 
+        CSqix( ERank::kRank3, EFile::kFileC ) ) ), true );
+    TESTEQ( "givesCheckKing", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank1, EFile::kFileG ), 
+        CSqix( ERank::kRank2, EFile::kFileG ) ) ), false );
+
+    //
+    //  A rook checks along the file it stays on, and not off it
+    //
+    TESTEQ( "givesCheckAlongLineFen", pos.parseFen( 
+        "4k3/8/8/8/8/8/4R3/6K1 w - - 0 1", errorText ), true );
+    TESTEQ( "givesCheckAlongLine", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank2, EFile::kFileE ), 
+        CSqix( ERank::kRank5, EFile::kFileE ) ) ), true );
+    TESTEQ( "givesCheckOffLine", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank2, EFile::kFileE ), 
+        CSqix( ERank::kRank2, EFile::kFileD ) ) ), false );
+
+    //
+    //  Promotions, en passant and castling
+    //
+    TESTEQ( "givesCheckPromoFen", pos.parseFen( 
+        "3k4/1P6/8/8/8/8/8/4K3 w - - 0 1", errorText ), true );
+    TESTEQ( "givesCheckPromoQ", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank7, EFile::kFileB ), 
+        CSqix( ERank::kRank8, EFile::kFileB ), EPieceType::kQueen ) ), 
+        true );
+    TESTEQ( "givesCheckPromoN", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank7, EFile::kFileB ), 
+        CSqix( ERank::kRank8, EFile::kFileB ), EPieceType::kKnight ) ), 
+        false );
+    TESTEQ( "givesCheckEpFen", pos.parseFen( 
+        "8/8/8/1R1pP2k/8/8/8/4K3 w - d6 0 1", errorText ), true );
+    TESTEQ( "givesCheckEp", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank5, EFile::kFileE ), 
+        CSqix( ERank::kRank6, EFile::kFileD ), CMove::kEnPassant ) ), 
+        true );
+    TESTEQ( "givesCheckCastleFen", pos.parseFen( 
+        "5k2/8/8/8/8/8/8/4K2R w K - 0 1", errorText ), true );
+    TESTEQ( "givesCheckCastle", pos.givesCheck( CMove( 
+        CSqix( ERank::kRank1, EFile::kFileE ), 
+        CSqix( ERank::kRank1, EFile::kFileG ), CMove::kCastle ) ), true );
+
     endSuite();
 }
 
@@ -766,6 +823,30 @@ void CTester::testMove()
     TESTEQ( "e7e8QTo",      e7e8Q.getTo().asAbbr(), "e8" );
     TESTEQ( "e7e8QPromo",   e7e8Q.getPromo().asAbbr(), "Q" );
 
+    //
+    //  The kind of move rides along in the top four bits
+    //
+    CMove e5d6( 
+        CSqix( ERank::kRank5, EFile::kFileE ),
+        CSqix( ERank::kRank6, EFile::kFileD ), 
+        CMove::kEnPassant );
+    CMove b7a8N( 
+        CSqix( ERank::kRank7, EFile::kFileB ),
+        CSqix( ERank::kRank8, EFile::kFileA ), 
+        EPieceType::kKnight, true );
+    TESTEQ( "c3c4Quiet",    c3c4.getKind(), CMove::kQuiet );
+    TESTEQ( "e7e8QKind",    e7e8Q.getKind(), CMove::kPromo );
+    TESTEQ( "e7e8QNoCap",   e7e8Q.isCapture(), false );
+    TESTEQ( "e5d6EpCap",    e5d6.isCapture(), true );
+    TESTEQ( "e5d6Ep",       e5d6.isEnPassant(), true );
+    TESTEQ( "b7a8NKind",    b7a8N.getKind(), CMove::kPromoCapture );
+    TESTEQ( "b7a8NPromo",   b7a8N.getPromo().asAbbr(), "N" );
+    TESTEQ( "b7a8NRound",   
+        CMove::fromU16( b7a8N.asU16() ) == b7a8N, true );
+    TESTEQ( "kindsDiffer",  e5d6 == CMove( 
+        CSqix( ERank::kRank5, EFile::kFileE ),
+        CSqix( ERank::kRank6, EFile::kFileD ), CMove::kCapture ), false );
+
     CMoves      moves;
     moves.addMove( c3c4 );
     moves.addMove( d3d4 );
@@ -796,10 +877,12 @@ void CTester::testMoveGen()
     //  Test white pawn pushes from the starting position
     //
     TESTEQ( "wmgFen", pos.parseFen( CPos::kStartFen, errorText ), true );
-    pos.genWhitePawnQuiets( moves );
+    pos.genPawnQuiets<EColor::kWhite>( moves );
     TESTEQ( "whitePawnQuiets", moves.asStr(), 
         "16:h2h3 g2g3 f2f3 e2e3 d2d3 c2c3 b2b3 a2a3 h2h4 g2g4 f2f4 e2e4 "
         "d2d4 c2c4 b2b4 a2a4" );
+    TESTEQ( "wpSingleKind", moves.get( 0 ).getKind(), CMove::kQuiet );
+    TESTEQ( "wpDoubleKind", moves.get( 8 ).getKind(), CMove::kDoublePush );
 
     //
     //  Test white promotions, single pushes from the non-second rank, 
@@ -808,7 +891,7 @@ void CTester::testMoveGen()
     TESTEQ( "wmgFen", pos.parseFen( 
         "8/4k2P/8/8/3p2P1/1K3p2/1P1P1P2/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhitePawnQuiets( moves );
+    pos.genPawnQuiets<EColor::kWhite>( moves );
     TESTEQ( "whitePawnQuiets2", moves.asStr(), 
         "6:h7h8=Q h7h8=R h7h8=B h7h8=N g4g5 d2d3" );
 
@@ -817,7 +900,7 @@ void CTester::testMoveGen()
     //
     TESTEQ( "bmgFen", pos.parseFen( CPos::kStartFen, errorText ), true );
     moves.reset();
-    pos.genBlackPawnQuiets( moves );
+    pos.genPawnQuiets<EColor::kBlack>( moves );
     TESTEQ( "blackPawnQuiets", moves.asStr(), 
         "16:a7a6 b7b6 c7c6 d7d6 e7e6 f7f6 g7g6 h7h6 a7a5 b7b5 c7c5 d7d5 "
         "e7e5 f7f5 g7g5 h7h5" );
@@ -829,7 +912,7 @@ void CTester::testMoveGen()
     TESTEQ( "bmgFen", pos.parseFen( 
         "4k3/p7/8/K2p1p2/3P4/8/7p/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackPawnQuiets( moves );
+    pos.genPawnQuiets<EColor::kBlack>( moves );
     TESTEQ( "blackPawnQuiets2", moves.asStr(), 
         "6:h2h1=Q h2h1=R h2h1=B h2h1=N f5f4 a7a6" );
 
@@ -840,10 +923,14 @@ void CTester::testMoveGen()
         "r1b1k3/1P6/p5pp/2Pp1pPP/4p3/1p1P1P1p/P7/4K3 w - f6 0 1", 
         errorText ), true );
     moves.reset();
-    pos.genWhitePawnCaptures( moves );
+    pos.genPawnCaptures<EColor::kWhite>( moves );
     TESTEQ( "whitePawnCaptures", moves.asStr(), 
         "14:b7c8=Q b7c8=R b7c8=B b7c8=N b7a8=Q b7a8=R b7a8=B b7a8=N g5h6 "
         "h5g6 g5f6 d3e4 f3e4 a2b3" );
+    TESTEQ( "wpCapPromoKind", moves.get( 0 ).getKind(), 
+        CMove::kPromoCapture );
+    TESTEQ( "wpCapKind", moves.get( 9 ).getKind(), CMove::kCapture );
+    TESTEQ( "wpCapEpKind", moves.get( 10 ).getKind(), CMove::kEnPassant );
 
     //
     //  Test black pawn captures.
@@ -852,7 +939,7 @@ void CTester::testMoveGen()
         "8/8/2p1p3/1P1P4/Pp6/8/5p2/K3R1Q1 b - a3 0 1", 
         errorText ), true );
     moves.reset();
-    pos.genBlackPawnCaptures( moves );
+    pos.genPawnCaptures<EColor::kBlack>( moves );
     TESTEQ( "blackPawnCaptures", moves.asStr(), 
         "12:f2e1=Q f2e1=R f2e1=B f2e1=N f2g1=Q f2g1=R f2g1=B f2g1=N b4a3 "
         "c6b5 c6d5 e6d5" );
@@ -864,7 +951,7 @@ void CTester::testMoveGen()
         "N6N/1N4N1/8/3N4/8/8/1N4N1/N6N w - - 0 1", 
         errorText ), true );
     moves.reset();
-    pos.genWhiteKnightQuiets( moves );
+    pos.genKnightQuiets<EColor::kWhite>( moves );
     TESTEQ( "whiteKnightQuiets", moves.asStr(), 
         "32:h8f7 h8g6 a8c7 a8b6 g7e8 g7e6 g7h5 g7f5 b7d8 b7d6 b7c5 b7a5 "
         "d5e7 d5c7 d5f6 d5b6 d5f4 d5b4 d5e3 d5c3 g2h4 g2f4 g2e3 g2e1 b2c4 "
@@ -876,7 +963,7 @@ void CTester::testMoveGen()
     TESTEQ( "gwkFen", pos.parseFen( 
         "8/8/3P1p2/8/4N3/3p4/5p2/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteKnightCaptures( moves );
+    pos.genKnightCaptures<EColor::kWhite>( moves );
     TESTEQ( "whiteKnightCaptures", moves.asStr(), "2:e4f6 e4f2" );
 
     //
@@ -886,7 +973,7 @@ void CTester::testMoveGen()
         "n6n/1n4n1/8/3n4/8/8/1n4n1/n6n b - - 0 1", 
         errorText ), true );
     moves.reset();
-    pos.genBlackKnightQuiets( moves );
+    pos.genKnightQuiets<EColor::kBlack>( moves );
     TESTEQ( "bnqMoves", moves.asStr(), 
         "32:a1c2 a1b3 h1f2 h1g3 b2d1 b2d3 b2a4 b2c4 g2e1 g2e3 g2f4 g2h4 "
         "d5c3 d5e3 d5b4 d5f4 d5b6 d5f6 d5c7 d5e7 b7a5 b7c5 b7d6 b7d8 g7f5 "
@@ -898,7 +985,7 @@ void CTester::testMoveGen()
     TESTEQ( "gbkFen", pos.parseFen( 
         "8/8/3p1P2/8/4n3/3P4/5P2/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackKnightCaptures( moves );
+    pos.genKnightCaptures<EColor::kBlack>( moves );
     TESTEQ( "blackKnightCaptures", moves.asStr(), "2:e4f2 e4f6" );
 
     //
@@ -907,7 +994,7 @@ void CTester::testMoveGen()
     TESTEQ( "whiteRookQuietsFen", pos.parseFen( 
         "R6R/8/3p4/3R4/4R3/8/3R4/R6R w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteRookQuiets( moves );
+    pos.genRookQuiets<EColor::kWhite>( moves );
     TESTEQ( "whiteRookQuiets", moves.asStr(), 
         "81:h8g8 h8f8 h8e8 h8d8 h8c8 h8b8 h8h7 h8h6 h8h5 h8h4 h8h3 h8h2 "
         "a8g8 a8f8 a8e8 a8d8 a8c8 a8b8 a8a7 a8a6 a8a5 a8a4 a8a3 a8a2 d5h5 "
@@ -923,7 +1010,7 @@ void CTester::testMoveGen()
     TESTEQ( "whiteRookCapturesFen", pos.parseFen( 
         "8/8/2pp4/p1RP4/1R6/nP1RP1n1/2pP4/3q4 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteRookCaptures( moves );
+    pos.genRookCaptures<EColor::kWhite>( moves );
     TESTEQ( "whiteRookCaptures", moves.asStr(), "3:c5c6 c5a5 c5c2" );
 
     //
@@ -932,7 +1019,7 @@ void CTester::testMoveGen()
     TESTEQ( "blackRookQuietsFen", pos.parseFen( 
         "8/2P5/8/8/2r5/8/2r2p2/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackRookQuiets( moves );
+    pos.genRookQuiets<EColor::kBlack>( moves );
     TESTEQ( "blackRookQuiets", moves.asStr(), 
         "16:c2c1 c2a2 c2b2 c2d2 c2e2 c2c3 c4c3 c4a4 c4b4 c4d4 c4e4 c4f4 "
         "c4g4 c4h4 c4c5 c4c6" );
@@ -943,7 +1030,7 @@ void CTester::testMoveGen()
     TESTEQ( "blackRookCapturesFen", pos.parseFen( 
         "8/8/3P4/3p4/Pr1r2P1/8/8/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackRookCaptures( moves );
+    pos.genRookCaptures<EColor::kBlack>( moves );
     TESTEQ( "blackRookCaptures", moves.asStr(), "2:b4a4 d4g4" );
 
     //
@@ -952,7 +1039,7 @@ void CTester::testMoveGen()
     TESTEQ( "whiteBishopQuietsFen", pos.parseFen( 
         "8/8/3pp3/p6P/1B1B2B1/P6P/3PP3/7B w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteBishopQuiets( moves );
+    pos.genBishopQuiets<EColor::kWhite>( moves );
     TESTEQ( "whiteBishopQuiets", moves.asStr(), 
         "24:g4f5 g4f3 d4h8 d4g7 d4a7 d4f6 d4b6 d4e5 d4c5 d4e3 d4c3 d4f2 "
         "d4b2 d4g1 d4a1 b4c5 b4c3 h1a8 h1b7 h1c6 h1d5 h1e4 h1f3 h1g2" );
@@ -963,9 +1050,9 @@ void CTester::testMoveGen()
     TESTEQ( "whiteBishopCapturesFen", pos.parseFen( 
         "r7/1P4pp/1p4P1/8/3BB3/2pP1P2/2p2pp1/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteBishopCaptures( moves );
+    pos.genBishopCaptures<EColor::kWhite>( moves );
     TESTEQ( "whiteBishopCaptures", moves.asStr(), 
-        "4:d4g7 d4b6 d4f2 d4c3" );
+        "4:d4g7 d4b6 d4c3 d4f2" );
 
     //
     //  Test black bishop quiets
@@ -973,7 +1060,7 @@ void CTester::testMoveGen()
     TESTEQ( "blackBishopQuietsFen", pos.parseFen( 
         "8/p7/5P2/3b4/3b4/4p3/1p6/8 b - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackBishopQuiets( moves );
+    pos.genBishopQuiets<EColor::kBlack>( moves );
     TESTEQ( "blackBishopQuiets", moves.asStr(), 
         "17:d4c3 d4c5 d4e5 d4b6 d5h1 d5a2 d5g2 d5b3 d5f3 d5c4 d5e4 d5c6 "
         "d5e6 d5b7 d5f7 d5a8 d5g8" );
@@ -984,9 +1071,9 @@ void CTester::testMoveGen()
     TESTEQ( "blackBishopCapturesFen", pos.parseFen( 
         "N3N3/1pPp2P1/2b5/1p2b3/N3p3/5N2/1P5P/8 b - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackBishopCaptures( moves );
+    pos.genBishopCaptures<EColor::kBlack>( moves );
     TESTEQ( "blackBishopCaptures", moves.asStr(), 
-        "4:e5g7 e5c7 e5h2 e5b2" );
+        "4:e5b2 e5h2 e5c7 e5g7" );
 
     //
     //  Test white queen quiets
@@ -994,7 +1081,7 @@ void CTester::testMoveGen()
     TESTEQ( "whiteQueenQuietsFen", pos.parseFen( 
         "8/4p3/8/4Q3/8/4P1P1/1P6/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteQueenQuiets( moves );
+    pos.genQueenQuiets<EColor::kWhite>( moves );
     TESTEQ( "whiteQueenQuiets", moves.asStr(), 
         "18:e5e6 e5h5 e5g5 e5f5 e5d5 e5c5 e5b5 e5a5 e5e4 e5h8 e5b8 e5g7 "
         "e5c7 e5f6 e5d6 e5f4 e5d4 e5c3" );
@@ -1005,7 +1092,7 @@ void CTester::testMoveGen()
     TESTEQ( "whiteQueenCapturesFen", pos.parseFen( 
         "8/4p3/8/4Q3/8/4P1P1/1P6/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteQueenCaptures( moves );
+    pos.genQueenCaptures<EColor::kWhite>( moves );
     TESTEQ( "whiteQueenCaptures", moves.asStr(), "1:e5e7" );
 
     //
@@ -1014,7 +1101,7 @@ void CTester::testMoveGen()
     TESTEQ( "blackQueenQuietsFen", pos.parseFen( 
         "8/3p4/5p2/8/3q4/4P3/1P6/8 b - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackQueenQuiets( moves );
+    pos.genQueenQuiets<EColor::kBlack>( moves );
     TESTEQ( "blackQueenQuiets", moves.asStr(), 
         "17:d4d1 d4d2 d4d3 d4a4 d4b4 d4c4 d4e4 d4f4 d4g4 d4h4 d4d5 d4d6 "
         "d4c3 d4c5 d4e5 d4b6 d4a7" );
@@ -1025,8 +1112,8 @@ void CTester::testMoveGen()
     TESTEQ( "blackQueenCapturesFen", pos.parseFen( 
         "8/3p4/5p2/8/3q4/4P3/1P6/8 b - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackQueenCaptures( moves );
-    TESTEQ( "blackQueenCaptures", moves.asStr(), "2:d4e3 d4b2" );
+    pos.genQueenCaptures<EColor::kBlack>( moves );
+    TESTEQ( "blackQueenCaptures", moves.asStr(), "2:d4b2 d4e3" );
 
     //
     //  Test white king quiets
@@ -1034,7 +1121,7 @@ void CTester::testMoveGen()
     TESTEQ( "whiteKingQuietsFen", pos.parseFen( 
         "8/8/8/4P3/3K4/8/8/8 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteKingQuiets( moves );
+    pos.genKingQuiets<EColor::kWhite>( moves );
     TESTEQ( "whiteKingQuiets", moves.asStr(), 
         "7:d4d5 d4c5 d4e4 d4c4 d4e3 d4d3 d4c3" );
 
@@ -1044,7 +1131,7 @@ void CTester::testMoveGen()
     TESTEQ( "whiteKingCapturesFen", pos.parseFen( 
         "8/8/8/8/8/8/4p3/4Kq2 w - - 0 1", errorText ), true );
     moves.reset();
-    pos.genWhiteKingCaptures( moves );
+    pos.genKingCaptures<EColor::kWhite>( moves );
     TESTEQ( "whiteKingCaptures", moves.asStr(), "2:e1e2 e1f1" );
 
     //
@@ -1053,7 +1140,7 @@ void CTester::testMoveGen()
     TESTEQ( "blackKingQuietsFen", pos.parseFen( 
         "8/8/8/8/8/8/pp6/1k6 b - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackKingQuiets( moves );
+    pos.genKingQuiets<EColor::kBlack>( moves );
     TESTEQ( "blackKingQuiets", moves.asStr(), 
         "3:b1a1 b1c1 b1c2" );
 
@@ -1063,12 +1150,547 @@ void CTester::testMoveGen()
     TESTEQ( "blackKingCapturesFen", pos.parseFen( 
         "6R1/5ppk/6Pp/8/8/8/8/8 b - - 0 1", errorText ), true );
     moves.reset();
-    pos.genBlackKingCaptures( moves );
+    pos.genKingCaptures<EColor::kBlack>( moves );
     TESTEQ( "blackKingCaptures", moves.asStr(), "2:h7g6 h7g8" );
 
     endSuite();
 }
 
+///
+/// Tests the legal move generator on checks, pins and en passant
+///
+void CTester::testLegalMoves()
+{
+    beginSuite( "testLegalMoves" );
+
+    CMoves          moves;
+    CPos            pos;
+    std::string     errorText;
+
+    //
+    //  En passant would expose the king along the rank
+    //
+    TESTEQ( "epDiscoveredCheckFen", pos.parseFen( 
+        "8/8/8/KPp4r/8/8/8/7k w - c6 0 1", errorText ), true );
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "epDiscoveredCheck", moves.asStr(), 
+        "4:a5b6 a5a6 a5a4 b5b6" );
+
+    //
+    //  En passant captures the pawn that is giving check
+    //
+    TESTEQ( "epCapturesCheckerFen", pos.parseFen( 
+        "8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1", errorText ), true );
+    moves.reset();
+    pos.genLegalMoves<EColor::kBlack>( moves );
+    TESTEQ( "epCapturesChecker", moves.asStr(), 
+        "9:c5b4 c5c4 c5d4 c5b5 c5d5 c5b6 c5c6 c5d6 e4d3" );
+    TESTEQ( "epCapturesCheckerCheckers", 
+        pos.getCheckers().asStrSquares(), "d4" );
+
+    //
+    //  Only the king may move out of a double check, and not along the 
+    //  checking rank.
+    //
+    TESTEQ( "doubleCheckFen", pos.parseFen( 
+        "4k3/8/8/8/8/3n4/8/R3K2r w - - 0 1", errorText ), true );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "doubleCheck", moves.asStr(), "2:e1e2 e1d2" );
+    TESTEQ( "doubleCheckCheckers", 
+        pos.getCheckers().asStrSquares(), "h1d3" );
+
+    //
+    //  A pinned knight can't block a check
+    //
+    TESTEQ( "pinnedKnightFen", pos.parseFen( 
+        "4k3/4r3/8/8/1b6/8/3N4/4K3 w - - 0 1", errorText ), true );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "pinnedKnight", moves.asStr(), "3:e1f2 e1f1 e1d1" );
+
+    //
+    //  A pinned rook may move along the pin
+    //
+    TESTEQ( "pinnedRookFen", pos.parseFen( 
+        "4k3/4r3/8/8/8/8/4R3/4K3 w - - 0 1", errorText ), true );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "pinnedRook", moves.asStr(), 
+        "9:e1f2 e1d2 e1f1 e1d1 e2e7 e2e6 e2e5 e2e4 e2e3" );
+
+    //
+    //  The king may capture an unprotected attacker but not step onto its
+    //  lines.
+    //
+    TESTEQ( "kingDangerFen", pos.parseFen( 
+        "4k3/8/8/8/8/8/3r4/R3K3 w - - 0 1", errorText ), true );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "kingDanger", moves.asStr(), 
+        "12:e1d2 e1f1 a1a8 a1a7 a1a6 a1a5 a1a4 a1a3 a1a2 a1d1 a1c1 a1b1" );
+
+    //
+    //  Evasions block or capture the checking rook, but the knight pinned by
+    //  the bishop can't block on e4.
+    //
+    TESTEQ( "evasionsFen", pos.parseFen( 
+        "4r1k1/8/8/8/1bB5/8/3N4/4K2R w - - 0 1", errorText ), true );
+    moves.reset();
+    pos.findCheckers<EColor::kBlack>();
+    pos.genEvasions<EColor::kWhite>( moves );
+    TESTEQ( "evasions", moves.asStr(), "5:e1f2 e1f1 e1d1 c4e6 c4e2" );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "evasionsLegal", moves.asStr(), "5:e1f2 e1f1 e1d1 c4e6 c4e2" );
+
+    //
+    //  Castling needs the squares between king and rook empty, and only 
+    //  the squares the king crosses safe: an attack on b1 doesn't stop 
+    //  the long castle, but one on f1 stops the short one.
+    //
+    TESTEQ( "castleBothFen", pos.parseFen( 
+        "1r5k/8/8/8/8/8/8/R3K2R w KQ - 0 1", errorText ), true );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "castleBothOO", moves.asStr().find( "e1g1" ) 
+        != std::string::npos, true );
+    TESTEQ( "castleBothOOO", moves.asStr().find( "e1c1" ) 
+        != std::string::npos, true );
+    TESTEQ( "castleAttackedFen", pos.parseFen( 
+        "5r1k/8/8/8/8/8/8/RN2K2R w KQ - 0 1", errorText ), true );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "castleAttackedOO", moves.asStr().find( "e1g1" ), 
+        std::string::npos );
+    TESTEQ( "castleBlockedOOO", moves.asStr().find( "e1c1" ), 
+        std::string::npos );
+    moves.reset();
+    pos.genMoves<EColor::kWhite>( moves );
+    TESTEQ( "castlePseudoLegal", moves.asStr().find( "e1g1" ), 
+        std::string::npos );
+
+    //
+    //  Castling moves the rook too, and unmaking it puts both back
+    //
+    TESTEQ( "castleMakeFen", pos.parseFen( 
+        "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1", errorText ), true );
+    std::string sFen = pos.asFen();
+    CMove e8c8( CSqix( ERank::kRank8, EFile::kFileE ), 
+        CSqix( ERank::kRank8, EFile::kFileC ), CMove::kCastle );
+    TESTEQ( "castlePseudoLegalMove", pos.isPseudoLegal( e8c8 ), true );
+    pos.makeMove( e8c8 );
+    TESTEQ( "castleMake", pos.asFen().substr( 0, 25 ), 
+        "2kr3r/8/8/8/8/8/8/R3K2R w" );
+    TESTEQ( "castleMakeRights", pos.asFen().find( " KQ - " ) 
+        != std::string::npos, true );
+    TESTEQ( "castleMakeHash", pos.getHashKey(), pos.computeHashKey() );
+    pos.unmakeMove( e8c8 );
+    TESTEQ( "castleUnmake", pos.asFen(), sFen );
+
+    //
+    //  Rights with no rook in the corner, or the king off its square, are 
+    //  dropped when the fen is read, so no castle is generated from them
+    //
+    TESTEQ( "castleNoRookFen", pos.parseFen( 
+        "4k3/8/8/8/8/8/8/4K3 w K - 0 1", errorText ), true );
+    TESTEQ( "castleNoRookRights", pos.asFen(), 
+        "4k3/8/8/8/8/8/8/4K3 w - - 0 1" );
+    moves.reset();
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    TESTEQ( "castleNoRook", moves.asStr().find( "e1g1" ), std::string::npos );
+    pos.parseFen( "r3k1r1/8/8/8/8/8/8/R4K1R w KQkq - 0 1", errorText );
+    TESTEQ( "castleOffSquareRights", pos.asFen(), 
+        "r3k1r1/8/8/8/8/8/8/R4K1R w q - 0 1" );
+
+
+    endSuite();
+}
+
+///
+/// Tests the static exchange evaluation
+///
+void CTester::testSee()
+{
+    beginSuite( "testSee" );
+
+    CPos            pos;
+    std::string     errorText;
+
+    //
+    //  An undefended pawn
+    //
+    TESTEQ( "seeFreePawnFen", pos.parseFen( 
+        "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", errorText ), 
+        true );
+    CMove e1e5( CSqix( ERank::kRank1, EFile::kFileE ), 
+        CSqix( ERank::kRank5, EFile::kFileE ), CMove::kCapture );
+    TESTEQ( "seeFreePawn", pos.see( e1e5 ), 100 );
+    TESTEQ( "seeFreePawnGE", pos.seeGE( e1e5, 100 ), true );
+    TESTEQ( "seeFreePawnNotGE", pos.seeGE( e1e5, 101 ), false );
+
+    //
+    //  The black queen joins in behind the bishop, so the knight loses 
+    //  itself for the pawn
+    //
+    TESTEQ( "seeXrayFen", pos.parseFen( 
+        "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", 
+        errorText ), true );
+    CMove d3e5( CSqix( ERank::kRank3, EFile::kFileD ), 
+        CSqix( ERank::kRank5, EFile::kFileE ), CMove::kCapture );
+    TESTEQ( "seeXray", pos.see( d3e5 ), -220 );
+    TESTEQ( "seeXrayGE", pos.seeGE( d3e5, 0 ), false );
+    TESTEQ( "seeXrayLoses", pos.seeGE( d3e5, -220 ), true );
+    TESTEQ( "seeXrayUnchanged", pos.asFen(), 
+        "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1" );
+
+    //
+    //  A promotion counts what the pawn becomes, and a king recaptures an
+    //  undefended piece
+    //
+    TESTEQ( "seePromoFen", pos.parseFen( 
+        "4k3/8/8/8/8/8/1p6/RK6 b - - 0 1", errorText ), true );
+    TESTEQ( "seePromo", pos.see( CMove( 
+        CSqix( ERank::kRank2, EFile::kFileB ), 
+        CSqix( ERank::kRank1, EFile::kFileA ), 
+        EPieceType::kQueen, true ) ), 400 );
+
+    //
+    //  The king can't recapture a defended piece
+    //
+    TESTEQ( "seeKingFen", pos.parseFen( 
+        "4k3/8/8/8/8/r7/1p6/RK6 b - - 0 1", errorText ), true );
+    TESTEQ( "seeKing", pos.see( CMove( 
+        CSqix( ERank::kRank2, EFile::kFileB ), 
+        CSqix( ERank::kRank1, EFile::kFileA ), 
+        EPieceType::kQueen, true ) ), 1300 );
+
+    endSuite();
+}
+
+///
+/// Tests the staged move picker
+///
+void CTester::testMovePicker()
+{
+    beginSuite( "testMovePicker" );
+
+    CPos            pos;
+    CMoveHistory    history;
+    CMoves          moves;
+    CMove           m;
+    std::string     errorText;
+
+    //
+    //  b3xc4 wins the queen, e4xd5 trades pawns and Qxd5 loses the queen
+    //  to c6xd5.
+    //
+    TESTEQ( "pickerFen", pos.parseFen( 
+        "4k3/8/2p5/3p4/2q1P3/1P6/8/3QK3 w - - 0 1", errorText ), true );
+    CMove prevMove( CSqix( ERank::kRank7, EFile::kFileC ), 
+        CSqix( ERank::kRank6, EFile::kFileC ) );
+    CMove killer( CSqix( ERank::kRank4, EFile::kFileE ), 
+        CSqix( ERank::kRank5, EFile::kFileE ) );
+    CMove counter( CSqix( ERank::kRank1, EFile::kFileD ), 
+        CSqix( ERank::kRank3, EFile::kFileD ) );
+    CMove hashMove( CSqix( ERank::kRank1, EFile::kFileE ), 
+        CSqix( ERank::kRank2, EFile::kFileF ) );
+    history.onCutoff( pos, killer, CMove::null(), 0, 2 );
+    history.onCutoff( pos, counter, prevMove, 1, 2 );
+    history.onCutoff( pos, CMove( CSqix( ERank::kRank1, EFile::kFileD ), 
+        CSqix( ERank::kRank5, EFile::kFileH ) ), CMove::null(), 1, 8 );
+    TESTEQ( "pickerKiller", history.getKiller( 0, 0 ).asStr(), "e4e5" );
+
+    CMovePicker picker( pos, history, hashMove, 0, prevMove );
+    TESTEQ( "pickerLazy", picker.getStage(), CMovePicker::kHashMove );
+    picker.next( m );
+    TESTEQ( "pickerHash", m.asStr(), "e1f2" );
+    TESTEQ( "pickerHashOnly", picker.getStage(), CMovePicker::kGenCaptures );
+    picker.next( m );
+    TESTEQ( "pickerWinning1", m.asStr(), "b3c4" );
+    picker.next( m );
+    TESTEQ( "pickerWinning2", m.asStr(), "e4d5" );
+    picker.next( m );
+    TESTEQ( "pickerKiller1", m.asStr(), "e4e5" );
+    TESTEQ( "pickerNoQuietsYet", picker.getStage(), CMovePicker::kKiller2 );
+    picker.next( m );
+    TESTEQ( "pickerCounter", m.asStr(), "d1d3" );
+    picker.next( m );
+    TESTEQ( "pickerHistory", m.asStr(), "d1h5" );
+
+    //
+    //  Every pseudo-legal move comes out exactly once, the losing capture
+    //  last.
+    //
+    pos.genMoves<EColor::kWhite>( moves );
+    U16 numPicked = 6;
+    std::string sPicked;
+    while ( picker.next( m ) )
+    {
+        numPicked++;
+        sPicked += m.asStr() + " ";
+    }
+    TESTEQ( "pickerCount", numPicked, moves.getNumMoves() );
+    TESTEQ( "pickerLosing", m.asStr(), "d1d5" );
+    TESTEQ( "pickerNoDups", sPicked.find( "e1f2" ), std::string::npos );
+    TESTEQ( "pickerDone", picker.next( m ), false );
+
+    //
+    //  A hash move that doesn't fit the position is skipped
+    //
+    CMovePicker badHashPicker( pos, history, CMove( 
+        CSqix( ERank::kRank2, EFile::kFileA ), 
+        CSqix( ERank::kRank4, EFile::kFileA ) ), 0, CMove::null() );
+    badHashPicker.next( m );
+    TESTEQ( "pickerBadHash", m.asStr(), "b3c4" );
+
+    //
+    //  So is one whose kind doesn't fit, here a capture stored as quiet
+    //
+    CMovePicker badKindPicker( pos, history, CMove( 
+        CSqix( ERank::kRank3, EFile::kFileB ), 
+        CSqix( ERank::kRank4, EFile::kFileC ) ), 0, CMove::null() );
+    badKindPicker.next( m );
+    TESTEQ( "pickerBadKind", m.isCapture(), true );
+
+    //
+    //  The quiescence picker hands out neither quiet moves, not even as 
+    //  the hash move, nor the losing capture
+    //
+    CMovePicker capturesPicker( pos, history, hashMove );
+    sPicked.clear();
+    while ( capturesPicker.next( m ) )
+        sPicked += m.asStr() + " ";
+    TESTEQ( "pickerCapturesOnly", sPicked, "b3c4 e4d5 " );
+
+    //
+    //  In check only the evasions come out, capturing the checker first
+    //
+    TESTEQ( "pickerEvasionsFen", pos.parseFen( 
+        "4k3/8/8/8/8/5n2/3PP3/1R2K3 w - - 0 1", errorText ), true );
+    CMovePicker evasionPicker( pos, history, CMove::null(), 0, CMove::null() );
+    sPicked.clear();
+    while ( evasionPicker.next( m ) )
+        sPicked += m.asStr() + " ";
+    TESTEQ( "pickerEvasions", sPicked, "e2f3 e1f1 e1d1 e1f2 " );
+
+    endSuite();
+}
+
+///
+/// Tests the transposition table
+///
+void CTester::testTransTable()
+{
+    beginSuite( "testTransTable" );
+
+    CTransTable     table( 1 );
+    STransHit       hit;
+    CMove           e2e4( CSqix( ERank::kRank2, EFile::kFileE ), 
+                        CSqix( ERank::kRank4, EFile::kFileE ) );
+    CMove           promo( CSqix( ERank::kRank7, EFile::kFileA ), 
+                        CSqix( ERank::kRank8, EFile::kFileB ), 
+                        EPieceType::kKnight );
+
+    TESTEQ( "ttBuckets", table.getNumBuckets(), 16384 );
+    TESTEQ( "ttMoveRoundTrip", CMove::fromU16( promo.asU16() ).asStr(), 
+        "a7b8=N" );
+    TESTEQ( "ttEmpty", table.probe( 0x1234ULL, hit ), false );
+    TESTEQ( "ttEmptyZero", table.probe( 0ULL, hit ), false );
+
+    table.store( 0x1234ULL, e2e4, -57, 5, CTransTable::kLowerBound );
+    TESTEQ( "ttHit", table.probe( 0x1234ULL, hit ), true );
+    TESTEQ( "ttHitMove", hit.mMove.asStr(), "e2e4" );
+    TESTEQ( "ttHitScore", hit.mScore, -57 );
+    TESTEQ( "ttHitDepth", hit.mDepth, 5 );
+    TESTEQ( "ttHitBound", hit.mBound, CTransTable::kLowerBound );
+    TESTEQ( "ttOtherKey", table.probe( 0x5234ULL, hit ), false );
+
+    //
+    //  Storing again without a move keeps the old move
+    //
+    table.store( 0x1234ULL, CMove::null(), 12, 6, CTransTable::kExactBound );
+    table.probe( 0x1234ULL, hit );
+    TESTEQ( "ttKeepMove", hit.mMove.asStr(), "e2e4" );
+    TESTEQ( "ttUpdatedScore", hit.mScore, 12 );
+
+    //
+    //  A shallower bound for the same position doesn't replace a deeper 
+    //  one from this search, but an exact score does
+    //
+    table.store( 0x4321ULL, e2e4, 35, 8, CTransTable::kLowerBound );
+    table.store( 0x4321ULL, CMove::null(), -20, 0, 
+        CTransTable::kUpperBound );
+    table.probe( 0x4321ULL, hit );
+    TESTEQ( "ttDeeperKept", hit.mDepth, 8 );
+    TESTEQ( "ttDeeperKeptScore", hit.mScore, 35 );
+    TESTEQ( "ttDeeperKeptBound", hit.mBound, CTransTable::kLowerBound );
+    table.store( 0x4321ULL, CMove::null(), 40, 0, CTransTable::kExactBound );
+    table.probe( 0x4321ULL, hit );
+    TESTEQ( "ttExactReplaces", hit.mDepth, 0 );
+    TESTEQ( "ttExactKeepsMove", hit.mMove.asStr(), "e2e4" );
+
+    //
+    //  Fill the bucket with deeper entries, then the shallowest goes first
+    //
+    U64 kBucketStride = table.getNumBuckets();
+    table.store( 0x1234ULL + kBucketStride, e2e4, 0, 9, 
+        CTransTable::kExactBound );
+    table.store( 0x1234ULL + 2 * kBucketStride, e2e4, 0, 3, 
+        CTransTable::kExactBound );
+    table.store( 0x1234ULL + 3 * kBucketStride, e2e4, 0, 8, 
+        CTransTable::kExactBound );
+    table.store( 0x1234ULL + 4 * kBucketStride, e2e4, 0, 7, 
+        CTransTable::kExactBound );
+    TESTEQ( "ttShallowReplaced", 
+        table.probe( 0x1234ULL + 2 * kBucketStride, hit ), false );
+    TESTEQ( "ttDeepKept", table.probe( 0x1234ULL, hit ), true );
+
+    //
+    //  After a new search the old entries give way to a new shallow one,
+    //  the shallowest of them first.
+    //
+    table.newSearch();
+    table.store( 0x1234ULL + 5 * kBucketStride, e2e4, 0, 1, 
+        CTransTable::kExactBound );
+    TESTEQ( "ttOldReplaced", table.probe( 0x1234ULL, hit ), false );
+    TESTEQ( "ttNewKept", table.probe( 0x1234ULL + 5 * kBucketStride, hit ), 
+        true );
+
+    //
+    //  Resizing empties the table
+    //
+    table.resize( 2 );
+    TESTEQ( "ttResized", table.getNumBuckets(), 32768 );
+    TESTEQ( "ttResizedEmpty", table.probe( 0x1234ULL, hit ), false );
+
+    endSuite();
+}
+
+///
+/// Tests the compile time generated tables
+///
+void CTester::testGen()
+{
+    beginSuite( "testGen" );
+
+    CSqix a1( ERank::kRank1, EFile::kFileA );
+    CSqix d4( ERank::kRank4, EFile::kFileD );
+    CSqix g7( ERank::kRank7, EFile::kFileG );
+    CSqix h8( ERank::kRank8, EFile::kFileH );
+    CSqix d8( ERank::kRank8, EFile::kFileD );
+    CSqix e6( ERank::kRank6, EFile::kFileE );
+
+    TESTEQ( "knightAttacksA1", 
+        CBitBoard( CGen::mbbKnightAttacks[a1.get()] ).asStrSquares(), 
+        "c2b3" );
+    TESTEQ( "kingAttacksA1", 
+        CBitBoard( CGen::mbbKingAttacks[a1.get()] ).asStrSquares(), 
+        "b1a2b2" );
+    TESTEQ( "whitePawnAttacksD4", CBitBoard( 
+        CGen::mbbPawnAttacks[U8( EColor::kWhite )][d4.get()] ).asStrSquares(), 
+        "c5e5" );
+    TESTEQ( "blackPawnAttacksD4", CBitBoard( 
+        CGen::mbbPawnAttacks[U8( EColor::kBlack )][d4.get()] ).asStrSquares(), 
+        "c3e3" );
+    TESTEQ( "betweenA1H8", 
+        CBitBoard( CGen::mbbBetween[a1.get()][h8.get()] ).asStrSquares(), 
+        "b2c3d4e5f6g7" );
+    TESTEQ( "betweenH8A1", CGen::mbbBetween[h8.get()][a1.get()],
+        CGen::mbbBetween[a1.get()][h8.get()] );
+    TESTEQ( "betweenD4D8", 
+        CBitBoard( CGen::mbbBetween[d4.get()][d8.get()] ).asStrSquares(), 
+        "d5d6d7" );
+    TESTEQ( "betweenG7H8", CGen::mbbBetween[g7.get()][h8.get()], 0ULL );
+    TESTEQ( "betweenD4E6", CGen::mbbBetween[d4.get()][e6.get()], 0ULL );
+    TESTEQ( "lineD4G7", 
+        CBitBoard( CGen::mbbLine[d4.get()][g7.get()] ).asStrSquares(), 
+        "a1b2c3d4e5f6g7h8" );
+    TESTEQ( "lineD4E6", CGen::mbbLine[d4.get()][e6.get()], 0ULL );
+    TESTEQ( "distanceA1H8", int( CGen::mDistance[a1.get()][h8.get()] ), 7 );
+    TESTEQ( "distanceD4E6", int( CGen::mDistance[d4.get()][e6.get()] ), 2 );
+    TESTEQ( "distanceD4D4", int( CGen::mDistance[d4.get()][d4.get()] ), 0 );
+
+    endSuite();
+}
+
+///
+/// tests the slider attacks of each backend against the ray walking attacks
+///
+void CTester::testMagic()
+{
+    beginSuite( "testMagic" );
+
+    ESliderBackend defaultBackend = CMagic::getBackend();
+    TESTEQ( "defaultBackend", CMagic::backendAsStr( defaultBackend ), 
+        std::string( CMagic::hasFastPext() ? "pext" : "magic" ) );
+    TESTEQ( "fastPextHasBmi2", 
+        !CMagic::hasFastPext() || CMagic::hasBmi2(), true );
+
+    for ( U8 b = 0; b < U8( ESliderBackend::kNum ); b++ )
+    {
+        ESliderBackend backend = ESliderBackend( b );
+        if ( backend == ESliderBackend::kPext && !CMagic::hasBmi2() )
+            continue;
+        CMagic::setBackend( backend );
+        TESTEQ( "setBackend", CMagic::backendAsStr( CMagic::getBackend() ),
+            CMagic::backendAsStr( backend ) );
+
+        //
+        //  Spot check a rook and a bishop with blockers on every ray.
+        //
+        CSqix d4( ERank::kRank4, EFile::kFileD );
+        CBitBoard bbOccupied( 0ULL );
+        bbOccupied.setSquare( CSqix( ERank::kRank6, EFile::kFileD ).get() );
+        bbOccupied.setSquare( CSqix( ERank::kRank4, EFile::kFileB ).get() );
+        bbOccupied.setSquare( CSqix( ERank::kRank2, EFile::kFileF ).get() );
+        bbOccupied.setSquare( CSqix( ERank::kRank7, EFile::kFileA ).get() );
+        TESTEQ( "rookAttacksD4", 
+            CMagic::rookAttacks( d4, bbOccupied ).asStrSquares(), 
+            "d1d2d3b4c4e4f4g4h4d5d6" );
+        TESTEQ( "bishopAttacksD4", 
+            CMagic::bishopAttacks( d4, bbOccupied ).asStrSquares(), 
+            "a1b2f2c3e3c5e5b6f6a7g7h8" );
+        TESTEQ( "queenAttacksD4", 
+            CMagic::queenAttacks( d4, bbOccupied ).get(), 
+            CMagic::rookAttacks( d4, bbOccupied ).get() 
+                | CMagic::bishopAttacks( d4, bbOccupied ).get() );
+
+        //
+        //  Every square against a spread of pseudo random occupancies.
+        //
+        U64 seed = 0x0123456789ABCDEFULL;
+        int numRookMismatches = 0;
+        int numBishopMismatches = 0;
+        for ( int trial = 0; trial < 256; trial++ )
+        {
+            seed ^= seed >> 12;
+            seed ^= seed << 25;
+            seed ^= seed >> 27;
+            CBitBoard bbRandom = seed * 0x2545F4914F6CDD1DULL;
+            if ( trial & 1 )
+                bbRandom &= seed;
+            for ( U8 sq = 0; sq < CSqix::kNumSquares; sq++ )
+            {
+                if ( CMagic::rookAttacks( sq, bbRandom ).get() 
+                    != CMagic::rookAttacksByRays( sq, bbRandom ).get() )
+                {
+                    numRookMismatches++;
+                }
+                if ( CMagic::bishopAttacks( sq, bbRandom ).get() 
+                    != CMagic::bishopAttacksByRays( sq, bbRandom ).get() )
+                {
+                    numBishopMismatches++;
+                }
+            }
+        }
+        TESTEQ( "rookAttacksMatchRays", numRookMismatches, 0 );
+        TESTEQ( "bishopAttacksMatchRays", numBishopMismatches, 0 );
+    }
+    CMagic::setBackend( defaultBackend );
+    endSuite();
+}
+
 ///
 /// tests the piece.h module
 ///
@@ -1194,23 +1816,33 @@ void CTester::testPosition( void )
     //
     //  test moving some rooks
     //
-    rights.onWqrMove();
+    rights.onMove( CSqix( ERank::kRank1, EFile::kFileA ), 
+        CSqix( ERank::kRank1, EFile::kFileB ) );
     TESTEQ( "castleMoveNoWQ", rights.castlingAsStr(), "Kkq" );
-    rights.onWkrMove();
+    rights.onMove( CSqix( ERank::kRank1, EFile::kFileH ), 
+        CSqix( ERank::kRank5, EFile::kFileH ) );
     TESTEQ( "castleMoveNoW", rights.castlingAsStr(), "kq" );
-    rights.onBkrMove();
+    rights.onMove( CSqix( ERank::kRank8, EFile::kFileH ), 
+        CSqix( ERank::kRank8, EFile::kFileG ) );
     TESTEQ( "castleMoveNoWBk", rights.castlingAsStr(), "q" );
-    rights.onBqrMove();
+    rights.onMove( CSqix( ERank::kRank8, EFile::kFileA ), 
+        CSqix( ERank::kRank1, EFile::kFileA ) );
     TESTEQ( "castleMoveNone", rights.castlingAsStr(), "-" );
 
     //
-    //  test moving the kings
+    //  test moving the kings, and capturing a rook in its corner
     //
     rights.init();
-    rights.onKMove( EColor::kWhite );
+    rights.onMove( CSqix( ERank::kRank1, EFile::kFileE ), 
+        CSqix( ERank::kRank2, EFile::kFileE ) );
     TESTEQ( "castleMoveWk", rights.castlingAsStr(), "kq" );
-    rights.onKMove( EColor::kBlack );
+    rights.onMove( CSqix( ERank::kRank8, EFile::kFileE ), 
+        CSqix( ERank::kRank8, EFile::kFileG ) );
     TESTEQ( "castleMoveWk", rights.castlingAsStr(), "-" );
+    rights.init();
+    rights.onMove( CSqix( ERank::kRank2, EFile::kFileB ), 
+        CSqix( ERank::kRank8, EFile::kFileH ) );
+    TESTEQ( "castleCaptureRook", rights.castlingAsStr(), "KQq" );
 
     rights.init();
     TESTEQ( "illegalEp", rights.asStr(), "KQkq -" );
@@ -1253,6 +1885,140 @@ void CTester::testPosition( void )
         "K: 00001000/00000000/00000000/00000000/00000000/00000000/00000000/00001000\n"
         "W: 00000000/00000000/00000000/00000000/00000000/00000000/11111111/11111111\n"
         "B: 11111111/11111111/00000000/00000000/00000000/00000000/00000000/00000000\n" );
+
+    //
+    //  The occupancy and attack maps follow the moves
+    //
+    TESTEQ( "occupiedStart", pos.occupied().get(), 0xFFFF00000000FFFFULL );
+    TESTEQ( "attacksStart", pos.getAttacks( EColor::kWhite ).get(), 
+        0xFFFF7EULL );
+    CMove e2e4( CSqix( ERank::kRank2, EFile::kFileE ), 
+        CSqix( ERank::kRank4, EFile::kFileE ), 
+        CMove::kDoublePush );
+    pos.makeMove( e2e4 );
+    TESTEQ( "occupiedAfterMove", pos.occupied().get(), 
+        0xFFFF00001000EFFFULL );
+    TESTEQ( "epAfterDoublePush", pos.asFen().find( " KQkq - " ) 
+        != std::string::npos, true );
+    TESTEQ( "attacksAfterMove", 
+        pos.getAttacks( EColor::kWhite ).asStrSquares().find( "d5f5" ) 
+            != std::string::npos, true );
+    pos.unmakeMove( e2e4 );
+    TESTEQ( "occupiedAfterUnmake", pos.occupied().get(), 
+        0xFFFF00000000FFFFULL );
+    TESTEQ( "attacksAfterUnmake", pos.getAttacks( EColor::kWhite ).get(), 
+        0xFFFF7EULL );
+
+    //
+    //  The en passant file is only set when a pawn can take, whether by a
+    //  double push or in a fen
+    //
+    CPos epPos;
+    TESTEQ( "epCapturerFen", epPos.parseFen( 
+        "4k3/8/8/8/3p4/8/4P3/4K3 w - - 0 1", errorText ), true );
+    epPos.makeMove( e2e4 );
+    TESTEQ( "epCapturer", epPos.asFen(), "4k3/8/8/8/3pP3/8/8/4K3 b - e3 0 2" );
+    TESTEQ( "epCapturerKey", epPos.getHashKey(), epPos.computeHashKey() );
+    CPos epFenPos;
+    epFenPos.parseFen( "4k3/8/8/8/3pP3/8/8/4K3 b - e3 0 1", errorText );
+    TESTEQ( "epCapturerFenKey", epFenPos.getHashKey(), epPos.getHashKey() );
+    epFenPos.parseFen( "4k3/8/8/8/4P3/8/8/4K3 b - e3 0 1", errorText );
+    TESTEQ( "epNoCapturerFen", epFenPos.asFen(), 
+        "4k3/8/8/8/4P3/8/8/4K3 b - - 0 1" );
+
+    //
+    //  The hash key kept by make and unmake matches the one from scratch,
+    //  and transposing into a position from a fen gives the same key.
+    //
+    YHashKey startKey = pos.getHashKey();
+    TESTEQ( "hashStart", startKey, pos.computeHashKey() );
+    CMove g1f3( CSqix( ERank::kRank1, EFile::kFileG ), 
+        CSqix( ERank::kRank3, EFile::kFileF ) );
+    CMove g8f6( CSqix( ERank::kRank8, EFile::kFileG ), 
+        CSqix( ERank::kRank6, EFile::kFileF ) );
+    pos.makeMove( g1f3 );
+    TESTEQ( "hashAfterMove", pos.getHashKey(), pos.computeHashKey() );
+    TESTEQ( "hashChanged", pos.getHashKey() != startKey, true );
+    pos.makeMove( g8f6 );
+    CPos transposed;
+    transposed.parseFen( 
+        "rnbqkb1r/pppppppp/5n2/8/8/5N2/PPPPPPPP/RNBQKB1R w KQkq - 2 2", 
+        errorText );
+    TESTEQ( "hashTransposed", pos.getHashKey(), transposed.getHashKey() );
+    pos.unmakeMove( g8f6 );
+    pos.unmakeMove( g1f3 );
+    TESTEQ( "hashAfterUnmake", pos.getHashKey(), startKey );
+    transposed.parseFen( 
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1", 
+        errorText );
+    TESTEQ( "hashSideToMove", transposed.getHashKey() != startKey, true );
+    transposed.parseFen( 
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w Qkq - 0 1", 
+        errorText );
+    TESTEQ( "hashCastling", transposed.getHashKey() != startKey, true );
+
+    //
+    //  The undo stack puts back the captured piece, the half move clock
+    //  and the checkers, and holds far more moves than a search goes deep.
+    //
+    CMoves moves;
+    pos.parseFen( "4k3/8/8/3p4/4N3/8/8/4K2R w - - 7 30", errorText );
+    pos.genLegalMoves<EColor::kWhite>( moves );
+    YHashKey capturesKey = pos.getHashKey();
+    CMove e4d6( CSqix( ERank::kRank4, EFile::kFileE ),
+        CSqix( ERank::kRank6, EFile::kFileD ) );
+    CMove e4d2( CSqix( ERank::kRank4, EFile::kFileE ),
+        CSqix( ERank::kRank2, EFile::kFileD ) );
+    CMove d2e4( CSqix( ERank::kRank2, EFile::kFileD ),
+        CSqix( ERank::kRank4, EFile::kFileE ) );
+    CMove e8d8( CSqix( ERank::kRank8, EFile::kFileE ),
+        CSqix( ERank::kRank8, EFile::kFileD ) );
+    CMove d8e8( CSqix( ERank::kRank8, EFile::kFileD ),
+        CSqix( ERank::kRank8, EFile::kFileE ) );
+    pos.makeMove( e4d6 );
+    TESTEQ( "undoDepth", pos.getNumUndos(), 1 );
+    TESTEQ( "undoClockQuiet", pos.getHalfMoveClock(), 8 );
+    pos.genLegalMoves<EColor::kBlack>( moves );
+    TESTEQ( "undoCheckersSet", pos.getCheckers().get() != 0, true );
+    pos.unmakeMove( e4d6 );
+    TESTEQ( "undoCheckersRestored", pos.getCheckers().get(), 0ULL );
+    TESTEQ( "undoClockRestored", pos.getHalfMoveClock(), 7 );
+    pos.makeMove( CMove( CSqix( ERank::kRank4, EFile::kFileE ),
+        CSqix( ERank::kRank5, EFile::kFileD ), CMove::kCapture ) );
+    pos.makeMove( e8d8 );
+    TESTEQ( "undoClockCapture", pos.getHalfMoveClock(), 1 );
+    pos.unmakeMove( e8d8 );
+    pos.unmakeMove( CMove( CSqix( ERank::kRank4, EFile::kFileE ),
+        CSqix( ERank::kRank5, EFile::kFileD ), CMove::kCapture ) );
+    TESTEQ( "undoCaptured",
+        pos.getPiece( CSqix( ERank::kRank5, EFile::kFileD ).get() ).get(),
+        EPiece::kBlackPawn );
+    for ( U16 moveIx = 0; moveIx < 1000; moveIx++ )
+    {
+        pos.makeMove( moveIx % 2 ? d2e4 : e4d2 );
+        pos.makeMove( moveIx % 2 ? d8e8 : e8d8 );
+    }
+    TESTEQ( "undoDeep", pos.getNumUndos(), 2000 );
+    TESTEQ( "undoDeepHash", pos.getHashKey(), capturesKey );
+    for ( U16 moveIx = 1000; moveIx-- > 0; )
+    {
+        pos.unmakeMove( moveIx % 2 ? d8e8 : e8d8 );
+        pos.unmakeMove( moveIx % 2 ? d2e4 : e4d2 );
+    }
+    TESTEQ( "undoDeepUnwound", pos.getNumUndos(), 0 );
+    TESTEQ( "undoDeepClock", pos.getHalfMoveClock(), 7 );
+    TESTEQ( "undoDeepKey", pos.getHashKey(), capturesKey );
+
+    //
+    //  A copy takes the undo stack along, and unmakes on its own
+    //
+    pos.makeMove( e4d2 );
+    CPos copy( pos );
+    pos.unmakeMove( e4d2 );
+    TESTEQ( "undoCopied", copy.getNumUndos(), 1 );
+    copy.unmakeMove( e4d2 );
+    TESTEQ( "undoCopyUnwound", copy.getHashKey(), capturesKey );
+    TESTEQ( "undoCopyOriginal", pos.getHashKey(), capturesKey );
     endSuite();
 }
 
@@ -1335,9 +2101,377 @@ void CTester::testPerft()
         TESTEQ( "Perft1ParseFen", true, bOk );
     }
 
+    std::string sFen = pos.asFen();
     CSearcher searcher( pos );
     U64 count = searcher.perft( 1 );
     TESTEQ( "perft1", 20, count );
+    TESTEQ( "perft2", 400, searcher.perft( 2 ) );
+    TESTEQ( "perft3", 8902, searcher.perft( 3 ) );
+    TESTEQ( "perft4", 197281, searcher.perft( 4 ) );
+    TESTEQ( "perftRestoresPos", pos.asFen(), sFen );
+
+    //
+    //  The parallel perft counts the same nodes however it is split
+    //
+    TESTEQ( "perftParallel4", searcher.perftParallel( 4, 4 ), 197281 );
+    TESTEQ( "perftParallelThreads", 
+        searcher.getPerftThreadStats().size(), 4 );
+    U64 threadNodes = 0;
+    for ( const SPerftThreadStats& rStats : searcher.getPerftThreadStats() )
+        threadNodes += rStats.mNodes;
+    TESTEQ( "perftParallelThreadNodes", threadNodes, 197281 );
+    TESTEQ( "perftParallelSplit2", searcher.perftParallel( 4, 3, 2 ), 
+        197281 );
+    TESTEQ( "perftParallelShallow", searcher.perftParallel( 1, 2, 2 ), 20 );
+    TESTEQ( "perftParallelRestoresPos", pos.asFen(), sFen );
+
+    //
+    //  The perft table gives the same counts, alone or shared by threads, 
+    //  and a second run is answered from the table.
+    //
+    CPerftTable perftTable( 4 );
+    searcher.setPerftTable( &perftTable );
+    TESTEQ( "perftTable4", searcher.perft( 4 ), 197281 );
+    TESTEQ( "perftTable4Again", searcher.perft( 4 ), 197281 );
+    perftTable.clear();
+    TESTEQ( "perftTableParallel", searcher.perftParallel( 4, 3, 2 ), 197281 );
+    TESTEQ( "perftTableRestoresPos", pos.asFen(), sFen );
+    searcher.setPerftTable( nullptr );
+
+    //
+    //  Bulk counting at the last ply gives the same counts
+    //
+    searcher.setPerftBulkCount( true );
+    TESTEQ( "perftBulk1", searcher.perft( 1 ), 20 );
+    TESTEQ( "perftBulk4", searcher.perft( 4 ), 197281 );
+    TESTEQ( "perftBulkParallel", searcher.perftParallel( 4, 2 ), 197281 );
+    TESTEQ( "perftBulkRestoresPos", pos.asFen(), sFen );
+    searcher.setPerftBulkCount( false );
+
+    //
+    //  Copy-make gives the same counts, and the child has the position and
+    //  hash key that making the move gives, while the parent is unchanged
+    //
+    searcher.setPerftCopyMake( true );
+    TESTEQ( "perftCopyMake4", searcher.perft( 4 ), 197281 );
+    TESTEQ( "perftCopyMakeParallel", searcher.perftParallel( 4, 2 ),
+        197281 );
+    searcher.setPerftCopyMake( false );
+    CMove e2e4( CSqix( ERank::kRank2, EFile::kFileE ),
+        CSqix( ERank::kRank4, EFile::kFileE ), 
+        CMove::kDoublePush );
+    CPos child( pos, e2e4 );
+    TESTEQ( "copyMakeParent", pos.asFen(), sFen );
+    TESTEQ( "copyMakeUndos", child.getNumUndos(), 0 );
+    TESTEQ( "copyMakeSize", sizeof( CPos ) <= 256, true );
+    pos.makeMove( e2e4 );
+    TESTEQ( "copyMakeFen", child.asFen(), pos.asFen() );
+    TESTEQ( "copyMakeHash", child.getHashKey(), pos.getHashKey() );
+    pos.unmakeMove( e2e4 );
+
+    //
+    //  A copy of a copy-made child has a stack, so moves can be made in it
+    //
+    CPos childCopy = child;
+    CMove e7e5( CSqix( ERank::kRank7, EFile::kFileE ),
+        CSqix( ERank::kRank5, EFile::kFileE ), 
+        CMove::kDoublePush );
+    childCopy.makeMove( e7e5 );
+    TESTEQ( "copyMakeCopyUndos", childCopy.getNumUndos(), 1 );
+    childCopy.unmakeMove( e7e5 );
+    TESTEQ( "copyMakeCopyFen", childCopy.asFen(), child.asFen() );
+
+    //
+    //  Divide adds up to the perft count
+    //
+    std::vector<SPerftDivide> divide;
+    TESTEQ( "perftDivide3", searcher.perftDivide( 3, divide ), 8902 );
+    TESTEQ( "perftDivideMoves", divide.size(), 20 );
+    std::string sDivide;
+    for ( const SPerftDivide& rDivide : divide )
+    {
+        if ( rDivide.mMove.asStr() == "e2e4" )
+            sDivide = std::to_string( rDivide.mNodes );
+    }
+    TESTEQ( "perftDivideE2e4", sDivide, "600" );
+
+    //
+    //  The standard statistics at depth 4 from the start
+    //
+    TESTEQ( "perftStats4", searcher.perftStats( 4 ).asStr(), 
+        "nodes 197281 captures 1576 ep 0 castles 0 promotions 0 "
+        "checks 469 discovered 0 double 0 checkmates 8" );
+    TESTEQ( "perftStatsRestoresPos", pos.asFen(), sFen );
+
+    //
+    //  Every knight move uncovers the rook, and two of them check as well
+    //
+    TESTEQ( "perftStatsDiscoveredFen", pos.parseFen( 
+        "4k3/8/8/8/4N3/8/8/4R1K1 w - - 0 1", errorText ), true );
+    TESTEQ( "perftStatsDiscovered", searcher.perftStats( 1 ).asStr(), 
+        "nodes 20 captures 0 ep 0 castles 0 promotions 0 "
+        "checks 8 discovered 8 double 2 checkmates 0" );
+    TESTEQ( "perftStatsMateFen", pos.parseFen( 
+        "7k/8/6K1/8/8/8/8/R7 w - - 0 1", errorText ), true );
+    TESTEQ( "perftStatsMate", searcher.perftStats( 1 ).mCheckmates, 1 );
+
+    //
+    //  Kiwipete has castling, en passant and promotions on both sides
+    //
+    TESTEQ( "perftKiwipeteFen", pos.parseFen( 
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+        " 0 1", errorText ), true );
+    TESTEQ( "perftKiwipete3", searcher.perft( 3 ), 97862 );
+    TESTEQ( "perftKiwipeteStats2", searcher.perftStats( 2 ).asStr(), 
+        "nodes 2039 captures 351 ep 1 castles 91 promotions 0 "
+        "checks 3 discovered 0 double 0 checkmates 0" );
+}
+
+//
+//  Tests the evaluation, draw detection and the alpha-beta search
+//
+void CTester::testSearch()
+{
+    beginSuite( "testSearch" );
+
+    CPos            pos;
+    std::string     errorText;
+    CSearcher       searcher( pos );
+    CTransTable     table( 1 );
+    SSearchLimits   limits = { 4, 0, 0 };
+    CMove           best;
+
+    //
+    //  The evaluation is symmetric, and counts material
+    //
+    TESTEQ( "evalStartFen", pos.parseFen( CPos::kStartFen, errorText ), 
+        true );
+    TESTEQ( "evalStart", CEval::evaluate( pos ), 0 );
+    TESTEQ( "evalQueenUpFen", pos.parseFen( 
+        "4k3/8/8/8/8/8/8/Q3K3 b - - 0 1", errorText ), true );
+    TESTEQ( "evalQueenUp", CEval::evaluate( pos ) < -800, true );
+
+    //
+    //  Knights out and back repeats the start position
+    //
+    pos.parseFen( CPos::kStartFen, errorText );
+    CSqix g1( ERank::kRank1, EFile::kFileG );
+    CSqix f3( ERank::kRank3, EFile::kFileF );
+    CSqix g8( ERank::kRank8, EFile::kFileG );
+    CSqix f6( ERank::kRank6, EFile::kFileF );
+    pos.makeMove( CMove( g1, f3, CMove::kQuiet ) );
+    pos.makeMove( CMove( g8, f6, CMove::kQuiet ) );
+    TESTEQ( "drawNotYet", pos.isDraw(), false );
+    pos.makeMove( CMove( f3, g1, CMove::kQuiet ) );
+    pos.makeMove( CMove( f6, g8, CMove::kQuiet ) );
+    TESTEQ( "drawRepetition", pos.isDraw(), true );
+    TESTEQ( "drawFiftyFen", pos.parseFen( 
+        "4k3/8/8/8/8/8/8/R3K3 w - - 100 80", errorText ), true );
+    TESTEQ( "drawFifty", pos.isDraw(), true );
+
+    searcher.setTransTable( &table );
+    searcher.setLimits( limits );
+
+    //
+    //  A back rank mate in one, which ends the search early
+    //
+    TESTEQ( "searchMateFen", pos.parseFen( 
+        "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", errorText ), true );
+    TESTEQ( "searchMateScore", searcher.determineBestMove( best ), 
+        CSearcher::kMate - 1 );
+    TESTEQ( "searchMateMove", best.asStr(), "a1a8" );
+    TESTEQ( "searchMateReports", searcher.getReports().size(), 1 );
+    TESTEQ( "searchMateReportStr", 
+        searcher.getReports()[0].asStr().find( "score mate 1 " ) 
+            != std::string::npos, true );
+
+    //
+    //  Winning a free queen, with the position put back afterwards
+    //
+    TESTEQ( "searchQueenFen", pos.parseFen( 
+        "4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1", errorText ), true );
+    searcher.determineBestMove( best );
+    TESTEQ( "searchQueenMove", best.asStr(), "d1d5" );
+    TESTEQ( "searchQueenUnchanged", pos.asFen(), 
+        "4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1" );
+
+    //
+    //  Each iteration goes a ply deeper, and its variation starts with 
+    //  the move it found
+    //
+    pos.parseFen( CPos::kStartFen, errorText );
+    searcher.determineBestMove( best );
+    const std::vector<SSearchReport>& reports = searcher.getReports();
+    TESTEQ( "searchStartReports", reports.size(), 4 );
+    bool bReportsOk = true;
+    for ( U16 reportIx = 0; reportIx < reports.size(); reportIx++ )
+    {
+        bReportsOk = bReportsOk && reports[reportIx].mDepth == reportIx + 1
+            && reports[reportIx].mPv.size() >= reportIx + 1
+            && reports[reportIx].mSelDepth >= reports[reportIx].mDepth;
+    }
+    TESTEQ( "searchStartReportsOk", bReportsOk, true );
+    TESTEQ( "searchStartBest", best == reports.back().mPv[0], true );
+    TESTEQ( "searchStartUnchanged", pos.asFen(), CPos::kStartFen );
+
+    //
+    //  A node limit stops the search part way, but there is still a move
+    //
+    limits.mMaxDepth = 0;
+    limits.mMaxNodes = 2000;
+    searcher.setLimits( limits );
+    searcher.determineBestMove( best );
+    TESTEQ( "searchNodeLimit", searcher.getNodes(), 2000 );
+    TESTEQ( "searchNodeLimitMove", best.isNull(), false );
+    TESTEQ( "searchNodeLimitUnchanged", pos.asFen(), CPos::kStartFen );
+
+    //
+    //  Stalemate has no move and scores a draw
+    //
+    TESTEQ( "searchStalemateFen", pos.parseFen( 
+        "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", errorText ), true );
+    TESTEQ( "searchStalemate", searcher.determineBestMove( best ), 0 );
+    TESTEQ( "searchStalemateMove", best.isNull(), true );
+
+    //
+    //  The quiescence search sees that the pawn is defended
+    //
+    limits.mMaxDepth = 1;
+    limits.mMaxNodes = 0;
+    searcher.setLimits( limits );
+    TESTEQ( "searchDefendedFen", pos.parseFen( 
+        "4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1", errorText ), true );
+    searcher.determineBestMove( best );
+    TESTEQ( "searchDefended", best.asStr() != "d1d5", true );
+
+    //
+    //  Helper threads share the table, and their nodes are counted in, 
+    //  while the reports still come from the main thread
+    //
+    limits.mMaxDepth = 4;
+    searcher.setLimits( limits );
+    TESTEQ( "searchParallelFen", pos.parseFen( 
+        "4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1", errorText ), true );
+    searcher.determineBestMoveParallel( best, 4 );
+    TESTEQ( "searchParallelMove", best.asStr(), "d1d5" );
+    TESTEQ( "searchParallelReports", searcher.getReports().size(), 4 );
+    TESTEQ( "searchParallelNodes", 
+        searcher.getNodes() >= searcher.getReports().back().mNodes, true );
+    TESTEQ( "searchParallelUnchanged", pos.asFen(), 
+        "4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1" );
+    TESTEQ( "searchParallelMate", pos.parseFen( 
+        "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", errorText ), true );
+    TESTEQ( "searchParallelMateScore", 
+        searcher.determineBestMoveParallel( best, 3 ), CSearcher::kMate - 1 );
+    TESTEQ( "searchParallelMateMove", best.asStr(), "a1a8" );
+
+    //
+    //  The deterministic mode gives the same iterations, down to the node
+    //  counts, every time, even when the node limit stops it
+    //
+    limits.mMaxDepth = 0;
+    limits.mMaxNodes = 60000;
+    searcher.setLimits( limits );
+    searcher.setDeterministic( true );
+    TESTEQ( "searchSplitFen", pos.parseFen( 
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+        " 0 1", errorText ), true );
+    std::string sRuns[2];
+    CMove runMoves[2];
+    for ( U16 runIx = 0; runIx < 2; runIx++ )
+    {
+        YVal score = searcher.determineBestMoveParallel( runMoves[runIx], 3 );
+        sRuns[runIx] = std::to_string( score ) + " " 
+            + std::to_string( searcher.getNodes() );
+        for ( const SSearchReport& rReport : searcher.getReports() )
+        {
+            sRuns[runIx] += "; " + std::to_string( rReport.mDepth ) + " "
+                + std::to_string( rReport.mSelDepth ) + " "
+                + std::to_string( rReport.mScore ) + " "
+                + std::to_string( rReport.mNodes );
+            for ( CMove m : rReport.mPv )
+                sRuns[runIx] += " " + m.asStr();
+        }
+    }
+    TESTEQ( "searchSplitRepeats", sRuns[0], sRuns[1] );
+    TESTEQ( "searchSplitMove", runMoves[0] == runMoves[1], true );
+    TESTEQ( "searchSplitStopped", searcher.getNodes() <= 60000, true );
+    TESTEQ( "searchSplitUnchanged", pos.asFen(), 
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+        " 0 1" );
+
+    limits.mMaxDepth = 4;
+    limits.mMaxNodes = 0;
+    searcher.setLimits( limits );
+    TESTEQ( "searchSplitMateFen", pos.parseFen( 
+        "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", errorText ), true );
+    TESTEQ( "searchSplitMateScore", 
+        searcher.determineBestMoveParallel( best, 4 ), CSearcher::kMate - 1 );
+    TESTEQ( "searchSplitMateMove", best.asStr(), "a1a8" );
+    TESTEQ( "searchSplitQueenFen", pos.parseFen( 
+        "4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1", errorText ), true );
+    searcher.determineBestMoveParallel( best, 2 );
+    TESTEQ( "searchSplitQueen", best.asStr(), "d1d5" );
+
+    //
+    //  e5xf4 and g5xf4 both beat the first root move.  e5xf4 comes first
+    //  and is searched again first, but taking back with the bishop is 
+    //  better, and must still be found.
+    //
+    limits.mMaxDepth = 2;
+    searcher.setLimits( limits );
+    TESTEQ( "searchSplitFailHighsFen", pos.parseFen( 
+        "r1q1k1nr/p1p2ppp/n7/1p1pp1b1/1PP1bB2/3P1P1N/P3B1PP/RN1Q1K1R b kq -"
+        " 3 20", errorText ), true );
+    TESTEQ( "searchSplitFailHighsScore", 
+        searcher.determineBestMoveParallel( best, 1 ), 195 );
+    TESTEQ( "searchSplitFailHighs", best.asStr(), "g5f4" );
+    searcher.determineBestMoveParallel( best, 2 );
+    TESTEQ( "searchSplitFailHighs2", best.asStr(), "g5f4" );
+    searcher.setDeterministic( false );
+
+    //
+    //  Copy-make searches the same tree as make and unmake.  Black can 
+    //  repeat the start position with g8, which takes the moves made 
+    //  before the search to see.
+    //
+    limits.mMaxDepth = 5;
+    searcher.setLimits( limits );
+    pos.parseFen( CPos::kStartFen, errorText );
+    pos.makeMove( CMove( g1, f3, CMove::kQuiet ) );
+    pos.makeMove( CMove( g8, f6, CMove::kQuiet ) );
+    pos.makeMove( CMove( f3, g1, CMove::kQuiet ) );
+    std::string sModes[2];
+    for ( U16 modeIx = 0; modeIx < 2; modeIx++ )
+    {
+        searcher.setSearchCopyMake( modeIx == 1 );
+        table.clear();
+        YVal score = searcher.determineBestMove( best );
+        sModes[modeIx] = best.asStr() + " " + std::to_string( score ) + " " 
+            + std::to_string( searcher.getNodes() );
+    }
+    TESTEQ( "searchCopyMake", sModes[0], sModes[1] );
+    TESTEQ( "searchCopyMakeUndos", pos.getNumUndos(), 3 );
+    TESTEQ( "searchCopyMakeUnchanged", pos.asFen(), 
+        "rnbqkb1r/pppppppp/5n2/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 3 4" );
+
+    //
+    //  The deterministic search's helpers copy-make too, so the thread 
+    //  count is all that changes the tree.
+    //
+    searcher.setDeterministic( true );
+    for ( U16 modeIx = 0; modeIx < 2; modeIx++ )
+    {
+        searcher.setSearchCopyMake( modeIx == 1 );
+        YVal score = searcher.determineBestMoveParallel( best, 2 );
+        sModes[modeIx] = best.asStr() + " " + std::to_string( score ) + " " 
+            + std::to_string( searcher.getNodes() );
+    }
+    TESTEQ( "searchCopyMakeSplit", sModes[0], sModes[1] );
+    searcher.setDeterministic( false );
+    searcher.setSearchCopyMake( false );
+
+    endSuite();
 }
 
 ///
@@ -1350,7 +2484,14 @@ void CTester::testAll()
     testMove();
     testBitBoard();
     testPosition();
+    testGen();
+    testMagic();
     testMoveGen();
     testCheck();
+    testLegalMoves();
+    testSee();
+    testMovePicker();
+    testTransTable();
     testPerft();
+    testSearch();
 }
@@ -25,9 +25,16 @@ private:
     static void testMove();
     static void testBitBoard();
     static void testSquare();
+    static void testGen();
+    static void testMagic();
     static void testMoveGen();
     static void testCheck();
+    static void testLegalMoves();
+    static void testSee();
+    static void testMovePicker();
+    static void testTransTable();
     static void testPerft();
+    static void testSearch();
 
     static int          mgOkCount;
     static char*        mgCurSuiteName;